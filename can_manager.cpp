@@ -0,0 +1,475 @@
+//
+// CAN Manager Implementation
+// CAN通信管理器实现 - PT协议命令编码、按总线分发的I/O线程和反馈解析
+//
+
+#include "friction_test.h"
+#include "joint_bus_map.h"
+#include <cstring>
+#include <sstream>
+
+namespace friction_test {
+
+namespace {
+
+constexpr uint32_t CAN_DEVICE_TYPE = VCI_USBCAN2;
+constexpr int MAX_MOTOR_ID = 40;
+constexpr int MAX_USB_DEVICES = 50;
+constexpr uint32_t RX_BATCH_SIZE = 100;
+// I/O线程空闲时等待新发送帧的最长时间，同时决定接收轮询间隔
+constexpr auto IO_IDLE_WAIT = std::chrono::microseconds(200);
+// 总线超限警告的最短间隔 (秒)
+constexpr double BUS_WARN_INTERVAL_S = 1.0;
+// logBusLoad列出的占用最多的关节数
+constexpr int BUS_LOAD_TOP_JOINTS = 3;
+
+void initCanConfig(VCI_INIT_CONFIG& config) {
+    config.AccCode = 0x00000000;
+    config.AccMask = 0xFFFFFFFF;
+    config.Reserved = 0;
+    config.Filter = 1;
+    config.Timing0 = 0x00;   // 1Mbps
+    config.Timing1 = 0x14;
+    config.Mode = 0;
+}
+
+} // namespace
+
+CANManager::CANManager()
+    : is_connected_(false),
+      armr_device_(-1),
+      arml_device_(-1),
+      body_device_(-1),
+      motor_bus_(MAX_MOTOR_ID + 1, -1),
+      feedback_cache_(MAX_MOTOR_ID + 1),
+      feedback_fresh_(MAX_MOTOR_ID + 1, 0),
+      start_time_(std::chrono::steady_clock::now()),
+      bus_load_limit_(CanProtocol::BUS_LOAD_LIMIT) {
+}
+
+CANManager::~CANManager() {
+    shutdown();
+}
+
+bool CANManager::initialize() {
+    std::lock_guard<std::mutex> lock(can_mutex_);
+
+    Logger::info("Initializing CAN communication...");
+
+    if (!findAndBindDevices()) {
+        Logger::error("No CAN device found");
+        return false;
+    }
+
+    if (!initializeCanDevice()) {
+        return false;
+    }
+
+    for (auto& bus : buses_) {
+        bus->running = true;
+        bus->io_thread = std::thread(&CANManager::ioLoop, this, bus.get());
+    }
+
+    is_connected_ = true;
+    Logger::info("CAN communication initialized successfully (" + std::to_string(buses_.size()) + " buses)");
+    return true;
+}
+
+// 按枚举到的设备数绑定左臂/右臂/身体设备，并为每个关节确定所在总线
+bool CANManager::findAndBindDevices() {
+    VCI_BOARD_INFO boards[MAX_USB_DEVICES];
+    int device_count = VCI_FindUsbDevice2(boards);
+    if (device_count <= 0) {
+        return false;
+    }
+
+    arml_device_ = jointBusDeviceIndex(BUS_DEVICE_ARM_LEFT, device_count);
+    armr_device_ = jointBusDeviceIndex(BUS_DEVICE_ARM_RIGHT, device_count);
+    body_device_ = jointBusDeviceIndex(BUS_DEVICE_BODY, device_count);
+
+    buses_.clear();
+    std::fill(motor_bus_.begin(), motor_bus_.end(), -1);
+
+    for (int motor_id : FrictionTester::getMotorIdList()) {
+        if (motor_id < 1 || motor_id > MAX_MOTOR_ID) {
+            continue;
+        }
+        JointBus route = jointBus(motor_id, device_count);
+
+        int index = -1;
+        for (size_t b = 0; b < buses_.size(); b++) {
+            if (buses_[b]->device_index == route.device &&
+                buses_[b]->channel == static_cast<uint32_t>(route.channel)) {
+                index = static_cast<int>(b);
+                break;
+            }
+        }
+        if (index < 0) {
+            std::unique_ptr<CanBus> bus(new CanBus());
+            bus->device_index = route.device;
+            bus->channel = static_cast<uint32_t>(route.channel);
+            bus->tx_queue.reserve(MAX_MOTOR_ID);
+            bus->tx_sending.reserve(MAX_MOTOR_ID);
+            buses_.push_back(std::move(bus));
+            index = static_cast<int>(buses_.size()) - 1;
+        }
+        motor_bus_[motor_id] = index;
+    }
+
+    Logger::info("Found " + std::to_string(device_count) + " CAN device(s), " +
+                 std::to_string(buses_.size()) + " bus(es) in use");
+    return !buses_.empty();
+}
+
+bool CANManager::initializeCanDevice() {
+    open_devices_.clear();
+
+    for (auto& bus : buses_) {
+        std::string name = std::to_string(bus->device_index) + ":" + std::to_string(bus->channel);
+
+        if (std::find(open_devices_.begin(), open_devices_.end(), bus->device_index) == open_devices_.end()) {
+            if (VCI_OpenDevice(CAN_DEVICE_TYPE, bus->device_index, 0) != 1) {
+                Logger::error("Failed to open CAN device " + std::to_string(bus->device_index));
+                stopBuses();
+                return false;
+            }
+            open_devices_.push_back(bus->device_index);
+        }
+
+        VCI_INIT_CONFIG config;
+        initCanConfig(config);
+        if (VCI_InitCAN(CAN_DEVICE_TYPE, bus->device_index, bus->channel, &config) != 1) {
+            Logger::error("Failed to initialize CAN channel " + name);
+            stopBuses();
+            return false;
+        }
+
+        if (VCI_StartCAN(CAN_DEVICE_TYPE, bus->device_index, bus->channel) != 1) {
+            Logger::error("Failed to start CAN channel " + name);
+            stopBuses();
+            return false;
+        }
+
+        VCI_ClearBuffer(CAN_DEVICE_TYPE, bus->device_index, bus->channel);
+        Logger::debug("CAN bus " + name + " started");
+    }
+
+    return true;
+}
+
+int CANManager::getDeviceIndex(int motor_index) {
+    CanBus* bus = getBus(FrictionTester::getMotorIdByIndex(motor_index));
+    return bus ? bus->device_index : -1;
+}
+
+CANManager::CanBus* CANManager::getBus(int motor_id) {
+    if (motor_id < 1 || motor_id > MAX_MOTOR_ID || motor_bus_[motor_id] < 0) {
+        return nullptr;
+    }
+    return buses_[motor_bus_[motor_id]].get();
+}
+
+uint32_t CANManager::transmitFrames(CanBus& bus, VCI_CAN_OBJ* frames, uint32_t count) {
+    uint32_t sent = 0;
+    int retries = 0;
+
+    while (sent < count) {
+        uint32_t result = VCI_Transmit(CAN_DEVICE_TYPE, bus.device_index, bus.channel, frames + sent, count - sent);
+        if (result == static_cast<uint32_t>(-1)) {
+            break;
+        }
+        if (result == 0 && ++retries > CanProtocol::MAX_RETRY_COUNT) {
+            break;
+        }
+        sent += result;
+    }
+    bus.load.RecordTx(frames, sent, busTime());
+
+    if (sent < count) {
+        Logger::warn("CAN transmit incomplete on bus " + std::to_string(bus.device_index) + ":" +
+                     std::to_string(bus.channel) + ": " + std::to_string(sent) + "/" + std::to_string(count) + " frames");
+    }
+    return sent;
+}
+
+bool CANManager::sendMotorCommand(int motor_index, const MotorData& cmd) {
+    int motor_id = FrictionTester::getMotorIdByIndex(motor_index);
+    CanBus* bus = getBus(motor_id);
+    if (!bus || !is_connected_) {
+        return false;
+    }
+
+    {
+        std::lock_guard<std::mutex> lock(bus->mutex);
+        bus->tx_queue.push_back(VCI_CAN_OBJ());
+        motorDataToCanMessage(cmd, motor_id, bus->tx_queue.back());
+    }
+    bus->tx_cv.notify_one();
+    return true;
+}
+
+// commands按电机索引排列，每条总线上的帧一次入队，由该总线的I/O线程一次发送
+bool CANManager::sendAllMotorCommands(const std::vector<MotorData>& commands) {
+    if (!is_connected_) {
+        return false;
+    }
+
+    for (size_t b = 0; b < buses_.size(); b++) {
+        CanBus& bus = *buses_[b];
+        bool queued = false;
+        {
+            std::lock_guard<std::mutex> lock(bus.mutex);
+            for (size_t i = 0; i < commands.size(); i++) {
+                int motor_id = FrictionTester::getMotorIdByIndex(static_cast<int>(i));
+                if (motor_id < 1 || motor_id > MAX_MOTOR_ID || motor_bus_[motor_id] != static_cast<int>(b)) {
+                    continue;
+                }
+                bus.tx_queue.push_back(VCI_CAN_OBJ());
+                motorDataToCanMessage(commands[i], motor_id, bus.tx_queue.back());
+                queued = true;
+            }
+        }
+        if (queued) {
+            bus.tx_cv.notify_one();
+        }
+    }
+
+    return true;
+}
+
+void CANManager::ioLoop(CanBus* bus) {
+    while (true) {
+        bool running = bus->running.load();
+        {
+            std::lock_guard<std::mutex> lock(bus->mutex);
+            bus->tx_sending.swap(bus->tx_queue);
+        }
+
+        // 停止前也要把队列中的帧 (例如急停命令) 发完
+        bool sent = !bus->tx_sending.empty();
+        if (sent) {
+            transmitFrames(*bus, bus->tx_sending.data(), static_cast<uint32_t>(bus->tx_sending.size()));
+            bus->tx_sending.clear();
+        }
+
+        if (!running) {
+            break;
+        }
+
+        uint32_t received = drainReceiveBuffer(*bus);
+        if (sent || received > 0) {
+            checkBusLoad(*bus);
+        }
+
+        // 既没有发送也没有收到，等新的发送帧或下一次接收轮询
+        if (!sent && received == 0) {
+            std::unique_lock<std::mutex> lock(bus->mutex);
+            bus->tx_cv.wait_for(lock, IO_IDLE_WAIT, [bus] {
+                return !bus->tx_queue.empty() || !bus->running.load();
+            });
+        }
+    }
+}
+
+uint32_t CANManager::drainReceiveBuffer(CanBus& bus) {
+    VCI_CAN_OBJ buffer[RX_BATCH_SIZE];
+    uint32_t total = 0;
+
+    while (true) {
+        uint32_t count = VCI_Receive(CAN_DEVICE_TYPE, bus.device_index, bus.channel, buffer, RX_BATCH_SIZE, 0);
+        if (count == 0 || count == static_cast<uint32_t>(-1)) {
+            break;
+        }
+
+        auto now = std::chrono::high_resolution_clock::now();
+        double bus_now = busTime();
+        bus.load.RecordRx(buffer, count, bus_now);
+        {
+            std::lock_guard<std::mutex> lock(bus.mutex);
+            for (uint32_t i = 0; i < count; i++) {
+                int motor_id = static_cast<int>(buffer[i].ID);
+                if (motor_id < 1 || motor_id > MAX_MOTOR_ID || buffer[i].DataLen != 8) {
+                    continue;
+                }
+                MotorData& data = feedback_cache_[motor_id];
+                canMessageToMotorData(buffer[i], motor_id, data);
+                // 同一批帧的主机时刻相同；适配器时间戳换算后是各帧实际上总线的时刻，不含USB批量延迟
+                data.hardware_timestamp = buffer[i].TimeFlag != 0;
+                data.timestamp = now;
+                if (data.hardware_timestamp) {
+                    double bus_time = bus.adapter_clock.Update(buffer[i].TimeStamp, bus_now);
+                    data.timestamp -= std::chrono::duration_cast<std::chrono::high_resolution_clock::duration>(
+                        std::chrono::duration<double>(bus_now - bus_time));
+                }
+                feedback_fresh_[motor_id] = 1;
+            }
+        }
+        total += count;
+
+        if (count < RX_BATCH_SIZE) {
+            break;
+        }
+    }
+
+    if (total > 0) {
+        bus.feedback_cv.notify_all();
+    }
+    return total;
+}
+
+double CANManager::busTime() const {
+    return std::chrono::duration<double>(std::chrono::steady_clock::now() - start_time_).count();
+}
+
+void CANManager::checkBusLoad(CanBus& bus) {
+    double now = busTime();
+    if (now - bus.load_warn_time < BUS_WARN_INTERVAL_S) {
+        return;
+    }
+    BusLoadStats window = bus.load.Window(BUS_LOAD_SHORT_WINDOW_S, now);
+    double limit = bus_load_limit_.load();
+    if (window.load > limit) {
+        bus.load_warn_time = now;
+        Logger::warn("CAN bus " + std::to_string(bus.device_index) + ":" + std::to_string(bus.channel) +
+                     " load " + std::to_string(static_cast<int>(window.load * 100)) + "% exceeds limit " +
+                     std::to_string(static_cast<int>(limit * 100)) + "% (" +
+                     std::to_string(static_cast<int>(window.FramesPerSecond())) + " frames/s)");
+    }
+}
+
+void CANManager::logBusLoad() const {
+    double now = busTime();
+    for (const auto& bus : buses_) {
+        BusLoadStats recent = bus->load.Window(BUS_LOAD_HISTORY_S, now);
+        BusLoadStats total = bus->load.Total(now);
+
+        std::ostringstream line;
+        line << std::fixed << std::setprecision(1)
+             << "CAN bus " << bus->device_index << ":" << bus->channel
+             << " last 1s: " << recent.FramesPerSecond() << " frames/s, "
+             << recent.BitsPerSecond() / 1000.0 << " kbit/s, load " << recent.load * 100.0 << "%"
+             << "; total: tx " << total.tx_frames << " rx " << total.rx_frames << " frames, avg load "
+             << total.load * 100.0 << "%, peak " << bus->load.PeakLoad() * 100.0 << "%";
+
+        // 本总线上累计占用最多的关节
+        std::vector<std::pair<uint64_t, int>> joints;
+        for (int motor_id = 1; motor_id <= MAX_MOTOR_ID; motor_id++) {
+            if (motor_bus_[motor_id] >= 0 && buses_[motor_bus_[motor_id]].get() == bus.get()) {
+                joints.emplace_back(bus->load.JointTotalBits(motor_id), motor_id);
+            }
+        }
+        std::sort(joints.rbegin(), joints.rend());
+        for (int i = 0; i < static_cast<int>(joints.size()) && i < BUS_LOAD_TOP_JOINTS && joints[i].first > 0; i++) {
+            line << (i == 0 ? "; top joints: " : ", ") << joints[i].second << " ("
+                 << (total.window_s > 0 ? joints[i].first / total.window_s / 1000.0 : 0.0) << " kbit/s)";
+        }
+        Logger::info(line.str());
+    }
+}
+
+bool CANManager::readMotorFeedback(int motor_index, MotorData& feedback) {
+    int motor_id = FrictionTester::getMotorIdByIndex(motor_index);
+    CanBus* bus = getBus(motor_id);
+    if (!bus || !is_connected_) {
+        return false;
+    }
+
+    std::unique_lock<std::mutex> lock(bus->mutex);
+    bool fresh = bus->feedback_cv.wait_for(lock, std::chrono::milliseconds(CanProtocol::RECEIVE_TIMEOUT), [&] {
+        return feedback_fresh_[motor_id] != 0;
+    });
+    if (!fresh) {
+        return false;
+    }
+
+    feedback = feedback_cache_[motor_id];
+    feedback_fresh_[motor_id] = 0;
+    return true;
+}
+
+void CANManager::emergencyStopAll() {
+    std::vector<MotorData> zero_commands(FrictionTester::getMotorIdList().size());
+    if (sendAllMotorCommands(zero_commands)) {
+        Logger::info("Emergency stop sent to all motors");
+    } else {
+        Logger::error("Emergency stop could not be sent to all motors");
+    }
+}
+
+// 停止所有I/O线程 (队列中剩余的帧会先发出) 并关闭设备
+void CANManager::stopBuses() {
+    for (auto& bus : buses_) {
+        {
+            std::lock_guard<std::mutex> lock(bus->mutex);
+            bus->running = false;
+        }
+        bus->tx_cv.notify_one();
+        if (bus->io_thread.joinable()) {
+            bus->io_thread.join();
+        }
+    }
+
+    for (int device_index : open_devices_) {
+        VCI_CloseDevice(CAN_DEVICE_TYPE, device_index);
+    }
+    open_devices_.clear();
+}
+
+void CANManager::shutdown() {
+    if (!is_connected_) {
+        return;
+    }
+
+    Logger::info("Shutting down CAN communication...");
+    emergencyStopAll();
+    logBusLoad();
+
+    std::lock_guard<std::mutex> lock(can_mutex_);
+    is_connected_ = false;
+    stopBuses();
+    Logger::info("CAN devices closed successfully");
+}
+
+// 按电机端PT模式格式编码命令
+void CANManager::motorDataToCanMessage(const MotorData& data, int motor_id, VCI_CAN_OBJ& msg) {
+    CanProtocol::MotorLimits limits = CanProtocol::getMotorLimits(motor_id);
+
+    int kp = float_to_uint(clamp(data.kp, CanProtocol::KP_MINX, CanProtocol::KP_MAXX),
+                           CanProtocol::KP_MINX, CanProtocol::KP_MAXX, 12);
+    int kd = float_to_uint(clamp(data.kd, CanProtocol::KD_MINX, CanProtocol::KD_MAXX),
+                           CanProtocol::KD_MINX, CanProtocol::KD_MAXX, 9);
+    int pos = float_to_uint(clamp(data.pos_des, CanProtocol::POS_MINX, CanProtocol::POS_MAXX),
+                            CanProtocol::POS_MINX, CanProtocol::POS_MAXX, 16);
+    int spd = float_to_uint(clamp(data.vel_des, CanProtocol::SPD_MINX, CanProtocol::SPD_MAXX),
+                            CanProtocol::SPD_MINX, CanProtocol::SPD_MAXX, 12);
+    int tor = float_to_uint(clamp(data.ff, limits.torque_min, limits.torque_max),
+                            limits.torque_min, limits.torque_max, 12);
+
+    std::memset(&msg, 0, sizeof(msg));
+    msg.ID = motor_id;
+    msg.DataLen = 8;
+    msg.Data[0] = (kp >> 7) & 0xFF;
+    msg.Data[1] = ((kp & 0x7F) << 1) | ((kd >> 8) & 0x1);
+    msg.Data[2] = kd & 0xFF;
+    msg.Data[3] = (pos >> 8) & 0xFF;
+    msg.Data[4] = pos & 0xFF;
+    msg.Data[5] = (spd >> 4) & 0xFF;
+    msg.Data[6] = ((spd & 0xF) << 4) | ((tor >> 8) & 0xF);
+    msg.Data[7] = tor & 0xFF;
+}
+
+// 按电机端PT模式反馈格式解析
+void CANManager::canMessageToMotorData(const VCI_CAN_OBJ& msg, int motor_id, MotorData& data) {
+    CanProtocol::MotorLimits limits = CanProtocol::getMotorLimits(motor_id);
+
+    int pos = (msg.Data[1] << 8) | msg.Data[2];
+    int spd = (msg.Data[3] << 4) | ((msg.Data[4] >> 4) & 0xF);
+    int cur = ((msg.Data[4] & 0xF) << 8) | msg.Data[5];
+
+    data.angle_actual_rad = uint_to_float(pos, CanProtocol::POS_MINX, CanProtocol::POS_MAXX, 16);
+    data.speed_actual_rad = uint_to_float(spd, CanProtocol::SPD_MINX, CanProtocol::SPD_MAXX, 12);
+    data.current_actual_float = uint_to_float(cur, limits.current_min, limits.current_max, 12);
+    data.temperature = (msg.Data[6] - 50) / 2.0;
+}
+
+} // namespace friction_test
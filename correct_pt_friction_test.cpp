@@ -5,17 +5,36 @@
 //
 
 #include "controlcan.h"
+#include "pt_protocol.h"
+#include "pt_batch_codec.h"
+#include "test_clock.h"
+#include "telemetry.h"
+#include "spsc_ring.h"
+#include "latency_histogram.h"
+#include "bus_load_monitor.h"
+#include "async_logger.h"
+#include "periodic_executor.h"
+#include "adapter_clock.h"
+#include "settle_detector.h"
+#include "thermal_model.h"
+#include "result_journal.h"
+#include "streaming_regression.h"
+#include "sim/controlcan_sim.h"
 #include <iostream>
 #include <unistd.h>
 #include <iomanip>
 #include <cstring>
 #include <vector>
+#include <map>
 #include <algorithm>
 #include <cmath>
 #include <fstream>
 #include <getopt.h>
 #include <chrono>
 #include <sstream>
+#include <thread>
+#include <atomic>
+#include <stdexcept>
 
 using namespace std;
 
@@ -27,7 +46,39 @@ using namespace std;
 #define DEVICE_INDEX 0
 #define CAN_INDEX 0
 
-// 32个关节的ID定义 (1-40, 覆盖32个实际关节)
+// 反馈槽覆盖的最大关节ID
+#define MAX_JOINT_ID 40
+static_assert(MAX_JOINT_ID <= JOINT_TOPOLOGY_MAX_ID, "joint topology must cover every feedback slot");
+// 接收线程单次读取的最大帧数
+#define RX_BATCH_SIZE 100
+// 发送返回0帧时的最大重试次数
+#define TX_MAX_RETRY 3
+// 接收线程到遥测写入线程的样本缓冲 (条)
+#define TELEMETRY_RING_SIZE 16384
+// 接收线程到斜坡分析的样本缓冲 (条)
+#define ANALYSIS_RING_SIZE 1024
+// 总线波特率 (Timing0=0x00, Timing1=0x14)
+#define CAN_BITRATE 1000000
+// 总线超限警告的最短间隔 (秒)
+#define BUS_WARN_INTERVAL_S 1.0
+// 限流时单次发送最多等待的时间 (毫秒)
+#define BUS_THROTTLE_MAX_WAIT_MS 100
+// 命令超过该时间 (秒) 仍无应答视为丢失，不计入往返时延
+#define RTT_REPLY_TIMEOUT_S 0.1
+// 静止位置估计: 零扭矩采样间隔 (毫秒) 和视为静止的速度 (rad/s)
+#define SETTLE_POLL_MS 2
+#define SETTLE_MAX_SPEED 0.05f
+// 冷却等待期间刷新温度反馈的间隔 (毫秒) 和单次冷却的最长时间 (秒)
+#define THERMAL_POLL_MS 1000
+#define THERMAL_MAX_WAIT_S 600.0
+// 总线扫描: 一轮命令全部发出后等待应答的时间 (毫秒) 和未应答关节的最多轮数
+#define DISCOVERY_TIMEOUT_MS 50
+#define DISCOVERY_ROUNDS 2
+// 速度扫描: 每段走过该比例的行程后才采样 (速度已稳定)，一段超过 行程/速度 的该倍数+1s 仍未走完视为失败
+#define SWEEP_SETTLE_FRACTION 0.3f
+#define SWEEP_TIMEOUT_FACTOR 3.0
+
+// 候选关节ID (1-40)，实际在线的32个关节由测试开始时的总线扫描确定
 const std::vector<int> ALL_JOINT_IDS = {
     1, 2, 3, 4, 5, 6, 7, 8, 9, 10,
     11, 12, 13, 14, 15, 16, 17, 18, 19, 20,
@@ -35,36 +86,10 @@ const std::vector<int> ALL_JOINT_IDS = {
     31, 32, 33, 34, 35, 36, 37, 38, 39, 40
 };
 
-// 电机参数定义 (根据提供的电机型号表)
-struct MotorParams {
-    string model;
-    float def_ratio;
-    float KT;
-    float T_MINX, T_MAXX;
-    float I_MINX, I_MAXX;
-    float KP_MINX, KP_MAXX;
-    float KD_MINX, KD_MAXX;
-    float POS_MINX, POS_MAXX;
-    float SPD_MINX, SPD_MAXX;
-};
-
-// 预定义的电机参数
-MotorParams motorParams[] = {
-    {"30-40",   101, 0.024f, -30.0f, 30.0f,   -30.0f, 30.0f,   0.0f, 500.0f, 0.0f, 5.0f, -12.5f, 12.5f, -18.0f, 18.0f},
-    {"40-52",   101, 0.05f,  -30.0f, 30.0f,   -30.0f, 30.0f,   0.0f, 500.0f, 0.0f, 5.0f, -12.5f, 12.5f, -18.0f, 18.0f},
-    {"50-60",   51,  0.089f, -13.2f, 13.2f,   -9.0f,  9.0f,    0.0f, 500.0f, 0.0f, 5.0f, -12.5f, 12.5f, -18.0f, 18.0f},
-    {"60-70",   51,  0.096f, -39.6f, 39.6f,   -20.0f, 20.0f,   0.0f, 500.0f, 0.0f, 5.0f, -12.5f, 12.5f, -18.0f, 18.0f},
-    {"70-80",   101, 0.118f, -30.0f, 30.0f,   -30.0f, 30.0f,   0.0f, 500.0f, 0.0f, 5.0f, -12.5f, 12.5f, -18.0f, 18.0f},
-    {"70-90",   51,  0.118f, -64.0f, 64.0f,   -22.0f, 22.0f,   0.0f, 500.0f, 0.0f, 5.0f, -12.5f, 12.5f, -18.0f, 18.0f},
-    {"80-110",  101, 0.143f, -30.0f, 30.0f,   -30.0f, 30.0f,   0.0f, 500.0f, 0.0f, 5.0f, -12.5f, 12.5f, -18.0f, 18.0f},
-    {"100-120", 51,  0.175f, -188.0f, 188.0f, -40.0f, 40.0f,   0.0f, 500.0f, 0.0f, 5.0f, -12.5f, 12.5f, -18.0f, 18.0f},
-    {"100-142", 101, 0.175f, -30.0f, 30.0f,   -30.0f, 30.0f,   0.0f, 500.0f, 0.0f, 5.0f, -12.5f, 12.5f, -18.0f, 18.0f},
-    {"110-170", 101, 0.293f, -30.0f, 30.0f,   -30.0f, 30.0f,   0.0f, 500.0f, 0.0f, 5.0f, -12.5f, 12.5f, -18.0f, 18.0f}
-};
-
 struct TestConfig {
     vector<int> motor_ids = {1};     // 支持多个电机ID
     int motor_type = 0;              // 电机型号索引
+    bool use_topology = false;       // 按关节拓扑表为每个关节选择电机型号 (忽略motor_type)
     float torque_start = 0.0f;
     float torque_step = 0.1f;
     float torque_max = 4.0f;
@@ -73,6 +98,69 @@ struct TestConfig {
     bool debug_mode = true;
     bool test_all_joints = false;
     string output_file = "pt_friction_results.txt";
+    bool parallel = false;           // 多关节交错并行测试
+    int batch_size = 4;              // 并行模式下同时测试的关节数
+    int tick_ms = 10;                // 并行模式调度周期
+    bool adaptive = false;           // 自适应搜索 (指数扩步 + 二分) 代替固定步进
+    float search_resolution = 0.0f;  // 自适应搜索分辨率，0表示电机12位扭矩量化步长
+    bool ramp = false;               // 连续扭矩斜坡代替阶梯
+    float ramp_rate = 1.0f;          // 斜坡斜率 (NM/s)
+    int ramp_hz = 500;               // 斜坡命令和采样频率
+    float ramp_speed_threshold = 0.05f;  // 斜坡起步判定速度 (rad/s)
+    string raw_file;                 // 原始数据CSV，空表示不保存
+    string telemetry_file;           // 二进制遥测文件，空表示不记录
+    bool station_bench = false;      // 测试结束后输出工位基准报告 (耗时/总线占用/对仿真真值的误差)
+    string bench_csv;                // 基准结果追加到CSV，空表示不保存
+    float bus_load_limit = 0.7f;     // 总线占用上限 (占容量的比例)，计划或实测超过时警告
+    bool bus_throttle = false;       // 超过上限时限流: 减小并行数/斜坡频率，发送前等待负载回落
+    RealtimeOptions realtime;        // 控制线程的实时设置 (SCHED_FIFO/绑定CPU/锁定内存)
+    float settle_error = 0.0f;       // 初始位置均值的标准误差要求 (rad)，0表示位置阈值的1/10
+    int settle_timeout_ms = 1000;    // 初始位置估计的最长时间，超时用已有样本
+    float max_temperature = 80.0f;   // 线圈温度上限 (°C)，预测峰值低于上限才开始下一个方向
+    string journal_file;             // 结果日志，空表示输出文件名加 .journal
+    bool resume = false;             // 从结果日志续测: 跳过已通过的关节
+    bool sweep = false;              // 静摩擦测完后做速度扫描，辨识库伦摩擦和粘性系数
+    float sweep_speed = 4.0f;        // 速度扫描的最高档速度 (rad/s)，各档均分到该速度
+    int sweep_levels = 4;            // 速度档数 (每档正反方向各一段)
+    float sweep_kd = 3.0f;           // 速度扫描的kd (前馈为测得的静摩擦力，kd维持速度)
+    float sweep_travel = 0.5f;       // 每段的行程 (rad)
+    float sweep_min_r_squared = 0.7f;  // 扭矩-速度拟合的最小决定系数，低于此值系数视为不可靠
+};
+
+// 单个关节测试的阶段，用于统计各阶段耗时
+enum JointStage {
+    STAGE_PREPARE = 0,  // 开始测试到第一个方向之前: 发零扭矩命令 (冷却等待单独统计)
+    STAGE_POSITIVE,     // 正向摩擦力测试
+    STAGE_RESET,        // 复位到中性位置
+    STAGE_NEGATIVE,     // 负向摩擦力测试
+    STAGE_SWEEP,        // 速度扫描 (--sweep)
+    JOINT_STAGE_COUNT
+};
+
+const char* const JOINT_STAGE_NAMES[JOINT_STAGE_COUNT] = {"准备", "正向", "复位", "负向", "速度扫描"};
+
+// 斜坡模式的一个反馈采样
+struct RampSample {
+    float time_s;                    // 相对斜坡开始的时间
+    float torque_nm;                 // 产生该反馈的命令扭矩 (带方向)
+    float position_rad;
+    float speed_rads;
+    float current_A;
+};
+
+// 速度扫描的一段: 命令速度 (带方向) 和稳定后反馈的平均速度、扭矩 (按方向折算为正)
+struct SweepPoint {
+    float speed_cmd = 0.0f;
+    float speed_rads = 0.0f;
+    float torque_nm = 0.0f;
+    int samples = 0;
+};
+
+// 一个方向上静摩擦力所在的区间: low处未起步，high处已起步
+struct FrictionBracket {
+    float low = 0.0f;
+    float high = 0.0f;
+    int steps = 0;                   // 施加过的测试扭矩次数
 };
 
 // 单个关节的测试结果
@@ -82,17 +170,285 @@ struct JointResult {
     float friction_positive = 0.0f;
     float friction_negative = 0.0f;
     float avg_friction = 0.0f;
+    FrictionBracket positive_bracket;
+    FrictionBracket negative_bracket;
+    vector<RampSample> positive_series;  // 斜坡模式的完整时间序列
+    vector<RampSample> negative_series;
+    float coulomb_friction = 0.0f;   // 速度扫描拟合的截距 (NM)
+    float viscous_coeff = 0.0f;      // 速度扫描拟合的斜率 (NM·s/rad)
+    float sweep_r_squared = 0.0f;
+    int sweep_samples = 0;           // 参与拟合的反馈数，0表示未做速度扫描
+    vector<SweepPoint> sweep_points;
     string error_message;
     double test_duration = 0.0;
+    double stage_time[JOINT_STAGE_COUNT] = {};  // 各阶段耗时 (秒)
+    uint64_t rtt_samples = 0;        // 命令到反馈的往返时延 (微秒)
+    uint32_t rtt_p50_us = 0;
+    uint32_t rtt_p99_us = 0;
+    uint32_t rtt_max_us = 0;
+    uint32_t rtt_lost = 0;           // 超时未应答的命令数
+    float max_coil_temp = NAN;       // 测试期间反馈的最高线圈温度 (°C)
+    double cooldown_s = 0.0;         // 开始方向前的冷却等待 (秒)
+    bool resumed = false;            // 从结果日志恢复的结果 (本次未测试)
+};
+
+// 总线扫描中应答的关节
+struct DiscoveredJoint {
+    int joint_id;
+    uint8_t motor_error;    // 反馈中的电机错误码，0表示正常
+    float coil_temp;
+    float board_temp;
+    double reply_ms;        // 该轮命令发出到收到应答的时间
+};
+
+// 一个方向上电机实际施加的扭矩大小: 12位扭矩量化后的第k档为 base + k × lsb (k ≥ 0)
+struct TorqueGrid {
+    float base = 0.0f;          // 该方向最小的正档位 (NM)
+    float lsb = 0.0f;           // 量化步长
+    
+    float Magnitude(int k) const {
+        return k < 0 ? 0.0f : base + k * lsb;
+    }
+    
+    // 不超过magnitude的最高档，低于base时为-1 (即零扭矩)
+    int Floor(float magnitude) const {
+        return static_cast<int>(floor((magnitude - base) / lsb + 1e-3f));
+    }
+    
+    // 第k档的命令扭矩 (带方向): 取该档量化区间的中点，电机端截断编码后正好落在该档
+    float Command(int k, float direction) const {
+        return direction * Magnitude(k) + 0.5f * lsb;
+    }
+};
+
+// 自适应静摩擦搜索: 先按翻倍的步长找到起步区间，再二分到要求的分辨率。
+// 试探扭矩取在电机的量化档位上 (档位下标)，区间两端都是实际施加过的扭矩；
+// 零扭矩 (下标-1) 在每次试探前的基准中施加过，视为已确认不起步。
+struct BreakawaySearch {
+    TorqueGrid grid;
+    int low = -1;               // 已确认不起步的最高档 (搜索下界)
+    bool low_probed = false;    // low是否试探过 (起始下界来自torque_start，未必试探过)
+    int high = -1;              // 已确认起步的最低档 (<0 表示尚未起步)
+    int step = 1;
+    int max_index = -1;
+    int resolution = 1;         // 二分结束时high-low的最大档数
+    int probes = 0;
+    int next = -1;
+    
+    void Reset(float start, float first_step, float max_t, float res, const TorqueGrid& torque_grid) {
+        grid = torque_grid;
+        low = max(-1, grid.Floor(start));
+        low_probed = low < 0;
+        high = -1;
+        step = max(1, static_cast<int>(lround(first_step / grid.lsb)));
+        max_index = grid.Floor(max_t);
+        resolution = max(1, static_cast<int>(lround(res / grid.lsb)));
+        probes = 0;
+        next = -1;
+    }
+    
+    bool Done() const {
+        if (high < 0) {
+            return low_probed && low >= max_index;
+        }
+        return high - low <= resolution && low_probed;
+    }
+    
+    // 下一次试探的扭矩大小 (档位上的值)
+    float NextTorque() {
+        if (high < 0) {
+            next = min(low + step, max_index);
+        } else if (high - low > resolution) {
+            next = low + (high - low) / 2;
+        } else {
+            next = low;     // 区间已够窄，但下界还没试探过
+        }
+        return grid.Magnitude(next);
+    }
+    
+    // 上一次NextTorque的命令扭矩 (带方向)
+    float NextCommand(float direction) const {
+        return grid.Command(next, direction);
+    }
+    
+    void Report(bool moved) {
+        probes++;
+        if (moved) {
+            high = next;
+            if (next == low) {
+                // 起始下界本身就起步了，继续向下确认
+                low = next - 1;
+                low_probed = low < 0;
+            }
+        } else {
+            low = next;
+            low_probed = true;
+            if (high < 0) {
+                step *= 2;
+            }
+        }
+    }
+    
+    // 未起步时按最大扭矩报告，与固定步进模式一致
+    float Result() const {
+        return grid.Magnitude(high < 0 ? max_index : high);
+    }
+    
+    FrictionBracket Bracket() const {
+        FrictionBracket bracket;
+        bracket.low = grid.Magnitude(high < 0 ? max_index : low);
+        bracket.high = Result();
+        bracket.steps = probes;
+        return bracket;
+    }
 };
 
 class CorrectPTTester {
 private:
     TestConfig config;
-    MotorParams currentMotor;
+    int joint_motor_type[MAX_JOINT_ID + 1];          // 每个关节的电机型号索引
+    const PTCodecOps* joint_codec[MAX_JOINT_ID + 1]; // 每个关节的编解码 (随型号在编译期特化)
     bool can_initialized = false;
     
-    void Sleep(int ms) { usleep(ms * 1000); }
+    // 待批量发送的PT命令 (结构数组，SendPTBatch时一次批量编码；容量复用，避免每个周期分配)
+    struct PTCommandArrays {
+        vector<int> motor_id;
+        vector<uint8_t> motor_type;
+        vector<float> kp, kd, pos, speed, torque;
+        
+        size_t size() const { return motor_id.size(); }
+        
+        void reserve(size_t n) {
+            motor_id.reserve(n); motor_type.reserve(n);
+            kp.reserve(n); kd.reserve(n); pos.reserve(n); speed.reserve(n); torque.reserve(n);
+        }
+        
+        void clear() {
+            motor_id.clear(); motor_type.clear();
+            kp.clear(); kd.clear(); pos.clear(); speed.clear(); torque.clear();
+        }
+    };
+    PTCommandArrays tx_commands;
+    vector<VCI_CAN_OBJ> tx_batch;
+    
+    RealTimeClock real_clock;
+    Clock* clock = &real_clock;     // 所有等待和计时都经过该时钟
+    
+    void Sleep(int ms) { clock->SleepMs(ms); }
+    
+    double last_run_duration = 0.0;
+    double last_run_cooldown = 0.0;
+    
+    // 总线负载 (发送在测试线程，接收在接收线程记录)
+    BusLoadMonitor bus_load{CAN_BITRATE};
+    BusLoadStats last_run_bus;
+    double last_run_peak_load = 0.0;
+    double bus_warn_time = -1e9;
+    
+    // 周期控制循环 (斜坡命令、并行调度) 的唤醒延迟和超时统计
+    PeriodicStats loop_stats;
+    
+    // 各关节的线圈热模型 (测试线程): 命令电流积分，反馈温度校正，决定开始方向前的冷却时间
+    CooldownScheduler thermal;
+    
+    // 结果日志: 每完成一个关节追加一条记录并fsync，--resume时从中恢复已通过的关节
+    ResultJournal journal;
+    vector<JointResult> resumed_results;
+    bool journal_failed = false;
+    
+    // 上一次总线扫描的结果: 应答的关节 (含报告错误码的) 和未应答的关节
+    vector<DiscoveredJoint> discovered;
+    vector<int> discovery_missing;
+    size_t discovery_candidates = 0;
+    double discovery_time = 0.0;
+    
+    // 调试输出: 收发/控制线程只放入定长记录，由日志线程格式化后写到终端
+    enum DebugEvent : uint16_t {
+        DEBUG_TX_FRAME = 1,
+        DEBUG_TX_SHORT,
+        DEBUG_RX_FRAME,
+        DEBUG_PT_COMMAND,
+        DEBUG_PT_BATCH,
+        DEBUG_PT_FEEDBACK
+    };
+    AsyncLogger debug_log{&CorrectPTTester::FormatDebugRecord};
+    
+    static LogRecord MakeLogRecord(uint16_t event, uint32_t id) {
+        LogRecord record;
+        memset(&record, 0, sizeof(record));
+        record.event = event;
+        record.id = id;
+        return record;
+    }
+    
+    void LogFrame(uint16_t event, const VCI_CAN_OBJ& frame) {
+        LogRecord record = MakeLogRecord(event, frame.ID);
+        record.len = min<uint8_t>(frame.DataLen, 8);
+        memcpy(record.data, frame.Data, record.len);
+        debug_log.Push(record);
+    }
+    
+    // 在日志线程中执行，输出与原来直接打印的格式相同
+    static void FormatDebugRecord(const LogRecord& record, ostream& out) {
+        switch (record.event) {
+            case DEBUG_TX_FRAME:
+            case DEBUG_RX_FRAME:
+                out << (record.event == DEBUG_TX_FRAME ? "[发送]" : "[接收]")
+                    << " ID: 0x" << hex << setfill('0') << setw(3) << record.id << " 数据: ";
+                for (int i = 0; i < record.len; i++) {
+                    out << hex << setfill('0') << setw(2) << (int)record.data[i] << " ";
+                }
+                out << dec;
+                break;
+            case DEBUG_TX_SHORT:
+                out << "[发送] 仅发出 " << (record.arg >> 32) << "/" << (record.arg & 0xFFFFFFFF) << " 帧";
+                break;
+            case DEBUG_PT_COMMAND:
+                out << "[PT命令] Motor:" << record.id << " KP:" << record.values[0] << " KD:" << record.values[1]
+                    << " Pos:" << record.values[2] << " Spd:" << record.values[3] << " Torque:" << record.values[4] << "NM";
+                break;
+            case DEBUG_PT_BATCH:
+                out << "[PT批量] " << record.arg << " 帧";
+                break;
+            case DEBUG_PT_FEEDBACK:
+                out << "PT反馈 Motor" << record.id << ": Pos=" << fixed << setprecision(4) << record.values[0]
+                    << "rad, Spd=" << record.values[1] << "rad/s, I=" << record.values[2]
+                    << "A, Err=" << (int)record.data[0] << " #" << record.arg;
+                break;
+        }
+    }
+    
+    // 按配置为每个关节选择电机型号: 拓扑表或统一型号
+    void ApplyMotorTypes() {
+        for (int id = 0; id <= MAX_JOINT_ID; id++) {
+            joint_motor_type[id] = config.use_topology ? jointMotorType(id) : config.motor_type;
+            joint_codec[id] = &ptCodecOps[joint_motor_type[id]];
+        }
+    }
+    
+    int MotorType(int motor_id) const {
+        return (motor_id >= 1 && motor_id <= MAX_JOINT_ID) ? joint_motor_type[motor_id] : config.motor_type;
+    }
+    
+    const MotorParams& Motor(int motor_id) const {
+        return motorParams[MotorType(motor_id)];
+    }
+    
+    const PTCodecOps& Codec(int motor_id) const {
+        return ptCodecOps[MotorType(motor_id)];
+    }
+    
+    // 输出端扭矩对应的线圈电流 (A)
+    float TorqueToCurrent(int motor_id, float torque_nm) const {
+        const MotorParams& motor = Motor(motor_id);
+        return torque_nm / (motor.KT * motor.def_ratio);
+    }
+    
+    // 反馈电流对应的输出端扭矩 (NM)
+    float CurrentToTorque(int motor_id, float current_A) const {
+        const MotorParams& motor = Motor(motor_id);
+        return current_A * motor.KT * motor.def_ratio;
+    }
     
     void InitCANConfig(VCI_INIT_CONFIG& can_config) {
         can_config.AccCode = 0x00000000;
@@ -104,83 +460,167 @@ private:
         can_config.Mode = 0;
     }
     
-    bool SendCANFrame(const VCI_CAN_OBJ& frame) {
+    // 一次VCI_Transmit发送连续存放的多帧，部分发送时重试剩余帧，返回实际发出的帧数
+    DWORD SendCANFrames(VCI_CAN_OBJ* frames, DWORD count) {
         if (config.debug_mode) {
-            cout << "[发送] ID: 0x" << hex << setfill('0') << setw(3) << frame.ID << " 数据: ";
-            for (int i = 0; i < frame.DataLen; i++) {
-                cout << hex << setfill('0') << setw(2) << (int)frame.Data[i] << " ";
+            for (DWORD n = 0; n < count; n++) {
+                LogFrame(DEBUG_TX_FRAME, frames[n]);
             }
-            cout << dec << endl;
         }
         
-        DWORD result = VCI_Transmit(DEVICE_TYPE, DEVICE_INDEX, CAN_INDEX, 
-                                    const_cast<VCI_CAN_OBJ*>(&frame), 1);
-        return (result == 1);
+        if (config.bus_throttle) {
+            ThrottleBus();
+        }
+        
+        DWORD sent = 0;
+        int retries = 0;
+        while (sent < count) {
+            DWORD result = VCI_Transmit(DEVICE_TYPE, DEVICE_INDEX, CAN_INDEX, frames + sent, count - sent);
+            if (result == (DWORD)-1) {
+                break;
+            }
+            if (result == 0 && ++retries > TX_MAX_RETRY) {
+                break;
+            }
+            sent += result;
+        }
+        
+        double now = clock->Now();
+        for (DWORD n = 0; n < sent; n++) {
+            StampCommand(frames[n].ID, now);
+        }
+        bus_load.RecordTx(frames, sent, now);
+        WarnBusLoad(now);
+        
+        if (sent < count && config.debug_mode) {
+            LogRecord record = MakeLogRecord(DEBUG_TX_SHORT, 0);
+            record.arg = (static_cast<uint64_t>(sent) << 32) | count;
+            debug_log.Push(record);
+        }
+        return sent;
     }
     
-    vector<VCI_CAN_OBJ> ReceiveCANFrames() {
-        vector<VCI_CAN_OBJ> frames;
-        VCI_CAN_OBJ buffer[10];
-        DWORD count = VCI_Receive(DEVICE_TYPE, DEVICE_INDEX, CAN_INDEX, buffer, 10, 0);
-        
-        for (DWORD i = 0; i < count; i++) {
-            frames.push_back(buffer[i]);
-            if (config.debug_mode) {
-                cout << "[接收] ID: 0x" << hex << setfill('0') << setw(3) << buffer[i].ID << " 数据: ";
-                for (int j = 0; j < buffer[i].DataLen; j++) {
-                    cout << hex << setfill('0') << setw(2) << (int)buffer[i].Data[j] << " ";
-                }
-                cout << dec << endl;
+    // 最近短窗口的总线占用超过上限时警告，至多每BUS_WARN_INTERVAL_S一次
+    void WarnBusLoad(double now) {
+        if (now - bus_warn_time < BUS_WARN_INTERVAL_S) {
+            return;
+        }
+        BusLoadStats window = bus_load.Window(BUS_LOAD_SHORT_WINDOW_S, now);
+        if (window.load > config.bus_load_limit) {
+            bus_warn_time = now;
+            cout << "⚠️ 总线占用 " << fixed << setprecision(1) << window.load * 100.0 << "% 超过上限 "
+                 << config.bus_load_limit * 100.0 << "% (" << setprecision(0) << window.FramesPerSecond() << " 帧/s)" << endl;
+        }
+    }
+    
+    // 限流: 短窗口占用回落到上限以下再发送，最多等待BUS_THROTTLE_MAX_WAIT_MS
+    void ThrottleBus() {
+        for (int waited = 0; waited < BUS_THROTTLE_MAX_WAIT_MS; waited++) {
+            if (bus_load.Window(BUS_LOAD_SHORT_WINDOW_S, clock->Now()).load <= config.bus_load_limit) {
+                return;
             }
+            Sleep(1);
         }
-        return frames;
     }
     
-    // 根据电机代码实现的转换函数
-    int float_to_uint(float x, float x_min, float x_max, int bits) {
-        float span = x_max - x_min;
-        float offset = x_min;
-        return (int)((x - offset) * ((float)((1 << bits) - 1)) / span);
+    bool SendCANFrame(const VCI_CAN_OBJ& frame) {
+        VCI_CAN_OBJ copy = frame;
+        return SendCANFrames(&copy, 1) == 1;
     }
     
-    float uint_to_float(int x_int, float x_min, float x_max, int bits) {
-        float span = x_max - x_min;
-        float offset = x_min;
-        return ((float)x_int) * span / ((float)((1 << bits) - 1)) + offset;
+    // 读取一批CAN帧到调用者提供的缓冲区，返回帧数
+    DWORD ReceiveCANFrames(VCI_CAN_OBJ* buffer, DWORD capacity) {
+        DWORD count = VCI_Receive(DEVICE_TYPE, DEVICE_INDEX, CAN_INDEX, buffer, capacity, 0);
+        if (count == (DWORD)-1) {
+            return 0;
+        }
+        bus_load.RecordRx(buffer, count, clock->Now());
+
+        if (config.debug_mode) {
+            for (DWORD i = 0; i < count; i++) {
+                LogFrame(DEBUG_RX_FRAME, buffer[i]);
+            }
+        }
+        return count;
     }
     
-    // 正确的PT模式命令发送 (基于电机端代码)
-    bool SendPTCommand(int motor_id, float kp, float kd, float target_pos_rad, float target_speed_rads, float target_torque_nm) {
-        VCI_CAN_OBJ frame;
+    // 按电机端代码的PT格式编码一帧
+    void EncodePTFrame(VCI_CAN_OBJ& frame, int motor_id, float kp, float kd, float target_pos_rad, float target_speed_rads, float target_torque_nm) {
         memset(&frame, 0, sizeof(frame));
         frame.ID = motor_id;
         frame.DataLen = 8;
         
-        // 将浮点参数转换为整数 (根据电机端代码)
-        int INThPT_KP = float_to_uint(kp, currentMotor.KP_MINX, currentMotor.KP_MAXX, 12);
-        int INThPT_KD = float_to_uint(kd, currentMotor.KD_MINX, currentMotor.KD_MAXX, 9);
-        int INTtargetpos_rad = float_to_uint(target_pos_rad, currentMotor.POS_MINX, currentMotor.POS_MAXX, 16);
-        int INTtargetspeed_rads = float_to_uint(target_speed_rads, currentMotor.SPD_MINX, currentMotor.SPD_MAXX, 12);
-        int INTtargettorque_NM = float_to_uint(target_torque_nm, currentMotor.T_MINX, currentMotor.T_MAXX, 12);
-        
-        // 根据电机端代码的解析方式编码数据
-        frame.Data[0] = (INThPT_KP >> 7) & 0xFF;
-        frame.Data[1] = ((INThPT_KP & 0x7F) << 1) | ((INThPT_KD >> 8) & 0x1);
-        frame.Data[2] = INThPT_KD & 0xFF;
-        frame.Data[3] = (INTtargetpos_rad >> 8) & 0xFF;
-        frame.Data[4] = INTtargetpos_rad & 0xFF;
-        frame.Data[5] = (INTtargetspeed_rads >> 4) & 0xFF;
-        frame.Data[6] = ((INTtargetspeed_rads & 0xF) << 4) | ((INTtargettorque_NM >> 8) & 0xF);
-        frame.Data[7] = INTtargettorque_NM & 0xFF;
+        // 按该关节电机型号的量化范围打包 (根据电机端代码的解析方式)
+        if (motor_id >= 1 && motor_id <= MAX_JOINT_ID) {
+            joint_codec[motor_id]->encode_command(frame.Data, kp, kd, target_pos_rad, target_speed_rads, target_torque_nm);
+            commanded_torque[motor_id].store(target_torque_nm, memory_order_relaxed);
+            thermal.Joint(motor_id).Command(TorqueToCurrent(motor_id, target_torque_nm), clock->Now());
+        } else {
+            Codec(motor_id).encode_command(frame.Data, kp, kd, target_pos_rad, target_speed_rads, target_torque_nm);
+        }
+    }
+    
+    // 正确的PT模式命令发送 (基于电机端代码)
+    bool SendPTCommand(int motor_id, float kp, float kd, float target_pos_rad, float target_speed_rads, float target_torque_nm) {
+        VCI_CAN_OBJ frame;
+        EncodePTFrame(frame, motor_id, kp, kd, target_pos_rad, target_speed_rads, target_torque_nm);
         
         if (config.debug_mode) {
-            cout << "[PT命令] Motor:" << motor_id << " KP:" << kp << " KD:" << kd << " Pos:" << target_pos_rad 
-                 << " Spd:" << target_speed_rads << " Torque:" << target_torque_nm << "NM" << endl;
+            LogRecord record = MakeLogRecord(DEBUG_PT_COMMAND, motor_id);
+            record.values[0] = kp;
+            record.values[1] = kd;
+            record.values[2] = target_pos_rad;
+            record.values[3] = target_speed_rads;
+            record.values[4] = target_torque_nm;
+            debug_log.Push(record);
         }
         
         return SendCANFrame(frame);
     }
     
+    // 加入一条PT命令到当前批次，由SendPTBatch一次发出
+    void AddPTCommand(int motor_id, float kp, float kd, float target_pos_rad, float target_speed_rads, float target_torque_nm) {
+        tx_commands.motor_id.push_back(motor_id);
+        tx_commands.motor_type.push_back(static_cast<uint8_t>(MotorType(motor_id)));
+        tx_commands.kp.push_back(kp);
+        tx_commands.kd.push_back(kd);
+        tx_commands.pos.push_back(target_pos_rad);
+        tx_commands.speed.push_back(target_speed_rads);
+        tx_commands.torque.push_back(target_torque_nm);
+    }
+    
+    // 批量编码并发送当前批次的所有PT命令 (单次VCI_Transmit)，返回实际发出的帧数并清空批次
+    size_t SendPTBatch() {
+        size_t count = tx_commands.size();
+        if (count == 0) {
+            return 0;
+        }
+        
+        if (config.debug_mode) {
+            LogRecord record = MakeLogRecord(DEBUG_PT_BATCH, 0);
+            record.arg = count;
+            debug_log.Push(record);
+        }
+        
+        PTCommandBatch batch = {tx_commands.motor_id.data(), tx_commands.motor_type.data(),
+                                tx_commands.kp.data(), tx_commands.kd.data(), tx_commands.pos.data(),
+                                tx_commands.speed.data(), tx_commands.torque.data(), count};
+        tx_batch.resize(count);
+        encodePTCommandBatch(batch, tx_batch.data());
+        double now = clock->Now();
+        for (size_t i = 0; i < count; i++) {
+            int motor_id = tx_commands.motor_id[i];
+            if (motor_id >= 1 && motor_id <= MAX_JOINT_ID) {
+                commanded_torque[motor_id].store(tx_commands.torque[i], memory_order_relaxed);
+                thermal.Joint(motor_id).Command(TorqueToCurrent(motor_id, tx_commands.torque[i]), now);
+            }
+        }
+        
+        size_t sent = SendCANFrames(tx_batch.data(), count);
+        tx_commands.clear();
+        return sent;
+    }
+    
     // 解析PT模式反馈数据
     struct PTFeedback {
         bool valid = false;
@@ -191,9 +631,67 @@ private:
         float coil_temp = 0.0f;
         float board_temp = 0.0f;
         uint8_t motor_error = 0;
+        uint64_t sequence = 0;      // 该关节收到的反馈帧序号 (从1开始)
+    };
+
+    // 每个关节ID一个反馈槽，接收线程写入，测试线程无锁读取 (seqlock)
+    struct FeedbackSlot {
+        atomic<uint32_t> version{0};
+        PTFeedback feedback;
+    };
+
+    // 接收线程交给其他线程的一条样本: 帧时刻 + 接收时该关节最近的命令扭矩 + 解码结果
+    struct FeedbackSample {
+        double time = 0.0;
+        float torque_cmd = 0.0f;
+        bool adapter_time = false;   // time是适配器硬件时间戳换算的帧上总线时刻，否则是主机接收时刻
+        PTFeedback feedback;
     };
+
+    FeedbackSlot feedback_slots[MAX_JOINT_ID + 1];
+    thread rx_thread;
+    atomic<bool> rx_running{false};
+    atomic<float> commanded_torque[MAX_JOINT_ID + 1] = {};
+    
+    // 适配器硬件时间戳换算到测试时钟 (仅接收线程更新)
+    AdapterClock adapter_clock;
+    
+    // 往返时延: 发送线程在VCI_Transmit返回时给命令打时间戳，接收线程用该ID的下一条反馈配对。
+    // 未应答期间再发的命令不覆盖时间戳，反馈总与最早的未应答命令配对。
+    // 反馈时刻取帧上总线的时刻 (适配器时间戳)，而不是接收线程读到它的时刻: 虚拟时间下时钟会一次跳过
+    // 仿真库的应答时刻，按读取时刻计算会把正常应答算成超时。
+    static constexpr double RTT_NONE = -1.0;
+    atomic<double> rtt_pending[MAX_JOINT_ID + 1];
+    atomic<uint32_t> rtt_lost[MAX_JOINT_ID + 1];
+    LatencyHistogram rtt_histograms[MAX_JOINT_ID + 1];
     
-    PTFeedback ParsePTFeedback(const VCI_CAN_OBJ& frame) {
+    // 遥测: 接收线程只把样本放进环形缓冲，由写入线程落盘，文件I/O不占用总线线程
+    SpscRing<FeedbackSample, TELEMETRY_RING_SIZE> telemetry_ring;
+    TelemetryWriter telemetry;
+    thread telemetry_thread;
+    atomic<bool> telemetry_running{false};
+    double telemetry_start = 0.0;
+    
+    // 斜坡分析: 接收线程把analysis_joint的每条反馈放进缓冲，分析端逐条消费，不会只看到最新一条
+    SpscRing<FeedbackSample, ANALYSIS_RING_SIZE> analysis_ring;
+    atomic<int> analysis_joint{0};
+
+    // 解析一批PT模式反馈: 位置/速度/电流按各关节型号批量解码，其余字段逐帧解析
+    void ParsePTFeedbackBatch(const VCI_CAN_OBJ* frames, DWORD count, PTFeedback* feedbacks) {
+        uint8_t types[RX_BATCH_SIZE];
+        float position[RX_BATCH_SIZE], speed[RX_BATCH_SIZE], current[RX_BATCH_SIZE];
+        for (DWORD i = 0; i < count; i++) {
+            types[i] = static_cast<uint8_t>(MotorType(frames[i].ID));
+        }
+        PTFeedbackBatch batch = {types, position, speed, current};
+        decodePTFeedbackBatch(frames, count, batch);
+        
+        for (DWORD i = 0; i < count; i++) {
+            feedbacks[i] = ParsePTFeedback(frames[i], position[i], speed[i], current[i]);
+        }
+    }
+    
+    PTFeedback ParsePTFeedback(const VCI_CAN_OBJ& frame, float position_rad, float speed_rads, float current_A) {
         PTFeedback feedback;
         feedback.motor_id = frame.ID;
         
@@ -203,14 +701,9 @@ private:
         
         // 根据电机端反馈代码解析数据
         feedback.motor_error = frame.Data[0] - 0x01;
-        
-        int INTpos_rad = (frame.Data[1] << 8) | frame.Data[2];
-        int INTspeed_rads = (frame.Data[3] << 4) | ((frame.Data[4] >> 4) & 0xF);
-        int INTcurrent_A = ((frame.Data[4] & 0xF) << 8) | frame.Data[5];
-        
-        feedback.position_rad = uint_to_float(INTpos_rad, currentMotor.POS_MINX, currentMotor.POS_MAXX, 16);
-        feedback.speed_rads = uint_to_float(INTspeed_rads, currentMotor.SPD_MINX, currentMotor.SPD_MAXX, 12);
-        feedback.current_A = uint_to_float(INTcurrent_A, currentMotor.I_MINX, currentMotor.I_MAXX, 12);
+        feedback.position_rad = position_rad;
+        feedback.speed_rads = speed_rads;
+        feedback.current_A = current_A;
         
         feedback.coil_temp = (frame.Data[6] - 50) / 2.0f;
         feedback.board_temp = (frame.Data[7] - 50) / 2.0f;
@@ -219,86 +712,388 @@ private:
         return feedback;
     }
     
-    // 获取特定电机的PT模式反馈
-    PTFeedback GetPTFeedback(int motor_id) {
+    // 记录一条命令的发送时刻；上一条命令仍在等待应答时保留它，已超时的计为丢失
+    void StampCommand(UINT motor_id, double now) {
+        if (motor_id < 1 || motor_id > MAX_JOINT_ID) {
+            return;
+        }
+        double pending = rtt_pending[motor_id].load(memory_order_acquire);
+        while (true) {
+            if (pending != RTT_NONE && now - pending < RTT_REPLY_TIMEOUT_S) {
+                return;
+            }
+            if (rtt_pending[motor_id].compare_exchange_weak(pending, now, memory_order_acq_rel)) {
+                if (pending != RTT_NONE) {
+                    rtt_lost[motor_id].fetch_add(1, memory_order_relaxed);
+                }
+                return;
+            }
+        }
+    }
+    
+    // 反馈与该关节最早的未应答命令配对，记录往返时延 (仅接收线程调用，frame_time为帧上总线的时刻)
+    void RecordRoundTrip(int motor_id, double frame_time) {
+        double sent = rtt_pending[motor_id].exchange(RTT_NONE, memory_order_acq_rel);
+        if (sent == RTT_NONE) {
+            return;
+        }
+        double rtt = frame_time - sent;
+        if (rtt < RTT_REPLY_TIMEOUT_S) {
+            rtt_histograms[motor_id].Record(static_cast<uint32_t>(max(0.0, rtt) * 1e6 + 0.5));
+        } else {
+            rtt_lost[motor_id].fetch_add(1, memory_order_relaxed);
+        }
+    }
+    
+    // 开始测试一个关节前清空它的时延统计
+    void ResetRoundTrip(int motor_id) {
+        rtt_pending[motor_id].store(RTT_NONE, memory_order_relaxed);
+        rtt_lost[motor_id].store(0, memory_order_relaxed);
+        rtt_histograms[motor_id].Reset();
+    }
+    
+    void CollectRoundTrip(JointResult& result) {
+        const LatencyHistogram& histogram = rtt_histograms[result.joint_id];
+        result.rtt_samples = histogram.Count();
+        result.rtt_p50_us = histogram.Percentile(50.0);
+        result.rtt_p99_us = histogram.Percentile(99.0);
+        result.rtt_max_us = histogram.Max();
+        result.rtt_lost = rtt_lost[result.joint_id].load(memory_order_relaxed);
+    }
+    
+    // 写入反馈槽 (仅接收线程调用)
+    void StoreFeedback(const PTFeedback& feedback) {
+        FeedbackSlot& slot = feedback_slots[feedback.motor_id];
+        uint32_t version = slot.version.load(memory_order_relaxed);
+        slot.version.store(version + 1, memory_order_relaxed);
+        atomic_thread_fence(memory_order_release);
+
+        uint64_t sequence = slot.feedback.sequence + 1;
+        slot.feedback = feedback;
+        slot.feedback.sequence = sequence;
+
+        slot.version.store(version + 2, memory_order_release);
+    }
+
+    // 读取反馈槽中的最新样本，不阻塞接收线程
+    PTFeedback LoadFeedback(int motor_id) {
         PTFeedback feedback;
-        
-        auto frames = ReceiveCANFrames();
-        for (const auto& frame : frames) {
-            if (frame.ID == motor_id) {
-                PTFeedback temp = ParsePTFeedback(frame);
-                if (temp.valid) {
-                    if (config.debug_mode) {
-                        cout << "PT反馈 Motor" << motor_id << ": Pos=" << fixed << setprecision(4) << temp.position_rad 
-                             << "rad, Spd=" << temp.speed_rads << "rad/s, I=" << temp.current_A 
-                             << "A, Err=" << (int)temp.motor_error << endl;
-                    }
-                    return temp;
+        if (motor_id < 1 || motor_id > MAX_JOINT_ID) {
+            return feedback;
+        }
+
+        const FeedbackSlot& slot = feedback_slots[motor_id];
+        uint32_t before, after;
+        do {
+            before = slot.version.load(memory_order_acquire);
+            feedback = slot.feedback;
+            atomic_thread_fence(memory_order_acquire);
+            after = slot.version.load(memory_order_relaxed);
+        } while ((before & 1) || before != after);
+
+        return feedback;
+    }
+
+    // 把解码后的反馈分发给遥测和分析缓冲 (仅接收线程调用，缓冲满时丢弃，从不等待)
+    void PublishFeedback(const PTFeedback& feedback, double frame_time, bool adapter_time) {
+        bool to_telemetry = telemetry_running.load(memory_order_relaxed);
+        bool to_analysis = analysis_joint.load(memory_order_relaxed) == feedback.motor_id;
+        if (!to_telemetry && !to_analysis) {
+            return;
+        }
+
+        FeedbackSample sample;
+        sample.time = frame_time;
+        sample.adapter_time = adapter_time;
+        sample.torque_cmd = commanded_torque[feedback.motor_id].load(memory_order_relaxed);
+        sample.feedback = feedback;
+        if (to_telemetry) {
+            telemetry_ring.TryPush(sample);
+        }
+        if (to_analysis) {
+            analysis_ring.TryPush(sample);
+        }
+    }
+
+    // 遥测写入线程: 取空缓冲后短暂休眠，停止时先写完缓冲中剩余的样本
+    void TelemetryLoop() {
+        FeedbackSample sample;
+        while (true) {
+            bool running = telemetry_running.load(memory_order_acquire);
+            while (telemetry_ring.TryPop(sample)) {
+                const PTFeedback& feedback = sample.feedback;
+                TelemetryRecord record;
+                record.time_ns = static_cast<uint64_t>(max(0.0, sample.time - telemetry_start) * 1e9);
+                record.joint_id = static_cast<uint8_t>(feedback.motor_id);
+                record.motor_error = feedback.motor_error;
+                record.coil_temp_raw = static_cast<uint8_t>(lround(feedback.coil_temp * 2.0f + 50.0f));
+                record.board_temp_raw = static_cast<uint8_t>(lround(feedback.board_temp * 2.0f + 50.0f));
+                record.torque_cmd = sample.torque_cmd;
+                record.position_rad = feedback.position_rad;
+                record.speed_rads = feedback.speed_rads;
+                record.current_A = feedback.current_A;
+                record.reserved = 0;
+                telemetry.Write(record);
+            }
+            if (!running) {
+                break;
+            }
+            this_thread::sleep_for(chrono::milliseconds(2));
+        }
+        telemetry.Flush();
+    }
+    
+    // 接收线程: 持续读取总线，把每一帧解码到对应关节的反馈槽
+    void ReceiveLoop() {
+        VCI_CAN_OBJ buffer[RX_BATCH_SIZE];
+        PTFeedback feedbacks[RX_BATCH_SIZE];
+
+        while (rx_running.load(memory_order_relaxed)) {
+            uint64_t generation = clock->Generation();
+            DWORD count = ReceiveCANFrames(buffer, RX_BATCH_SIZE);
+            ParsePTFeedbackBatch(buffer, count, feedbacks);
+            double now = clock->Now();
+
+            for (DWORD i = 0; i < count; i++) {
+                if (buffer[i].ID < 1 || buffer[i].ID > MAX_JOINT_ID) {
+                    continue;
+                }
+                // 同一批读到的帧主机时刻相同，适配器时间戳才是各帧实际上总线的时刻
+                bool adapter_time = buffer[i].TimeFlag != 0;
+                double frame_time = adapter_time ? adapter_clock.Update(buffer[i].TimeStamp, now) : now;
+                const PTFeedback& feedback = feedbacks[i];
+                if (feedback.valid) {
+                    RecordRoundTrip(feedback.motor_id, frame_time);
+                    StoreFeedback(feedback);
+                    PublishFeedback(feedback, frame_time, adapter_time);
                 }
             }
+
+            // 缓冲区已读空，等待下一轮 (虚拟时间下等待时间推进)
+            if (count < RX_BATCH_SIZE) {
+                clock->Idle(generation);
+            }
         }
-        
+    }
+
+    void StartReceiveThread() {
+        if (rx_running) {
+            return;
+        }
+        rx_running = true;
+        adapter_clock.Reset();
+        clock->AddFollower();
+        rx_thread = thread(&CorrectPTTester::ReceiveLoop, this);
+    }
+
+    void StopReceiveThread() {
+        if (!rx_running) {
+            return;
+        }
+        rx_running = false;
+        clock->Wake();
+        if (rx_thread.joinable()) {
+            rx_thread.join();
+        }
+        clock->RemoveFollower();
+    }
+
+    // 获取特定电机的最新PT模式反馈
+    PTFeedback GetPTFeedback(int motor_id) {
+        PTFeedback feedback = LoadFeedback(motor_id);
+
+        if (feedback.valid && config.debug_mode) {
+            LogRecord record = MakeLogRecord(DEBUG_PT_FEEDBACK, motor_id);
+            record.values[0] = feedback.position_rad;
+            record.values[1] = feedback.speed_rads;
+            record.values[2] = feedback.current_A;
+            record.data[0] = feedback.motor_error;
+            record.arg = feedback.sequence;
+            debug_log.Push(record);
+        }
+
         return feedback;
     }
+
+    // 等待序号大于after_sequence的新反馈，超时返回无效反馈
+    PTFeedback WaitForPTFeedback(int motor_id, uint64_t after_sequence, int timeout_ms) {
+        double deadline = clock->Now() + timeout_ms / 1000.0;
+
+        while (true) {
+            PTFeedback feedback = LoadFeedback(motor_id);
+            if (feedback.valid && feedback.sequence > after_sequence) {
+                return GetPTFeedback(motor_id);
+            }
+            if (clock->Now() >= deadline) {
+                return PTFeedback();
+            }
+            clock->SleepFor(0.0002);
+        }
+    }
+
+    // 发送PT命令并等待该命令对应的新反馈
+    PTFeedback RequestPTFeedback(int motor_id, float torque_nm, int timeout_ms) {
+        uint64_t last_sequence = LoadFeedback(motor_id).sequence;
+        if (!SendPTCommand(motor_id, 0.0f, 0.0f, 0.0f, 0.0f, torque_nm)) {
+            return PTFeedback();
+        }
+        return WaitForPTFeedback(motor_id, last_sequence, timeout_ms);
+    }
     
-    // 等待稳定的位置反馈
+    // 该关节静止判定的条件: 速度阈值不小于两个速度量化步长
+    SettleCriteria MakeSettleCriteria(int motor_id) const {
+        SettleCriteria criteria;
+        criteria.max_std_error = config.settle_error > 0 ? config.settle_error : config.position_threshold * 0.1f;
+        criteria.max_speed = max(SETTLE_MAX_SPEED, 2.0f * ptCodecOps[MotorType(motor_id)].speed_lsb);
+        return criteria;
+    }
+    
+    // 等待稳定的位置反馈: 连续发零扭矩采样，关节静止且均值的标准误差达到要求即返回，
+    // 最多等待settle_timeout_ms (超时用已有的静止样本，没有则用最后一个位置)
     float GetStablePosition(int motor_id) {
-        vector<float> positions;
+        SettleDetector settle(MakeSettleCriteria(motor_id));
+        double start = clock->Now();
+        double deadline = start + config.settle_timeout_ms / 1000.0;
         
-        for (int i = 0; i < 5; i++) {
-            SendPTCommand(motor_id, 0.0f, 0.0f, 0.0f, 0.0f, 0.0f);
-            Sleep(50);
-            
-            PTFeedback feedback = GetPTFeedback(motor_id);
-            if (feedback.valid) {
-                positions.push_back(feedback.position_rad);
+        while (clock->Now() < deadline) {
+            PTFeedback feedback = RequestPTFeedback(motor_id, 0.0f, 50);
+            if (feedback.valid && settle.Add(feedback.position_rad, feedback.speed_rads)) {
+                break;
             }
-            Sleep(50);
+            Sleep(SETTLE_POLL_MS);
         }
         
-        if (positions.empty()) {
+        if (settle.Samples() == 0) {
             return NAN;
         }
         
-        // 计算平均值
-        float mean = 0;
-        for (float pos : positions) {
-            mean += pos;
+        float position = settle.Count() > 0 ? settle.Mean() : settle.LastPosition();
+        if (!settle.Settled()) {
+            cout << "⚠️ Motor" << motor_id << " 位置未在 " << config.settle_timeout_ms << "ms 内稳定 (静止样本 "
+                 << settle.Count() << "/" << settle.Samples() << ")" << endl;
         }
-        mean /= positions.size();
         
         if (config.debug_mode) {
-            cout << "Motor" << motor_id << " 稳定位置: " << fixed << setprecision(4) << mean << " rad" << endl;
+            ostringstream line;
+            line << "Motor" << motor_id << " 稳定位置: " << fixed << setprecision(4) << position << " rad ("
+                 << settle.Count() << " 个样本, 标准误差 " << setprecision(5) << settle.StdError() << " rad, "
+                 << setprecision(0) << (clock->Now() - start) * 1000.0 << "ms)";
+            debug_log.PushText(line.str());
+        }
+        
+        return position;
+    }
+
+    // 用该关节最近一次反馈的线圈/驱动板温度校正热模型
+    void ObserveTemperature(int motor_id) {
+        PTFeedback feedback = LoadFeedback(motor_id);
+        if (feedback.valid) {
+            thermal.Joint(motor_id).Observe(feedback.coil_temp, feedback.board_temp, clock->Now());
+        }
+    }
+
+    // 一个方向发热量的上限估计: 扭矩从torque_start一直加到上限都未起步
+    ThermalLoad PlannedDirectionLoad(int motor_id) {
+        ThermalLoad load;
+        float limit = DirectionTorqueLimit(motor_id, 1.0f);
+        if (config.ramp) {
+            float i0 = TorqueToCurrent(motor_id, config.torque_start);
+            float i1 = TorqueToCurrent(motor_id, limit);
+            load.duration_s = max(0.0f, limit - config.torque_start) / config.ramp_rate;
+            load.i2_seconds = (i0 * i0 + i0 * i1 + i1 * i1) / 3.0 * load.duration_s;
+        } else if (config.torque_step > 0) {
+            double dwell = config.wait_time_ms / 1000.0;
+            for (float torque = config.torque_start; torque <= limit; torque += config.torque_step) {
+                float current = TorqueToCurrent(motor_id, torque);
+                load.i2_seconds += current * current * dwell;
+                load.duration_s += dwell;
+            }
+        }
+        return load;
+    }
+
+    // 开始一个方向前还需冷却的时间 (秒): 测过一个方向后按实际发热量预测，否则按上限估计
+    double CooldownTime(int motor_id) {
+        ObserveTemperature(motor_id);
+        return thermal.WaitTime(motor_id, PlannedDirectionLoad(motor_id));
+    }
+
+    void PrintCooldown(int motor_id, double wait) {
+        const ThermalModel& joint = thermal.Joint(motor_id);
+        ostringstream line;
+        line << "🌡️ Motor" << motor_id << " 线圈 " << fixed << setprecision(1) << joint.Coil() << "°C, 驱动板 "
+             << joint.Board() << "°C, 预测峰值将超过 " << thermal.Limit() << "°C, ";
+        if (isinf(wait)) {
+            line << "等待驱动板降温...";
+        } else {
+            line << "冷却约 " << wait << " 秒...";
+        }
+        cout << line.str() << endl;
+    }
+
+    // 等到关节的预测峰值温度低于上限 (期间定期发零扭矩刷新温度反馈)，返回等待的时间；超过THERMAL_MAX_WAIT_S抛出异常
+    double WaitForCooldown(int motor_id) {
+        double wait = CooldownTime(motor_id);
+        if (wait <= 0) {
+            return 0.0;
+        }
+
+        PrintCooldown(motor_id, wait);
+        double start = clock->Now();
+        while (wait > 0) {
+            if (clock->Now() - start > THERMAL_MAX_WAIT_S) {
+                ostringstream message;
+                message << "冷却超时: 线圈 " << fixed << setprecision(1) << thermal.Joint(motor_id).Coil() << "°C";
+                throw runtime_error(message.str());
+            }
+            Sleep(static_cast<int>(ceil(min(wait, THERMAL_POLL_MS / 1000.0) * 1000.0)));
+            RequestPTFeedback(motor_id, 0.0f, 100);
+            wait = CooldownTime(motor_id);
+        }
+
+        double waited = clock->Now() - start;
+        thermal.RecordWait(waited);
+        last_run_cooldown += waited;
+        return waited;
+    }
+
+    // 判断关节是否已经起步: 相对初始位置超过阈值，且最近几次位置按测试方向持续变化
+    bool DetectBreakaway(float initial_pos, const vector<float>& recent_positions, float direction) {
+        if (recent_positions.size() < 3) {
+            return false;
         }
         
-        return mean;
+        float position_change = fabs(recent_positions.back() - initial_pos);
+        if (position_change <= config.position_threshold) {
+            return false;
+        }
+        
+        float trend = recent_positions.back() - recent_positions[0];
+        float expected_direction = (direction > 0) ? 1.0f : -1.0f;
+        return trend * expected_direction > 0 && fabs(trend) > config.position_threshold * 0.5f;
+    }
+    
+    // 计算平均摩擦力并标记通过
+    void FinalizeJointResult(JointResult& result) {
+        if (result.friction_negative < 0.05f && result.friction_positive > 0.5f) {
+            result.avg_friction = result.friction_positive;
+        } else {
+            result.avg_friction = (result.friction_positive + result.friction_negative) / 2.0f;
+        }
+        result.test_passed = true;
     }
     
     // 测试单个电机的摩擦力
-    float TestFrictionInDirection(int motor_id, float direction) {
+    float TestFrictionInDirection(int motor_id, float direction, FrictionBracket& bracket) {
         cout << "\n测试Motor" << motor_id << " " << (direction > 0 ? "正" : "负") << "向摩擦力..." << endl;
         
         // 获取初始位置
-        vector<float> initial_positions;
-        for (int i = 0; i < 3; i++) {
-            float pos = GetStablePosition(motor_id);
-            if (!isnan(pos)) {
-                initial_positions.push_back(pos);
-            }
-            Sleep(200);
-        }
-        
-        if (initial_positions.empty()) {
+        float initial_pos = GetStablePosition(motor_id);
+        if (isnan(initial_pos)) {
             cout << "无法获取Motor" << motor_id << "初始位置！" << endl;
             return 0.0f;
         }
         
-        float initial_pos = 0;
-        for (float pos : initial_positions) {
-            initial_pos += pos;
-        }
-        initial_pos /= initial_positions.size();
-        
         cout << "Motor" << motor_id << " 初始位置: " << fixed << setprecision(4) << initial_pos << " rad" << endl;
         
         float test_torque = config.torque_start;
@@ -308,12 +1103,13 @@ private:
             float actual_torque = test_torque * direction;
             
             // 限制扭矩在电机范围内
-            if (actual_torque < currentMotor.T_MINX || actual_torque > currentMotor.T_MAXX) {
+            if (actual_torque < Motor(motor_id).T_MINX || actual_torque > Motor(motor_id).T_MAXX) {
                 test_torque += config.torque_step;
                 continue;
             }
             
             cout << "Motor" << motor_id << " 测试扭矩: " << fixed << setprecision(3) << actual_torque << " NM" << endl;
+            bracket.steps++;
             
             if (!SendPTCommand(motor_id, 0.0f, 0.0f, 0.0f, 0.0f, actual_torque)) {
                 cout << "发送PT命令失败！" << endl;
@@ -322,57 +1118,806 @@ private:
             
             Sleep(config.wait_time_ms);
             
-            // 获取反馈
-            vector<PTFeedback> feedbacks;
-            for (int i = 0; i < 3; i++) {
-                PTFeedback feedback = GetPTFeedback(motor_id);
-                if (feedback.valid) {
-                    feedbacks.push_back(feedback);
-                }
-                Sleep(50);
-            }
-            
-            if (feedbacks.empty()) {
+            // 保持扭矩不变再发一次，取这次命令的应答作为等待结束时的位置
+            PTFeedback current_feedback = RequestPTFeedback(motor_id, actual_torque, 150);
+            if (!current_feedback.valid) {
                 cout << "获取Motor" << motor_id << "反馈失败！" << endl;
                 continue;
             }
-            
-            PTFeedback current_feedback = feedbacks.back();
+
             float position_change = fabs(current_feedback.position_rad - initial_pos);
             
             recent_positions.push_back(current_feedback.position_rad);
             if (recent_positions.size() > 5) {
                 recent_positions.erase(recent_positions.begin());
             }
-            
-            cout << "位置变化: " << fixed << setprecision(4) << position_change << " rad";
-            cout << ", 电流: " << current_feedback.current_A << " A" << endl;
-            
-            // 检查是否超过阈值
-            if (position_change > config.position_threshold) {
-                if (recent_positions.size() >= 3) {
-                    float trend = recent_positions.back() - recent_positions[0];
-                    float expected_direction = (direction > 0) ? 1.0f : -1.0f;
+            
+            cout << "位置变化: " << fixed << setprecision(4) << position_change << " rad";
+            cout << ", 电流: " << current_feedback.current_A << " A" << endl;
+            
+            if (DetectBreakaway(initial_pos, recent_positions, direction)) {
+                cout << "🎯 Motor" << motor_id << " 检测到显著移动！静摩擦力约为: " << test_torque << " NM" << endl;
+                
+                SendPTCommand(motor_id, 0.0f, 0.0f, 0.0f, 0.0f, 0.0f);
+                Sleep(500);
+                bracket.low = max(config.torque_start, test_torque - config.torque_step);
+                bracket.high = test_torque;
+                return test_torque;
+            }
+            
+            test_torque += config.torque_step;
+        }
+        
+        cout << "Motor" << motor_id << " 达到最大扭矩，未检测到明显移动" << endl;
+        SendPTCommand(motor_id, 0.0f, 0.0f, 0.0f, 0.0f, 0.0f);
+        bracket.low = bracket.high = config.torque_max;
+        return config.torque_max;
+    }
+    
+    // 由斜坡序列回推起步扭矩: 起步后驱动扭矩超出静摩擦的部分随斜坡线性增长，速度近似按
+    // (T - T0)^2 增长，对起步后各采样拟合 sqrt(速度) 与扭矩的直线，截距处即T0。
+    // 数据不足或拟合结果不合理时返回fallback。
+    float EstimateBreakawayTorque(int motor_id, const vector<RampSample>& series, float direction, float fallback) {
+        if (series.size() < 4) {
+            return fallback;
+        }
+        
+        float speed_lsb = Codec(motor_id).speed_lsb;
+        float rest_speed = series.front().speed_rads * direction;
+        
+        // 最后一个仍处于静止读数的采样之后即为起步段
+        size_t first = series.size();
+        while (first > 0 && (series[first - 1].speed_rads * direction - rest_speed) > speed_lsb * 0.5f) {
+            first--;
+        }
+        if (series.size() - first < 3) {
+            return fallback;
+        }
+        
+        double sx = 0, sy = 0, sxx = 0, sxy = 0;
+        int n = 0;
+        for (size_t i = first; i < series.size(); i++) {
+            double x = series[i].torque_nm * direction;
+            double y = sqrt(max(0.0f, series[i].speed_rads * direction - rest_speed));
+            sx += x;
+            sy += y;
+            sxx += x * x;
+            sxy += x * y;
+            n++;
+        }
+        double denom = n * sxx - sx * sx;
+        if (denom <= 0) {
+            return fallback;
+        }
+        double slope = (n * sxy - sx * sy) / denom;
+        double intercept = (sy - slope * sx) / n;
+        if (slope <= 0) {
+            return fallback;
+        }
+        
+        // 速度量化会掩盖起步最初的一段，T0 早于第一个可见运动的采样是正常的
+        float torque0 = static_cast<float>(-intercept / slope);
+        if (torque0 < series.front().torque_nm * direction || torque0 > fallback) {
+            return fallback;
+        }
+        return torque0;
+    }
+    
+    // 斜坡序列给出的静摩擦力区间，两端都是电机实际施加过的扭矩档位:
+    // high为首个运动读数出现时的档位，low为其下方整档保持期间都是静止读数的最高档位 (没有则为0)。
+    // 运动读数: 速度或位置读数沿测试方向离开首个采样所在的量化档位。
+    // 起步初期的蠕动低于量化步长，同一档位内先出现的静止读数不能说明该档位未起步
+    void RampBracket(int motor_id, const vector<RampSample>& series, float direction, FrictionBracket& bracket) {
+        const PTCodecOps& codec = Codec(motor_id);
+        size_t first_moving = 0;
+        while (first_moving < series.size()) {
+            const RampSample& sample = series[first_moving];
+            if ((sample.speed_rads - series.front().speed_rads) * direction > codec.speed_lsb * 0.5f ||
+                (sample.position_rad - series.front().position_rad) * direction > codec.position_lsb * 0.5f) {
+                break;
+            }
+            first_moving++;
+        }
+        if (first_moving == series.size()) {
+            return;
+        }
+        bracket.high = AppliedTorque(motor_id, series[first_moving].torque_nm);
+        bracket.low = 0.0f;
+        for (size_t i = first_moving; i-- > 0;) {
+            float applied = AppliedTorque(motor_id, series[i].torque_nm);
+            if (applied < bracket.high) {
+                bracket.low = applied;
+                break;
+            }
+        }
+    }
+    
+    // 斜坡测试一个方向的静摩擦力: 以ramp_hz频率发送线性增长的扭矩，每个周期从分析缓冲取出
+    // 上个周期以来收到的所有反馈，速度连续两个采样超过阈值或位移超过位置阈值即判定起步并立即撤掉扭矩。
+    // 每条反馈带着接收线程收到它时该关节最近的命令扭矩，即产生它的那条命令。
+    float RampFrictionInDirection(int motor_id, float direction, FrictionBracket& bracket, vector<RampSample>& series) {
+        cout << "\n斜坡测试Motor" << motor_id << " " << (direction > 0 ? "正" : "负") << "向摩擦力 ("
+             << config.ramp_rate << " NM/s, " << config.ramp_hz << " Hz)..." << endl;
+        
+        float initial_pos = GetStablePosition(motor_id);
+        if (isnan(initial_pos)) {
+            cout << "无法获取Motor" << motor_id << "初始位置！" << endl;
+            return 0.0f;
+        }
+        
+        float limit = DirectionTorqueLimit(motor_id, direction);
+        double period = 1.0 / config.ramp_hz;
+        float torque_per_tick = static_cast<float>(config.ramp_rate * period);
+        
+        series.clear();
+        series.reserve(static_cast<size_t>((limit - config.torque_start) / torque_per_tick) + 2);
+        
+        float onset_torque = -1.0f;         // 速度首次超过阈值时的命令扭矩
+        int moving_samples = 0;
+        // 按绝对时刻排周期，发送和读取的耗时不累积
+        PeriodicExecutor executor(clock, period, loop_stats);
+        executor.Start();
+        double start = executor.StartTime();
+        double last_reply = start;
+        
+        // 只订阅本关节，丢掉订阅生效前残留的样本
+        analysis_joint.store(motor_id, memory_order_relaxed);
+        analysis_ring.Discard();
+        uint64_t overruns = analysis_ring.Overruns();
+        
+        while (true) {
+            double now = clock->Now();
+            // 超时跳过的周期也计入，扭矩按时间而不是按发出的命令数增长
+            int tick = static_cast<int>(executor.Index());
+            
+            FeedbackSample sample;
+            bool detected_motion = false;
+            while (!detected_motion && analysis_ring.TryPop(sample)) {
+                const PTFeedback& feedback = sample.feedback;
+                if (feedback.motor_id != motor_id) {
+                    continue;
+                }
+                last_reply = now;
+                
+                // 有硬件时间戳时按帧上总线的时刻找出当时生效的斜坡命令；
+                // USB批量到达时接收时刻可能已晚于后续命令，接收时的命令扭矩会偏大
+                float torque_cmd = sample.torque_cmd;
+                if (sample.adapter_time && sample.time >= start) {
+                    int command = min(tick, static_cast<int>((sample.time - start) / period));
+                    torque_cmd = (config.torque_start + torque_per_tick * command) * direction;
+                }
+                series.push_back({static_cast<float>(sample.time - start), torque_cmd,
+                                  feedback.position_rad, feedback.speed_rads, feedback.current_A});
+                
+                if (feedback.speed_rads * direction > config.ramp_speed_threshold) {
+                    if (moving_samples++ == 0) {
+                        onset_torque = fabs(torque_cmd);
+                    }
+                } else {
+                    moving_samples = 0;
+                }
+                
+                bool displaced = (feedback.position_rad - initial_pos) * direction > config.position_threshold;
+                if (moving_samples >= 2 || displaced) {
+                    detected_motion = true;
+                    if (moving_samples == 0) {
+                        onset_torque = fabs(torque_cmd);
+                    }
+                }
+            }
+            
+            if (detected_motion) {
+                SendPTCommand(motor_id, 0.0f, 0.0f, 0.0f, 0.0f, 0.0f);
+                analysis_joint.store(0, memory_order_relaxed);
+                WarnAnalysisOverruns(motor_id, overruns);
+                // 区间两端都是实际施加过的扭矩档位 (见RampBracket)，序列中没有运动读数时上界取判定时刻的档位；
+                // 回推的起步扭矩是另行给出的估计值，可能落在区间之外
+                float detected = onset_torque;
+                float breakaway = EstimateBreakawayTorque(motor_id, series, direction, detected);
+                bracket.low = 0.0f;
+                bracket.high = AppliedTorque(motor_id, detected * direction);
+                RampBracket(motor_id, series, direction, bracket);
+                bracket.steps = tick;
+                cout << "🎯 Motor" << motor_id << " 斜坡起步扭矩: " << fixed << setprecision(3) << breakaway
+                     << " NM (区间 [" << bracket.low << ", " << bracket.high << "], " << tick << "个周期, "
+                     << series.size() << "个采样)" << endl;
+                Sleep(500);
+                return breakaway;
+            }
+            if (now - last_reply > 0.1) {
+                SendPTCommand(motor_id, 0.0f, 0.0f, 0.0f, 0.0f, 0.0f);
+                analysis_joint.store(0, memory_order_relaxed);
+                throw runtime_error("斜坡测试中丢失反馈");
+            }
+            
+            float torque = config.torque_start + torque_per_tick * tick;
+            if (torque > limit) {
+                break;
+            }
+            SendPTCommand(motor_id, 0.0f, 0.0f, 0.0f, 0.0f, torque * direction);
+            executor.WaitNext();
+        }
+        
+        cout << "Motor" << motor_id << " 达到最大扭矩，未检测到明显移动" << endl;
+        SendPTCommand(motor_id, 0.0f, 0.0f, 0.0f, 0.0f, 0.0f);
+        analysis_joint.store(0, memory_order_relaxed);
+        WarnAnalysisOverruns(motor_id, overruns);
+        bracket.low = bracket.high = limit;
+        return limit;
+    }
+    
+    // 分析缓冲满丢过样本时提示 (斜坡序列不完整，回推结果可信度下降)
+    void WarnAnalysisOverruns(int motor_id, uint64_t overruns_before) {
+        uint64_t dropped = analysis_ring.Overruns() - overruns_before;
+        if (dropped > 0) {
+            cout << "⚠️ Motor" << motor_id << " 斜坡分析缓冲满，丢弃 " << dropped << " 个采样" << endl;
+        }
+    }
+    
+    // 速度扫描: 在一次连续运动中依次保持sweep_levels档速度，每档先正向再负向各走sweep_travel，换向时不停顿。
+    // 用PT的速度项维持速度: 前馈为该方向测得的静摩擦力，kd只需补偿随速度变化的部分。
+    // 每段走过SWEEP_SETTLE_FRACTION的行程后累计反馈的速度和电流换算的扭矩 (按方向折算)，段结束时把平均值
+    // 加入流式回归 扭矩 = 库伦摩擦 + 粘性系数 × 速度，截距为库伦摩擦，斜率为粘性系数。
+    // 用段平均而不是单个反馈拟合，R²衡量的是库伦+粘性模型是否成立 (如正反向不对称)，而不是反馈噪声。
+    // 大扭矩电机12位电流的量化步长 (100-120型约0.17NM) 与各档之间的扭矩差相当，粘性小时R²可能偏低:
+    // 低于sweep_min_r_squared只提示系数不可靠，不影响静摩擦的结果。
+    void SweepFriction(int motor_id, JointResult& result) {
+        int levels = max(1, config.sweep_levels);
+        cout << "\n速度扫描Motor" << motor_id << " (" << levels << "档, 最高 " << config.sweep_speed << " rad/s, kd "
+             << config.sweep_kd << ", 每段 " << config.sweep_travel << " rad, " << config.ramp_hz << " Hz)..." << endl;
+        
+        float initial_pos = GetStablePosition(motor_id);
+        if (isnan(initial_pos)) {
+            throw runtime_error("速度扫描无法获取初始位置");
+        }
+        
+        const MotorParams& motor = Motor(motor_id);
+        double period = 1.0 / config.ramp_hz;
+        StreamingRegression fit;
+        result.sweep_points.clear();
+        result.sweep_samples = 0;
+        
+        PeriodicExecutor executor(clock, period, loop_stats);
+        executor.Start();
+        double last_reply = executor.StartTime();
+        
+        analysis_joint.store(motor_id, memory_order_relaxed);
+        analysis_ring.Discard();
+        uint64_t overruns = analysis_ring.Overruns();
+        auto stop = [&]() {
+            SendPTCommand(motor_id, 0.0f, 0.0f, 0.0f, 0.0f, 0.0f);
+            analysis_joint.store(0, memory_order_relaxed);
+        };
+        
+        float position = initial_pos;
+        for (int level = 1; level <= levels; level++) {
+            float speed = config.sweep_speed * level / levels;
+            for (float direction : {1.0f, -1.0f}) {
+                float friction = direction > 0 ? result.friction_positive : result.friction_negative;
+                float feedforward = max(motor.T_MINX, min(motor.T_MAXX, friction * direction));
+                float segment_start = position;
+                double deadline = clock->Now() + config.sweep_travel / speed * SWEEP_TIMEOUT_FACTOR + 1.0;
+                
+                SweepPoint point;
+                point.speed_cmd = speed * direction;
+                double speed_sum = 0.0, torque_sum = 0.0;
+                bool done = false;
+                while (!done) {
+                    double now = clock->Now();
+                    FeedbackSample sample;
+                    while (!done && analysis_ring.TryPop(sample)) {
+                        const PTFeedback& feedback = sample.feedback;
+                        if (feedback.motor_id != motor_id) {
+                            continue;
+                        }
+                        last_reply = now;
+                        position = feedback.position_rad;
+                        
+                        // 换向段先减速越过起点，行程从负值开始
+                        float travelled = (feedback.position_rad - segment_start) * direction;
+                        float speed_along = feedback.speed_rads * direction;
+                        if (travelled >= config.sweep_travel) {
+                            done = true;
+                        } else if (travelled >= config.sweep_travel * SWEEP_SETTLE_FRACTION &&
+                                   speed_along > config.ramp_speed_threshold) {
+                            // 电机端截断编码电流，取量化区间的中点，否则正反向扭矩相差约一个步长
+                            float current = feedback.current_A + 0.5f * Codec(motor_id).current_lsb;
+                            float torque_along = CurrentToTorque(motor_id, current) * direction;
+                            speed_sum += speed_along;
+                            torque_sum += torque_along;
+                            point.samples++;
+                        }
+                    }
+                    if (done) {
+                        break;
+                    }
+                    if (now - last_reply > 0.1) {
+                        stop();
+                        throw runtime_error("速度扫描中丢失反馈");
+                    }
+                    if (now > deadline) {
+                        stop();
+                        ostringstream message;
+                        message << "速度扫描 " << showpos << point.speed_cmd << noshowpos << " rad/s 未走完行程";
+                        throw runtime_error(message.str());
+                    }
+                    SendPTCommand(motor_id, 0.0f, config.sweep_kd, 0.0f, point.speed_cmd, feedforward);
+                    executor.WaitNext();
+                }
+                
+                if (point.samples > 0) {
+                    point.speed_rads = static_cast<float>(speed_sum / point.samples);
+                    point.torque_nm = static_cast<float>(torque_sum / point.samples);
+                    fit.Add(point.speed_rads, point.torque_nm);
+                    result.sweep_samples += point.samples;
+                }
+                result.sweep_points.push_back(point);
+                if (config.debug_mode) {
+                    cout << "  段 " << showpos << fixed << setprecision(2) << point.speed_cmd << noshowpos
+                         << " rad/s: 平均速度 " << point.speed_rads << " rad/s, 扭矩 " << setprecision(3)
+                         << point.torque_nm << " NM (" << point.samples << "个采样)" << endl;
+                }
+            }
+        }
+        stop();
+        WarnAnalysisOverruns(motor_id, overruns);
+        
+        result.coulomb_friction = static_cast<float>(fit.Intercept());
+        result.viscous_coeff = static_cast<float>(fit.Slope());
+        result.sweep_r_squared = static_cast<float>(fit.RSquared());
+        cout << "🎯 Motor" << motor_id << " 库伦摩擦: " << fixed << setprecision(3) << result.coulomb_friction
+             << " NM, 粘性系数: " << setprecision(4) << result.viscous_coeff << " NM·s/rad (R²="
+             << setprecision(3) << result.sweep_r_squared << ", " << fit.Count() << "段, "
+             << result.sweep_samples << "个采样)" << endl;
+        if (!SweepFitAccepted(result)) {
+            cout << "⚠️ Motor" << motor_id << " 速度扫描拟合R²低于 " << config.sweep_min_r_squared
+                 << "，库伦/粘性系数不可靠" << endl;
+        }
+    }
+    
+    bool SweepFitAccepted(const JointResult& result) const {
+        return result.sweep_samples > 0 && result.sweep_r_squared >= config.sweep_min_r_squared;
+    }
+    
+    // 自适应搜索的分辨率: 未指定时取电机12位扭矩量化步长，更细没有意义
+    float SearchResolution(int motor_id) {
+        return max(config.search_resolution, Codec(motor_id).torque_lsb);
+    }
+    
+    // 该方向上电机能施加的扭矩档位: 电机端按 (int)((t - T_MIN) × 4095 / 量程) 截断编码，
+    // 正向最小的正档位是零点以上的第一个编码，负向是零点以下的第一个编码
+    TorqueGrid DirectionGrid(int motor_id, float direction) const {
+        TorqueGrid grid;
+        grid.lsb = Codec(motor_id).torque_lsb;
+        double zero = -Motor(motor_id).T_MINX / grid.lsb;
+        double code = direction > 0 ? ceil(zero - 1e-3) : floor(zero + 1e-3);
+        grid.base = static_cast<float>(fabs(code * grid.lsb + Motor(motor_id).T_MINX));
+        return grid;
+    }
+    
+    // 带方向的命令扭矩经12位截断编码后，电机实际施加的扭矩大小
+    float AppliedTorque(int motor_id, float torque) const {
+        float lsb = Codec(motor_id).torque_lsb;
+        float t_min = Motor(motor_id).T_MINX;
+        int code = static_cast<int>((torque - t_min) / lsb);
+        return fabs(code * lsb + t_min);
+    }
+    
+    // 该方向可测试的最大扭矩 (不超过电机范围)
+    float DirectionTorqueLimit(int motor_id, float direction) {
+        const MotorParams& motor = Motor(motor_id);
+        return min(config.torque_max, direction > 0 ? motor.T_MAXX : -motor.T_MINX);
+    }
+    
+    // 单次起步试探: 记录零扭矩基准位置，施加扭矩最多保持wait_time，看位置是否沿方向超过阈值。
+    // 保持期间每PROBE_POLL_MS采样一次，一旦起步立即撤掉扭矩 —— 翻倍扩步时试探扭矩可能远大于
+    // 静摩擦力，整段保持会让关节转出很远。
+    // command_torque为带方向的命令值，torque为电机实际施加的扭矩大小 (用于输出)
+    bool ProbeBreakaway(int motor_id, float torque, float command_torque, float direction, bool& moved) {
+        PTFeedback baseline = RequestPTFeedback(motor_id, 0.0f, 50);
+        if (!baseline.valid) {
+            return false;
+        }
+        
+        float actual_torque = torque * direction;
+        if (!SendPTCommand(motor_id, 0.0f, 0.0f, 0.0f, 0.0f, command_torque)) {
+            return false;
+        }
+        
+        double dwell_end = clock->Now() + config.wait_time_ms / 1000.0;
+        PTFeedback feedback;
+        float displacement = 0.0f;
+        moved = false;
+        do {
+            Sleep(PROBE_POLL_MS);
+            feedback = RequestPTFeedback(motor_id, command_torque, 150);
+            if (!feedback.valid) {
+                break;
+            }
+            displacement = (feedback.position_rad - baseline.position_rad) * direction;
+            moved = displacement > config.position_threshold;
+        } while (!moved && clock->Now() < dwell_end);
+        
+        SendPTCommand(motor_id, 0.0f, 0.0f, 0.0f, 0.0f, 0.0f);
+        if (!feedback.valid) {
+            return false;
+        }
+        
+        cout << "Motor" << motor_id << " 试探扭矩: " << fixed << setprecision(3) << actual_torque
+             << " NM, 位移: " << setprecision(4) << displacement << " rad" << (moved ? " (起步)" : "") << endl;
+        
+        // 起步后等关节停稳再进行下一次试探
+        if (moved) {
+            Sleep(300);
+        }
+        return true;
+    }
+    
+    // 自适应测试一个方向的静摩擦力: 翻倍扩步找到起步区间后二分
+    float SearchFrictionInDirection(int motor_id, float direction, FrictionBracket& bracket) {
+        cout << "\n自适应搜索Motor" << motor_id << " " << (direction > 0 ? "正" : "负") << "向摩擦力..." << endl;
+        
+        BreakawaySearch search;
+        search.Reset(config.torque_start, config.torque_step, DirectionTorqueLimit(motor_id, direction),
+                     SearchResolution(motor_id), DirectionGrid(motor_id, direction));
+        
+        int failures = 0;
+        while (!search.Done()) {
+            float torque = search.NextTorque();
+            bool moved = false;
+            if (!ProbeBreakaway(motor_id, torque, search.NextCommand(direction), direction, moved)) {
+                cout << "获取Motor" << motor_id << "反馈失败！" << endl;
+                if (++failures > MAX_MISSED_REPLIES) {
+                    throw runtime_error("测试中丢失反馈");
+                }
+                continue;
+            }
+            failures = 0;
+            search.Report(moved);
+        }
+        
+        bracket = search.Bracket();
+        if (search.high < 0) {
+            cout << "Motor" << motor_id << " 达到最大扭矩，未检测到明显移动" << endl;
+        } else {
+            cout << "🎯 Motor" << motor_id << " 静摩擦力约为: " << fixed << setprecision(3) << bracket.high
+                 << " NM, 区间 [" << bracket.low << ", " << bracket.high << "], 试探" << bracket.steps << "次" << endl;
+        }
+        return search.Result();
+    }
+    
+    // ===== 并行测试: 每个关节一个状态机，在同一总线上交错执行 =====
+    // 流程与TestSingleJoint相同，但所有等待都变成"到某时刻再继续"，
+    // 调度器每个tick推进所有活动关节一步，本tick产生的命令合并为一次批量发送。
+    
+    enum class JointPhase {
+        SETTLE,             // 零扭矩等待，到时开始下一个方向
+        COOLDOWN,           // 预测峰值温度超过上限，零扭矩冷却并定期刷新温度
+        INITIAL_POSITION,   // 零扭矩采样直到初始位置稳定
+        BASELINE,           // 自适应模式: 每次试探前取零扭矩基准位置
+        APPLY_TORQUE,       // 施加当前测试扭矩
+        DWELL,              // 保持扭矩wait_time (自适应模式期间每PROBE_POLL_MS采样一次)
+        SAMPLE,             // 再发一次同样扭矩，用应答位置判断是否起步
+        DONE
+    };
+    
+    struct JointTask {
+        JointResult result;
+        JointPhase phase = JointPhase::SETTLE;
+        float direction = 1.0f;
+        double start_time = 0.0;
+        double wake_time = 0.0;         // 到该时刻前不推进
+        bool awaiting_reply = false;    // 等待序号大于reply_after的反馈
+        uint64_t reply_after = 0;
+        double reply_deadline = 0.0;
+        SettleDetector settle;          // 初始位置的静止估计
+        double settle_deadline = 0.0;
+        double cooldown_start = 0.0;
+        float initial_pos = 0.0f;
+        float test_torque = 0.0f;
+        int missed_replies = 0;
+        vector<float> recent_positions;
+        FrictionBracket bracket;
+        BreakawaySearch search;         // 自适应模式的搜索状态
+        float baseline_pos = 0.0f;
+        double dwell_end = 0.0;         // 自适应试探的最长保持时刻
+        JointStage stage = STAGE_PREPARE; // 当前计时的阶段
+        double stage_start = 0.0;
+    };
+    
+    // 连续丢失应答的上限，超过后该关节判为失败
+    static const int MAX_MISSED_REPLIES = 3;
+    // 自适应试探保持期间的采样间隔
+    static const int PROBE_POLL_MS = 50;
+    
+    // 把关节的下一条命令加入本tick的批次；reply_timeout_ms > 0 时等待该命令的应答
+    void QueueJointCommand(JointTask& task, float torque_nm, double now, int reply_timeout_ms) {
+        int motor_id = task.result.joint_id;
+        task.reply_after = LoadFeedback(motor_id).sequence;
+        AddPTCommand(motor_id, 0.0f, 0.0f, 0.0f, 0.0f, torque_nm);
+        task.awaiting_reply = reply_timeout_ms > 0;
+        task.reply_deadline = now + reply_timeout_ms / 1000.0;
+    }
+    
+    // 结束当前阶段的计时并进入next阶段
+    void MarkJointStage(JointTask& task, JointStage next, double now) {
+        task.result.stage_time[task.stage] += now - task.stage_start;
+        task.stage = next;
+        task.stage_start = now;
+    }
+    
+    void FinishJointTask(JointTask& task, double now) {
+        MarkJointStage(task, task.stage, now);
+        QueueJointCommand(task, 0.0f, now, 0);
+        ObserveTemperature(task.result.joint_id);
+        thermal.Joint(task.result.joint_id).EndLoad(now);
+        task.result.max_coil_temp = thermal.Joint(task.result.joint_id).MaxObserved();
+        task.result.test_duration = now - task.start_time;
+        CollectRoundTrip(task.result);
+        task.phase = JointPhase::DONE;
+    }
+    
+    // 一个方向测试结束: 正向结束后复位并开始负向，负向结束后得出结果
+    void EndJointDirection(JointTask& task, float friction, double settle_s, double now) {
+        if (task.direction > 0) {
+            QueueJointCommand(task, 0.0f, now, 0);
+            ObserveTemperature(task.result.joint_id);
+            thermal.Joint(task.result.joint_id).EndLoad(now);
+            task.result.friction_positive = friction;
+            task.result.positive_bracket = task.bracket;
+            task.direction = -1.0f;
+            task.wake_time = now + settle_s + 2.0;     // 复位到中性位置
+            task.phase = JointPhase::SETTLE;
+            MarkJointStage(task, STAGE_RESET, now);
+        } else {
+            task.result.friction_negative = friction;
+            task.result.negative_bracket = task.bracket;
+            FinalizeJointResult(task.result);
+            FinishJointTask(task, now);
+        }
+    }
+    
+    // 冷却完成后开始当前方向的测试
+    void StartJointDirection(JointTask& task, double now) {
+        int motor_id = task.result.joint_id;
+        cout << "测试Motor" << motor_id << " " << (task.direction > 0 ? "正" : "负") << "向摩擦力..." << endl;
+        MarkJointStage(task, task.direction > 0 ? STAGE_POSITIVE : STAGE_NEGATIVE, now);
+        thermal.Joint(motor_id).BeginLoad(now);
+        task.bracket = FrictionBracket();
+        task.missed_replies = 0;
+        if (config.adaptive) {
+            task.search.Reset(config.torque_start, config.torque_step,
+                              DirectionTorqueLimit(motor_id, task.direction), SearchResolution(motor_id),
+                              DirectionGrid(motor_id, task.direction));
+            task.phase = JointPhase::BASELINE;
+        } else {
+            task.settle = SettleDetector(MakeSettleCriteria(motor_id));
+            task.settle_deadline = now + config.settle_timeout_ms / 1000.0;
+            task.phase = JointPhase::INITIAL_POSITION;
+        }
+    }
+    
+    // 推进一个关节的状态机，最多加入一条命令
+    void StepJointTask(JointTask& task, double now) {
+        int motor_id = task.result.joint_id;
+        PTFeedback feedback;
+        bool replied = false;
+        bool timed_out = false;
+        
+        if (task.awaiting_reply) {
+            feedback = LoadFeedback(motor_id);
+            if (feedback.valid && feedback.sequence > task.reply_after) {
+                replied = true;
+            } else if (now >= task.reply_deadline) {
+                timed_out = true;
+            } else {
+                return;
+            }
+            task.awaiting_reply = false;
+        } else if (now < task.wake_time) {
+            return;
+        }
+        
+        switch (task.phase) {
+            case JointPhase::SETTLE: {
+                double wait = CooldownTime(motor_id);
+                if (wait > 0) {
+                    PrintCooldown(motor_id, wait);
+                    task.cooldown_start = now;
+                    task.wake_time = now + min(wait, THERMAL_POLL_MS / 1000.0);
+                    task.phase = JointPhase::COOLDOWN;
+                    break;
+                }
+                StartJointDirection(task, now);
+                break;
+            }
+                
+            case JointPhase::COOLDOWN: {
+                if (!replied && !timed_out) {
+                    QueueJointCommand(task, 0.0f, now, 100);    // 零扭矩应答带回当前温度
+                    break;
+                }
+                double wait = CooldownTime(motor_id);
+                if (wait > 0 && now - task.cooldown_start > THERMAL_MAX_WAIT_S) {
+                    ostringstream message;
+                    message << "冷却超时: 线圈 " << fixed << setprecision(1) << thermal.Joint(motor_id).Coil() << "°C";
+                    task.result.error_message = message.str();
+                    FinishJointTask(task, now);
+                } else if (wait > 0) {
+                    task.wake_time = now + min(wait, THERMAL_POLL_MS / 1000.0);
+                } else {
+                    double waited = now - task.cooldown_start;
+                    thermal.RecordWait(waited);
+                    last_run_cooldown += waited;
+                    task.result.cooldown_s += waited;
+                    task.stage_start += waited;
+                    StartJointDirection(task, now);
+                }
+                break;
+            }
+                
+            case JointPhase::INITIAL_POSITION: {
+                bool settled = replied && task.settle.Add(feedback.position_rad, feedback.speed_rads);
+                if (!settled && now < task.settle_deadline) {
+                    if (replied || timed_out) {
+                        task.wake_time = now + SETTLE_POLL_MS / 1000.0;
+                    } else {
+                        QueueJointCommand(task, 0.0f, now, 50);
+                    }
+                    break;
+                }
+                
+                if (task.settle.Samples() == 0) {
+                    cout << "无法获取Motor" << motor_id << "初始位置！" << endl;
+                    EndJointDirection(task, 0.0f, 0.0, now);
+                    break;
+                }
+                if (!settled) {
+                    cout << "⚠️ Motor" << motor_id << " 位置未在 " << config.settle_timeout_ms << "ms 内稳定 (静止样本 "
+                         << task.settle.Count() << "/" << task.settle.Samples() << ")" << endl;
+                }
+                task.initial_pos = task.settle.Count() > 0 ? task.settle.Mean() : task.settle.LastPosition();
+                cout << "Motor" << motor_id << " 初始位置: " << fixed << setprecision(4) << task.initial_pos << " rad" << endl;
+                
+                task.test_torque = config.torque_start;
+                task.recent_positions.clear();
+                task.phase = JointPhase::APPLY_TORQUE;
+                break;
+            }
+                
+            case JointPhase::BASELINE:
+                if (replied) {
+                    task.baseline_pos = feedback.position_rad;
+                    task.test_torque = task.search.NextTorque();
+                    task.phase = JointPhase::APPLY_TORQUE;
+                } else if (timed_out) {
+                    if (++task.missed_replies > MAX_MISSED_REPLIES) {
+                        task.result.error_message = "测试中丢失反馈";
+                        FinishJointTask(task, now);
+                    }
+                } else {
+                    QueueJointCommand(task, 0.0f, now, 50);
+                }
+                break;
+                
+            case JointPhase::APPLY_TORQUE: {
+                // 跳过超出电机范围的扭矩 (自适应模式的扭矩已限制在范围内)
+                while (!config.adaptive && task.test_torque <= config.torque_max &&
+                       (task.test_torque * task.direction < Motor(motor_id).T_MINX ||
+                        task.test_torque * task.direction > Motor(motor_id).T_MAXX)) {
+                    task.test_torque += config.torque_step;
+                }
+                if (task.test_torque > config.torque_max) {
+                    cout << "Motor" << motor_id << " 达到最大扭矩，未检测到明显移动" << endl;
+                    task.bracket.low = task.bracket.high = config.torque_max;
+                    EndJointDirection(task, config.torque_max, 0.0, now);
+                    break;
+                }
+                
+                float actual_torque = task.test_torque * task.direction;
+                float command_torque = config.adaptive ? task.search.NextCommand(task.direction) : actual_torque;
+                task.bracket.steps++;
+                if (config.debug_mode) {
+                    ostringstream line;
+                    line << "Motor" << motor_id << " 测试扭矩: " << fixed << setprecision(3) << actual_torque << " NM";
+                    debug_log.PushText(line.str());
+                }
+                QueueJointCommand(task, command_torque, now, 0);
+                task.dwell_end = now + config.wait_time_ms / 1000.0;
+                task.wake_time = config.adaptive ? now + PROBE_POLL_MS / 1000.0 : task.dwell_end;
+                task.phase = JointPhase::DWELL;
+                break;
+            }
+                
+            case JointPhase::DWELL:
+                QueueJointCommand(task, config.adaptive ? task.search.NextCommand(task.direction)
+                                                        : task.test_torque * task.direction, now, 150);
+                task.phase = JointPhase::SAMPLE;
+                break;
+                
+            case JointPhase::SAMPLE:
+                if (timed_out) {
+                    cout << "获取Motor" << motor_id << "反馈失败！" << endl;
+                    if (++task.missed_replies > MAX_MISSED_REPLIES) {
+                        task.result.error_message = "测试中丢失反馈";
+                        FinishJointTask(task, now);
+                    } else {
+                        // 同一扭矩重试 (自适应模式先重新取基准)
+                        task.phase = config.adaptive ? JointPhase::BASELINE : JointPhase::APPLY_TORQUE;
+                    }
+                    break;
+                }
+                
+                task.missed_replies = 0;
+                
+                if (config.adaptive) {
+                    float displacement = (feedback.position_rad - task.baseline_pos) * task.direction;
+                    bool moved = displacement > config.position_threshold;
+                    if (!moved && now < task.dwell_end) {
+                        task.wake_time = now + PROBE_POLL_MS / 1000.0;
+                        task.phase = JointPhase::DWELL;
+                        break;
+                    }
+                    task.search.Report(moved);
+                    QueueJointCommand(task, 0.0f, now, 0);
                     
-                    if (trend * expected_direction > 0 && fabs(trend) > config.position_threshold * 0.5f) {
-                        cout << "🎯 Motor" << motor_id << " 检测到显著移动！静摩擦力约为: " << test_torque << " NM" << endl;
-                        
-                        SendPTCommand(motor_id, 0.0f, 0.0f, 0.0f, 0.0f, 0.0f);
-                        Sleep(500);
-                        return test_torque;
+                    if (config.debug_mode) {
+                        ostringstream line;
+                        line << "Motor" << motor_id << " 试探扭矩: " << fixed << setprecision(3) << task.test_torque * task.direction
+                             << " NM, 位移: " << setprecision(4) << displacement << " rad" << (moved ? " (起步)" : "");
+                        debug_log.PushText(line.str());
+                    }
+                    
+                    if (task.search.Done()) {
+                        task.bracket = task.search.Bracket();
+                        cout << "🎯 Motor" << motor_id << " 静摩擦力约为: " << fixed << setprecision(3) << task.bracket.high
+                             << " NM, 区间 [" << task.bracket.low << ", " << task.bracket.high << "]" << endl;
+                        EndJointDirection(task, task.search.Result(), 0.5, now);
+                    } else {
+                        task.wake_time = moved ? now + 0.3 : now;   // 起步后等关节停稳
+                        task.phase = JointPhase::BASELINE;
                     }
+                    break;
                 }
-            }
-            
-            test_torque += config.torque_step;
+                
+                task.recent_positions.push_back(feedback.position_rad);
+                if (task.recent_positions.size() > 5) {
+                    task.recent_positions.erase(task.recent_positions.begin());
+                }
+                
+                if (config.debug_mode) {
+                    ostringstream line;
+                    line << "Motor" << motor_id << " 位置变化: " << fixed << setprecision(4)
+                         << fabs(feedback.position_rad - task.initial_pos) << " rad"
+                         << ", 电流: " << feedback.current_A << " A";
+                    debug_log.PushText(line.str());
+                }
+                
+                if (DetectBreakaway(task.initial_pos, task.recent_positions, task.direction)) {
+                    cout << "🎯 Motor" << motor_id << " 检测到显著移动！静摩擦力约为: " << task.test_torque << " NM" << endl;
+                    task.bracket.low = max(config.torque_start, task.test_torque - config.torque_step);
+                    task.bracket.high = task.test_torque;
+                    EndJointDirection(task, task.test_torque, 0.5, now);
+                } else {
+                    task.test_torque += config.torque_step;
+                    task.phase = JointPhase::APPLY_TORQUE;
+                }
+                break;
+                
+            case JointPhase::DONE:
+                break;
         }
-        
-        cout << "Motor" << motor_id << " 达到最大扭矩，未检测到明显移动" << endl;
-        SendPTCommand(motor_id, 0.0f, 0.0f, 0.0f, 0.0f, 0.0f);
-        return config.torque_max;
     }
     
 public:
+    CorrectPTTester() {
+        ApplyMotorTypes();
+        for (int id = 0; id <= MAX_JOINT_ID; id++) {
+            rtt_pending[id].store(RTT_NONE, memory_order_relaxed);
+            rtt_lost[id].store(0, memory_order_relaxed);
+        }
+    }
+    
     bool Initialize() {
         cout << "初始化CAN通信..." << endl;
         
@@ -396,18 +1941,124 @@ public:
         }
         
         VCI_ClearBuffer(DEVICE_TYPE, DEVICE_INDEX, CAN_INDEX);
+        tx_commands.reserve(MAX_JOINT_ID);
+        tx_batch.reserve(MAX_JOINT_ID);
         can_initialized = true;
+        if (config.debug_mode) {
+            debug_log.Start();
+        }
+        StartReceiveThread();
         cout << "CAN通信初始化成功！" << endl;
         return true;
     }
     
+    // 开始记录二进制遥测 (文件头写入当前配置)，需在SetConfig之后调用
+    bool OpenTelemetry(const string& path) {
+        TelemetryHeader header = MakeTelemetryHeader(config.use_topology ? -1 : config.motor_type);
+        for (int id = 0; id <= MAX_JOINT_ID; id++) {
+            header.joint_motor_type[id] = static_cast<uint8_t>(joint_motor_type[id]);
+        }
+        header.start_unix_ns = chrono::duration_cast<chrono::nanoseconds>(chrono::system_clock::now().time_since_epoch()).count();
+        for (int motor_id : config.motor_ids) {
+            header.joint_mask |= 1ull << motor_id;
+        }
+        header.flags = (config.adaptive ? TELEMETRY_FLAG_ADAPTIVE : 0) |
+                       (config.ramp ? TELEMETRY_FLAG_RAMP : 0) |
+                       (config.parallel ? TELEMETRY_FLAG_PARALLEL : 0);
+        header.torque_start = config.torque_start;
+        header.torque_step = config.torque_step;
+        header.torque_max = config.torque_max;
+        header.position_threshold = config.position_threshold;
+        header.wait_time_ms = config.wait_time_ms;
+        header.ramp_rate = config.ramp_rate;
+        header.ramp_hz = config.ramp_hz;
+        
+        CloseTelemetry();
+        if (!telemetry.Open(path, header)) {
+            cout << "无法创建遥测文件: " << path << endl;
+            return false;
+        }
+        telemetry_start = clock->Now();
+        
+        // 写入线程先就绪，再让接收线程开始投递样本
+        telemetry_running.store(true, memory_order_release);
+        telemetry_thread = thread(&CorrectPTTester::TelemetryLoop, this);
+        return true;
+    }
+    
+    // 停止记录: 写入线程写完缓冲中的样本后关闭文件
+    void CloseTelemetry() {
+        telemetry_running.store(false, memory_order_release);
+        if (telemetry_thread.joinable()) {
+            telemetry_thread.join();
+        }
+        telemetry.Close();
+    }
+    
+    // 写入条数和因缓冲满丢弃的条数，在CloseTelemetry之后读取
+    uint64_t GetTelemetryCount() const {
+        return telemetry.Count();
+    }
+    
+    uint64_t GetTelemetryOverruns() const {
+        return telemetry_ring.Overruns();
+    }
+    
+    // 替换测试时钟 (例如虚拟时间)，需在Initialize之前调用
+    // adapter_on_clock: 适配器时间戳由该时钟产生 (仿真库按该时钟运行)，换算时偏移已知为0，不做估计
+    void SetClock(Clock* new_clock, bool adapter_on_clock = false) {
+        bool restart = rx_running;
+        StopReceiveThread();
+        clock = new_clock ? new_clock : &real_clock;
+        if (adapter_on_clock) {
+            adapter_clock.UseFixedOffset(0.0);
+        } else {
+            adapter_clock.UseEstimate();
+        }
+        if (restart) {
+            StartReceiveThread();
+        }
+    }
+    
     void SetConfig(const TestConfig& new_config) {
+        // 接收线程按各关节的电机型号解码，切换参数期间先停下
+        StopReceiveThread();
         config = new_config;
-        currentMotor = motorParams[config.motor_type];
+        ApplyMotorTypes();
+        if (!config.debug_mode) {
+            debug_log.Stop();
+        } else if (can_initialized) {
+            debug_log.Start();
+        }
+        if (can_initialized) {
+            StartReceiveThread();
+        }
         
-        cout << "选择电机: " << currentMotor.model << endl;
-        cout << "减速比: " << currentMotor.def_ratio << ", KT: " << currentMotor.KT << endl;
-        cout << "扭矩范围: " << currentMotor.T_MINX << " ~ " << currentMotor.T_MAXX << " NM" << endl;
+        if (config.use_topology) {
+            cout << "电机型号: 按关节拓扑" << endl;
+            for (int type = 0; type < MOTOR_TYPE_COUNT; type++) {
+                vector<int> joints;
+                for (int motor_id : config.motor_ids) {
+                    if (MotorType(motor_id) == type) {
+                        joints.push_back(motor_id);
+                    }
+                }
+                if (joints.empty()) {
+                    continue;
+                }
+                cout << "  " << motorParams[type].model << " (扭矩范围: " << motorParams[type].T_MINX << " ~ "
+                     << motorParams[type].T_MAXX << " NM): ";
+                for (size_t i = 0; i < joints.size(); i++) {
+                    cout << joints[i] << (i + 1 < joints.size() ? ", " : "");
+                }
+                cout << endl;
+            }
+        } else {
+            const MotorParams& motor = motorParams[config.motor_type];
+            cout << "选择电机: " << motor.model << endl;
+            cout << "减速比: " << motor.def_ratio << ", KT: " << motor.KT << endl;
+            cout << "扭矩范围: " << motor.T_MINX << " ~ " << motor.T_MAXX << " NM" << endl;
+        }
         
         if (config.test_all_joints) {
             cout << "测试模式: 全部" << config.motor_ids.size() << "个关节" << endl;
@@ -421,52 +2072,166 @@ public:
         }
     }
     
+    // 总线扫描: 全部候选关节的零扭矩命令一次批量发出，在一个超时窗口内收集应答，未应答的关节再发一轮。
+    // 返回应答且没有报告错误码的关节 (按candidates的顺序)，扫描结果保存在discovered/discovery_missing
+    vector<int> DiscoverJoints(const vector<int>& candidates) {
+        discovered.clear();
+        discovery_missing.clear();
+        discovery_candidates = candidates.size();
+        double start = clock->Now();
+        
+        vector<int> pending;
+        for (int motor_id : candidates) {
+            if (motor_id >= 1 && motor_id <= MAX_JOINT_ID) {
+                pending.push_back(motor_id);
+            }
+        }
+        uint64_t after_sequence[MAX_JOINT_ID + 1] = {};
+        
+        for (int round = 0; round < DISCOVERY_ROUNDS && !pending.empty(); round++) {
+            for (int motor_id : pending) {
+                after_sequence[motor_id] = LoadFeedback(motor_id).sequence;
+                AddPTCommand(motor_id, 0.0f, 0.0f, 0.0f, 0.0f, 0.0f);
+            }
+            SendPTBatch();
+            double sent_time = clock->Now();
+            double deadline = sent_time + DISCOVERY_TIMEOUT_MS / 1000.0;
+            
+            while (true) {
+                double now = clock->Now();
+                for (size_t i = 0; i < pending.size();) {
+                    PTFeedback feedback = LoadFeedback(pending[i]);
+                    if (feedback.valid && feedback.sequence > after_sequence[pending[i]]) {
+                        discovered.push_back({pending[i], feedback.motor_error, feedback.coil_temp,
+                                              feedback.board_temp, (now - sent_time) * 1000.0});
+                        thermal.Joint(pending[i]).Observe(feedback.coil_temp, feedback.board_temp, now);
+                        pending.erase(pending.begin() + i);
+                    } else {
+                        i++;
+                    }
+                }
+                if (pending.empty() || now >= deadline) {
+                    break;
+                }
+                clock->SleepFor(0.0002);
+            }
+        }
+        discovery_missing = pending;
+        discovery_time = clock->Now() - start;
+        
+        vector<int> responsive;
+        for (int motor_id : candidates) {
+            const DiscoveredJoint* joint = FindDiscovered(motor_id);
+            if (joint && joint->motor_error == 0) {
+                responsive.push_back(motor_id);
+            }
+        }
+        
+        cout << "\n总线扫描: " << discovery_candidates << " 个候选关节, " << discovered.size() << " 个应答, 用时 "
+             << fixed << setprecision(1) << discovery_time * 1000.0 << " ms" << endl;
+        for (const auto& joint : discovered) {
+            if (joint.motor_error != 0) {
+                cout << "❌ 关节 " << joint.joint_id << " 报告错误码 " << static_cast<int>(joint.motor_error) << "，不测试" << endl;
+            }
+        }
+        if (!discovery_missing.empty()) {
+            cout << "⚠️ 未应答的关节 (不测试): " << FormatJointList(discovery_missing) << endl;
+        }
+        return responsive;
+    }
+    
+    const DiscoveredJoint* FindDiscovered(int motor_id) const {
+        for (const auto& joint : discovered) {
+            if (joint.joint_id == motor_id) {
+                return &joint;
+            }
+        }
+        return nullptr;
+    }
+    
+    static string FormatJointList(const vector<int>& ids) {
+        ostringstream text;
+        for (size_t i = 0; i < ids.size(); i++) {
+            text << (i > 0 ? "," : "") << ids[i];
+        }
+        return text.str();
+    }
+    
     // 测试单个关节
     JointResult TestSingleJoint(int motor_id) {
         JointResult result;
         result.joint_id = motor_id;
+        ResetRoundTrip(motor_id);
         
-        auto start_time = chrono::steady_clock::now();
+        double start_time = clock->Now();
+        
+        // 各阶段计时: 进入下一阶段时累计上一阶段的耗时
+        JointStage stage = STAGE_PREPARE;
+        double stage_start = start_time;
+        auto mark_stage = [&](JointStage next) {
+            double now = clock->Now();
+            result.stage_time[stage] += now - stage_start;
+            stage = next;
+            stage_start = now;
+        };
+        // 冷却等待单独统计，不计入所在阶段
+        auto cooldown = [&](double waited) {
+            result.cooldown_s += waited;
+            stage_start += waited;
+        };
         
         try {
             cout << "\n=== 测试关节 " << motor_id << " ===" << endl;
             
-            // 测试PT模式基本功能
-            cout << "测试PT模式功能..." << endl;
-            if (!SendPTCommand(motor_id, 0.0f, 0.0f, 0.0f, 0.0f, 0.5f)) {
+            // PT模式应答已在总线扫描中确认
+            if (!SendPTCommand(motor_id, 0.0f, 0.0f, 0.0f, 0.0f, 0.0f)) {
                 result.error_message = "发送PT命令失败";
                 return result;
             }
-            
-            Sleep(200);
-            PTFeedback feedback = GetPTFeedback(motor_id);
-            if (!feedback.valid) {
-                result.error_message = "没有收到PT模式反馈";
-                return result;
-            }
-            
-            cout << "✅ PT模式正常工作！" << endl;
-            SendPTCommand(motor_id, 0.0f, 0.0f, 0.0f, 0.0f, 0.0f);
-            Sleep(500);
-            
+            cooldown(WaitForCooldown(motor_id));
+
             // 测试摩擦力
-            result.friction_positive = TestFrictionInDirection(motor_id, 1.0f);
-            
+            mark_stage(STAGE_POSITIVE);
+            thermal.Joint(motor_id).BeginLoad(clock->Now());
+            if (config.ramp) {
+                result.friction_positive = RampFrictionInDirection(motor_id, 1.0f, result.positive_bracket, result.positive_series);
+            } else if (config.adaptive) {
+                result.friction_positive = SearchFrictionInDirection(motor_id, 1.0f, result.positive_bracket);
+            } else {
+                result.friction_positive = TestFrictionInDirection(motor_id, 1.0f, result.positive_bracket);
+            }
+            ObserveTemperature(motor_id);
+            thermal.Joint(motor_id).EndLoad(clock->Now());
+
             // 复位
+            mark_stage(STAGE_RESET);
             cout << "复位关节到中性位置..." << endl;
             SendPTCommand(motor_id, 0.0f, 0.0f, 0.0f, 0.0f, 0.0f);
             Sleep(2000);
-            
-            result.friction_negative = TestFrictionInDirection(motor_id, -1.0f);
-            
-            // 计算平均摩擦力
-            if (result.friction_negative < 0.05f && result.friction_positive > 0.5f) {
-                result.avg_friction = result.friction_positive;
+            cooldown(WaitForCooldown(motor_id));
+
+            mark_stage(STAGE_NEGATIVE);
+            thermal.Joint(motor_id).BeginLoad(clock->Now());
+            if (config.ramp) {
+                result.friction_negative = RampFrictionInDirection(motor_id, -1.0f, result.negative_bracket, result.negative_series);
+            } else if (config.adaptive) {
+                result.friction_negative = SearchFrictionInDirection(motor_id, -1.0f, result.negative_bracket);
             } else {
-                result.avg_friction = (result.friction_positive + result.friction_negative) / 2.0f;
+                result.friction_negative = TestFrictionInDirection(motor_id, -1.0f, result.negative_bracket);
+            }
+            
+            // 速度扫描接在负向之后，一次连续运动
+            if (config.sweep) {
+                ObserveTemperature(motor_id);
+                thermal.Joint(motor_id).EndLoad(clock->Now());
+                mark_stage(STAGE_SWEEP);
+                cooldown(WaitForCooldown(motor_id));
+                thermal.Joint(motor_id).BeginLoad(clock->Now());
+                SweepFriction(motor_id, result);
             }
             
-            result.test_passed = true;
+            // 计算平均摩擦力
+            FinalizeJointResult(result);
             
         } catch (const exception& e) {
             result.error_message = e.what();
@@ -474,20 +2239,188 @@ public:
         
         // 停止电机
         SendPTCommand(motor_id, 0.0f, 0.0f, 0.0f, 0.0f, 0.0f);
+        ObserveTemperature(motor_id);
+        thermal.Joint(motor_id).EndLoad(clock->Now());
+        result.max_coil_temp = thermal.Joint(motor_id).MaxObserved();
         
-        auto end_time = chrono::steady_clock::now();
-        result.test_duration = chrono::duration<double>(end_time - start_time).count();
+        mark_stage(stage);
+        result.test_duration = clock->Now() - start_time;
+        CollectRoundTrip(result);
         
         return result;
     }
     
-    // 运行摩擦力测试
+    // 并行运行摩擦力测试: 最多batch_size个关节同时处于测试中，完成一个补入下一个
+    vector<JointResult> RunFrictionTestParallel() {
+        size_t total = config.motor_ids.size();
+        size_t slots = static_cast<size_t>(max(1, config.batch_size));
+        vector<JointTask> tasks(total);
+        for (size_t i = 0; i < total; i++) {
+            tasks[i].result.joint_id = config.motor_ids[i];
+        }
+        
+        cout << "\n=== PT模式摩擦力并行测试 - " << total << "个关节, 同时测试" << slots << "个 ===" << endl;
+        
+        double overall_start = clock->Now();
+        size_t started = 0, active = 0, finished = 0;
+        PeriodicExecutor executor(clock, config.tick_ms / 1000.0, loop_stats);
+        executor.Start();
+        
+        while (finished < total) {
+            double now = clock->Now();
+            
+            while (active < slots && started < total) {
+                JointTask& task = tasks[started++];
+                task.start_time = now;
+                task.wake_time = now;
+                task.stage_start = now;
+                ResetRoundTrip(task.result.joint_id);
+                active++;
+                cout << "\n[" << started << "/" << total << "] 开始测试关节 " << task.result.joint_id << endl;
+            }
+            
+            for (size_t i = 0; i < started; i++) {
+                JointTask& task = tasks[i];
+                if (task.phase == JointPhase::DONE) {
+                    continue;
+                }
+                
+                StepJointTask(task, now);
+                
+                if (task.phase == JointPhase::DONE) {
+                    active--;
+                    finished++;
+                    const JointResult& result = task.result;
+                    JournalResult(result);
+                    if (result.test_passed) {
+                        cout << "✅ 关节 " << result.joint_id << " 测试完成 - 正向:" << result.friction_positive
+                             << " NM, 负向:" << result.friction_negative << " NM, 平均:" << result.avg_friction << " NM" << endl;
+                    } else {
+                        cout << "❌ 关节 " << result.joint_id << " 测试失败: " << result.error_message << endl;
+                    }
+                    cout << "进度: " << fixed << setprecision(1) << (100.0 * finished / total) << "%, "
+                         << "已用时: " << (now - overall_start) << "s" << endl;
+                }
+            }
+            
+            // 本tick所有关节的命令一次发出
+            SendPTBatch();
+            executor.WaitNext();
+        }
+        
+        last_run_duration = clock->Now() - overall_start;
+        
+        vector<JointResult> results;
+        for (const auto& task : tasks) {
+            results.push_back(task.result);
+        }
+        return results;
+    }
+    
+    // 运行摩擦力测试: 续测时跳过结果日志中已通过的关节，其余关节先做总线扫描，只测试应答且无错误码的关节。
+    // 返回结果按motor_ids的顺序，不含扫描中未应答的关节
     vector<JointResult> RunFrictionTest() {
+        last_run_cooldown = 0.0;
+        thermal.Configure(config.max_temperature);
+        discovered.clear();
+        discovery_missing.clear();
+        discovery_candidates = 0;
+        
+        vector<int> all_ids = config.motor_ids;
+        config.motor_ids.clear();
+        for (int motor_id : all_ids) {
+            if (!FindResumedResult(motor_id)) {
+                config.motor_ids.push_back(motor_id);
+            }
+        }
+        bool nothing_left = config.motor_ids.empty();
+        if (!nothing_left) {
+            config.motor_ids = DiscoverJoints(config.motor_ids);
+        }
+        
+        CheckBusPlan();
+        bus_load.Reset();
+        bus_warn_time = -1e9;
+        loop_stats.Reset();
+        
+        // 斜坡和速度扫描每个关节独占高频命令，按顺序测试
+        vector<JointResult> tested;
+        if (nothing_left) {
+            cout << "\n所有关节已在结果日志中通过，无需测试" << endl;
+            last_run_duration = 0.0;
+        } else if (config.motor_ids.empty()) {
+            cout << "\n没有可测试的关节" << endl;
+            last_run_duration = 0.0;
+        } else if (config.parallel && !config.ramp && !config.sweep && config.motor_ids.size() > 1) {
+            tested = RunFrictionTestParallel();
+        } else {
+            tested = RunFrictionTestSequential();
+        }
+        
+        last_run_bus = bus_load.Total(clock->Now());
+        last_run_peak_load = bus_load.PeakLoad();
+        
+        config.motor_ids = all_ids;
+        vector<JointResult> results;
+        size_t next = 0;
+        for (int motor_id : all_ids) {
+            const JointResult* resumed = FindResumedResult(motor_id);
+            const DiscoveredJoint* joint = FindDiscovered(motor_id);
+            if (resumed) {
+                results.push_back(*resumed);
+            } else if (next < tested.size() && tested[next].joint_id == motor_id) {
+                results.push_back(tested[next++]);
+            } else if (joint) {
+                // 扫描中报告错误码的关节记为失败，不测试
+                JointResult result;
+                result.joint_id = motor_id;
+                result.error_message = "电机报告错误码 " + to_string(joint->motor_error);
+                result.max_coil_temp = joint->coil_temp;
+                JournalResult(result);
+                results.push_back(result);
+            }
+        }
+        return results;
+    }
+    
+    // 按测试计划估算命令峰值速率 (每条命令一条应答)，超过总线占用上限时警告，限流模式下降低速率
+    void CheckBusPlan() {
+        bool parallel = config.parallel && !config.ramp && !config.sweep && config.motor_ids.size() > 1;
+        double commands_per_s;
+        if (config.ramp || config.sweep) {
+            commands_per_s = config.ramp_hz;
+        } else {
+            commands_per_s = (parallel ? config.batch_size : 1) * 1000.0 / config.tick_ms;
+        }
+        double planned = bus_load.PlannedLoad(2.0 * commands_per_s);
+        if (planned <= config.bus_load_limit) {
+            return;
+        }
+        
+        cout << "⚠️ 计划总线占用 " << fixed << setprecision(1) << planned * 100.0 << "% 超过上限 "
+             << config.bus_load_limit * 100.0 << "% (" << setprecision(0) << 2.0 * commands_per_s << " 帧/s)" << endl;
+        if (!config.bus_throttle) {
+            return;
+        }
+        
+        // 每条命令+应答在上限内能承受的速率
+        double max_commands_per_s = config.bus_load_limit / bus_load.PlannedLoad(2.0);
+        if (config.ramp || config.sweep) {
+            config.ramp_hz = max(50, static_cast<int>(max_commands_per_s));
+            cout << "限流: " << (config.ramp ? "斜坡" : "速度扫描") << "频率降为 " << config.ramp_hz << " Hz" << endl;
+        } else if (parallel) {
+            config.batch_size = max(1, static_cast<int>(max_commands_per_s * config.tick_ms / 1000.0));
+            cout << "限流: 同时测试关节数降为 " << config.batch_size << endl;
+        }
+    }
+    
+    // 按顺序逐个测试关节 (每个方向开始前按热模型决定是否需要冷却)
+    vector<JointResult> RunFrictionTestSequential() {
         vector<JointResult> results;
         
         cout << "\n=== PT模式摩擦力测试 - " << config.motor_ids.size() << "个关节 ===" << endl;
         
-        auto overall_start = chrono::steady_clock::now();
+        double overall_start = clock->Now();
         
         for (size_t i = 0; i < config.motor_ids.size(); i++) {
             int motor_id = config.motor_ids[i];
@@ -496,6 +2429,7 @@ public:
             
             JointResult result = TestSingleJoint(motor_id);
             results.push_back(result);
+            JournalResult(result);
             
             // 显示结果
             if (result.test_passed) {
@@ -509,8 +2443,7 @@ public:
             
             // 显示进度
             if (i < config.motor_ids.size() - 1) {
-                auto current_time = chrono::steady_clock::now();
-                auto elapsed = chrono::duration<double>(current_time - overall_start).count();
+                double elapsed = clock->Now() - overall_start;
                 double avg_time = elapsed / (i + 1);
                 double remaining = avg_time * (config.motor_ids.size() - i - 1);
                 
@@ -518,16 +2451,227 @@ public:
                      << (100.0 * (i + 1) / config.motor_ids.size()) << "%, "
                      << "预计剩余: " << static_cast<int>(remaining / 60) 
                      << "m " << static_cast<int>(remaining) % 60 << "s" << endl;
-                
-                // 关节间休息
-                cout << "冷却 5 秒..." << endl;
-                Sleep(5000);
             }
         }
         
+        last_run_duration = clock->Now() - overall_start;
         return results;
     }
     
+    // 上一次RunFrictionTest的总耗时 (秒)，含冷却；并行模式下小于各关节耗时之和
+    double GetLastRunDuration() const {
+        return last_run_duration;
+    }
+    
+    // 上一次RunFrictionTest中冷却等待的总时间 (秒)；并行模式下各关节的等待可能重叠
+    double GetLastRunCooldown() const {
+        return last_run_cooldown;
+    }
+    
+    // 上一次RunFrictionTest期间的总线收发统计和最高短窗口占用率
+    const BusLoadStats& GetLastRunBus() const {
+        return last_run_bus;
+    }
+    
+    double GetLastRunPeakLoad() const {
+        return last_run_peak_load;
+    }
+    
+    // 上一次RunFrictionTest中周期控制循环的唤醒延迟和超时
+    const PeriodicStats& GetLoopStats() const {
+        return loop_stats;
+    }
+    
+    // 结果日志中影响测试结果的参数，续测时须与本次一致
+    vector<string> JournalConfigFields() const {
+        auto field = [](const char* key, double value) {
+            ostringstream text;
+            text << key << "=" << setprecision(9) << value;
+            return text.str();
+        };
+        return {"CONFIG", "version=2",
+                config.use_topology ? string("motor=topology") : "motor=" + to_string(config.motor_type),
+                field("torque_start", config.torque_start), field("torque_step", config.torque_step),
+                field("torque_max", config.torque_max), field("threshold", config.position_threshold),
+                field("wait_ms", config.wait_time_ms), field("adaptive", config.adaptive),
+                field("resolution", config.search_resolution), field("ramp", config.ramp),
+                field("ramp_rate", config.ramp_rate), field("ramp_hz", config.ramp_hz),
+                field("ramp_speed", config.ramp_speed_threshold), field("settle_error", config.settle_error),
+                field("settle_timeout_ms", config.settle_timeout_ms), field("sweep", config.sweep),
+                field("sweep_speed", config.sweep_speed), field("sweep_levels", config.sweep_levels),
+                field("sweep_kd", config.sweep_kd), field("sweep_travel", config.sweep_travel),
+                field("sweep_min_r2", config.sweep_min_r_squared)};
+    }
+    
+    // 一个关节的结果编码为日志记录 (键=值)
+    vector<string> EncodeJournalResult(const JointResult& result) const {
+        vector<string> fields = {"JOINT"};
+        auto field = [&fields](const char* key, double value) {
+            ostringstream text;
+            text << key << "=" << setprecision(9) << value;
+            fields.push_back(text.str());
+        };
+        field("id", result.joint_id);
+        field("passed", result.test_passed);
+        field("positive", result.friction_positive);
+        field("negative", result.friction_negative);
+        field("average", result.avg_friction);
+        field("positive_low", result.positive_bracket.low);
+        field("positive_high", result.positive_bracket.high);
+        field("positive_steps", result.positive_bracket.steps);
+        field("negative_low", result.negative_bracket.low);
+        field("negative_high", result.negative_bracket.high);
+        field("negative_steps", result.negative_bracket.steps);
+        field("duration", result.test_duration);
+        for (int stage = 0; stage < JOINT_STAGE_COUNT; stage++) {
+            field(("stage" + to_string(stage)).c_str(), result.stage_time[stage]);
+        }
+        field("rtt_samples", static_cast<double>(result.rtt_samples));
+        field("rtt_p50", result.rtt_p50_us);
+        field("rtt_p99", result.rtt_p99_us);
+        field("rtt_max", result.rtt_max_us);
+        field("rtt_lost", result.rtt_lost);
+        field("coil_max", result.max_coil_temp);
+        field("cooldown", result.cooldown_s);
+        field("coulomb", result.coulomb_friction);
+        field("viscous", result.viscous_coeff);
+        field("sweep_r2", result.sweep_r_squared);
+        field("sweep_samples", result.sweep_samples);
+        
+        string error = result.error_message;
+        replace(error.begin(), error.end(), '\t', ' ');
+        replace(error.begin(), error.end(), '\n', ' ');
+        fields.push_back("error=" + error);
+        return fields;
+    }
+    
+    // 从日志记录恢复一个关节的结果，缺少字段或数值无效时返回false
+    bool DecodeJournalResult(const vector<string>& fields, JointResult& result) const {
+        map<string, string> values;
+        for (size_t i = 1; i < fields.size(); i++) {
+            size_t eq = fields[i].find('=');
+            if (eq != string::npos) {
+                values[fields[i].substr(0, eq)] = fields[i].substr(eq + 1);
+            }
+        }
+        try {
+            auto number = [&values](const string& key) { return stod(values.at(key)); };
+            result.joint_id = static_cast<int>(number("id"));
+            result.test_passed = number("passed") != 0;
+            result.friction_positive = number("positive");
+            result.friction_negative = number("negative");
+            result.avg_friction = number("average");
+            result.positive_bracket.low = number("positive_low");
+            result.positive_bracket.high = number("positive_high");
+            result.positive_bracket.steps = static_cast<int>(number("positive_steps"));
+            result.negative_bracket.low = number("negative_low");
+            result.negative_bracket.high = number("negative_high");
+            result.negative_bracket.steps = static_cast<int>(number("negative_steps"));
+            result.test_duration = number("duration");
+            for (int stage = 0; stage < JOINT_STAGE_COUNT; stage++) {
+                result.stage_time[stage] = number("stage" + to_string(stage));
+            }
+            result.rtt_samples = static_cast<uint64_t>(number("rtt_samples"));
+            result.rtt_p50_us = static_cast<uint32_t>(number("rtt_p50"));
+            result.rtt_p99_us = static_cast<uint32_t>(number("rtt_p99"));
+            result.rtt_max_us = static_cast<uint32_t>(number("rtt_max"));
+            result.rtt_lost = static_cast<uint32_t>(number("rtt_lost"));
+            result.max_coil_temp = number("coil_max");
+            result.cooldown_s = number("cooldown");
+            result.coulomb_friction = number("coulomb");
+            result.viscous_coeff = number("viscous");
+            result.sweep_r_squared = number("sweep_r2");
+            result.sweep_samples = static_cast<int>(number("sweep_samples"));
+            result.error_message = values.at("error");
+        } catch (const exception& e) {
+            return false;
+        }
+        result.resumed = true;
+        return result.joint_id >= 1 && result.joint_id <= MAX_JOINT_ID;
+    }
+    
+    // 打开结果日志。resume时读取已有记录: 测试参数一致则恢复已通过的关节 (同一关节以最后一条为准)，
+    // 参数不一致时拒绝续测；日志不存在时从头开始
+    bool OpenJournal(const string& path, bool resume) {
+        resumed_results.clear();
+        journal_failed = false;
+        
+        vector<vector<string>> records;
+        size_t skipped = 0;
+        if (resume && ResultJournal::Load(path, records, &skipped)) {
+            vector<string> expected = JournalConfigFields();
+            if (records.empty() || records[0] != expected) {
+                cout << "❌ 结果日志 " << path << " 的测试参数与本次不同，不能续测" << endl;
+                if (!records.empty()) {
+                    for (size_t i = 1; i < max(records[0].size(), expected.size()); i++) {
+                        string logged = i < records[0].size() ? records[0][i] : "-";
+                        string current = i < expected.size() ? expected[i] : "-";
+                        if (logged != current) {
+                            cout << "  日志: " << logged << "  本次: " << current << endl;
+                        }
+                    }
+                }
+                return false;
+            }
+            
+            map<int, JointResult> latest;
+            for (size_t i = 1; i < records.size(); i++) {
+                JointResult result;
+                if (!records[i].empty() && records[i][0] == "JOINT" && DecodeJournalResult(records[i], result)) {
+                    latest[result.joint_id] = result;
+                }
+            }
+            for (int motor_id : config.motor_ids) {
+                auto it = latest.find(motor_id);
+                if (it != latest.end() && it->second.test_passed) {
+                    resumed_results.push_back(it->second);
+                }
+            }
+            
+            if (!journal.Open(path, false)) {
+                cout << "❌ 无法打开结果日志 " << path << ": " << journal.Error() << endl;
+                return false;
+            }
+            journal.Append({"RESUME", "time=" + to_string(chrono::duration_cast<chrono::seconds>(
+                                                  chrono::system_clock::now().time_since_epoch()).count())});
+            cout << "续测: 结果日志中 " << resumed_results.size() << " 个关节已通过，跳过";
+            if (skipped > 0) {
+                cout << " (忽略 " << skipped << " 行不完整或损坏的记录)";
+            }
+            cout << endl;
+            return true;
+        }
+        
+        if (resume) {
+            cout << "结果日志 " << path << " 不存在，从头开始测试" << endl;
+        }
+        if (!journal.Open(path, true) || !journal.Append(JournalConfigFields())) {
+            cout << "❌ 无法写入结果日志 " << path << ": " << journal.Error() << endl;
+            return false;
+        }
+        return true;
+    }
+    
+    const JointResult* FindResumedResult(int motor_id) const {
+        for (const auto& result : resumed_results) {
+            if (result.joint_id == motor_id) {
+                return &result;
+            }
+        }
+        return nullptr;
+    }
+    
+    // 关节完成后立即追加到结果日志；写入失败只警告一次，不中断测试
+    void JournalResult(const JointResult& result) {
+        if (!journal.IsOpen() || journal_failed) {
+            return;
+        }
+        if (!journal.Append(EncodeJournalResult(result))) {
+            journal_failed = true;
+            cout << "⚠️ 写结果日志失败: " << journal.Error() << "，中断后将无法续测" << endl;
+        }
+    }
+    
     // 保存结果
     bool SaveResults(const vector<JointResult>& results) {
         ofstream file(config.output_file);
@@ -537,9 +2681,14 @@ public:
         }
         
         file << "=== PT模式摩擦力测试结果 ===" << endl;
-        file << "电机型号: " << currentMotor.model << endl;
-        file << "减速比: " << currentMotor.def_ratio << endl;
-        file << "扭矩常数KT: " << currentMotor.KT << endl;
+        if (config.use_topology) {
+            file << "电机型号: 按关节拓扑 (见详细结果)" << endl;
+        } else {
+            const MotorParams& motor = motorParams[config.motor_type];
+            file << "电机型号: " << motor.model << endl;
+            file << "减速比: " << motor.def_ratio << endl;
+            file << "扭矩常数KT: " << motor.KT << endl;
+        }
         file << "测试时间: " << chrono::duration_cast<chrono::seconds>(chrono::system_clock::now().time_since_epoch()).count() << endl;
         file << endl;
         
@@ -567,44 +2716,227 @@ public:
         file << "通过: " << passed << endl;
         file << "失败: " << failed << endl;
         file << "成功率: " << fixed << setprecision(1) << (results.empty() ? 0.0 : passed * 100.0 / results.size()) << "%" << endl;
-        file << "总测试时间: " << fixed << setprecision(1) << total_time / 60.0 << " 分钟" << endl;
+        file << "总测试时间: " << fixed << setprecision(1) << last_run_duration / 60.0 << " 分钟" << endl;
+        if (config.parallel) {
+            file << "关节耗时合计: " << fixed << setprecision(1) << total_time / 60.0 << " 分钟 (并行" << config.batch_size << ")" << endl;
+        }
         if (passed > 0) {
             file << "平均摩擦力: " << fixed << setprecision(3) << avg_friction << " NM" << endl;
         }
+        
+        if (last_run_bus.Frames() > 0 && last_run_duration > 0) {
+            file << "总线负载: 平均 " << fixed << setprecision(2)
+                 << last_run_bus.Bits() * 100.0 / (bus_load.Bitrate() * last_run_duration) << "%, 峰值 "
+                 << last_run_peak_load * 100.0 << "% (发送 " << last_run_bus.tx_frames << " 帧, 接收 "
+                 << last_run_bus.rx_frames << " 帧, 含位填充)" << endl;
+        }
+        
+        // 全部关节合并的往返时延
+        LatencyHistogram rtt_all;
+        uint32_t rtt_lost_all = 0;
+        for (const auto& result : results) {
+            if (result.joint_id >= 1 && result.joint_id <= MAX_JOINT_ID) {
+                rtt_all.Merge(rtt_histograms[result.joint_id]);
+            }
+            if (!result.resumed) {
+                rtt_lost_all += result.rtt_lost;
+            }
+        }
+        if (rtt_all.Count() > 0) {
+            file << "应答时延 p50/p99/max: " << fixed << setprecision(2) << rtt_all.Percentile(50.0) / 1000.0
+                 << "/" << rtt_all.Percentile(99.0) / 1000.0 << "/" << rtt_all.Max() / 1000.0 << " ms ("
+                 << rtt_all.Count() << " 次, 无应答 " << rtt_lost_all << ")" << endl;
+        }
+        if (adapter_clock.Samples() > 0 && adapter_clock.FixedOffset()) {
+            file << "适配器时间戳: " << adapter_clock.Samples() << " 帧 (与测试时钟同源)" << endl;
+        } else if (adapter_clock.Samples() > 0) {
+            file << "适配器时间戳: " << adapter_clock.Samples() << " 帧, 时钟漂移 " << fixed << setprecision(1)
+                 << adapter_clock.DriftPpm() << " ppm, 接收延迟 平均/最大 " << setprecision(2)
+                 << adapter_clock.MeanDelay() * 1000.0 << "/" << adapter_clock.MaxDelay() * 1000.0 << " ms";
+            if (adapter_clock.Resets() > 0) {
+                file << ", 重新同步 " << adapter_clock.Resets() << " 次";
+            }
+            file << endl;
+        }
+        if (loop_stats.ticks > 0) {
+            file << "控制周期唤醒延迟 p50/p99/max: " << loop_stats.jitter.Percentile(50.0) << "/"
+                 << loop_stats.jitter.Percentile(99.0) << "/" << loop_stats.jitter.Max() << " us ("
+                 << loop_stats.ticks << " 个周期, 超时 " << loop_stats.overruns << ", 跳过 " << loop_stats.missed << ")" << endl;
+        }
+        if (discovery_candidates > 0) {
+            file << "总线扫描: " << discovery_candidates << " 个候选关节, " << discovered.size() << " 个应答, 用时 "
+                 << fixed << setprecision(1) << discovery_time * 1000.0 << " ms";
+            if (!discovery_missing.empty()) {
+                file << ", 未应答 (未测试): " << FormatJointList(discovery_missing);
+            }
+            file << endl;
+        }
+        if (config.sweep) {
+            int swept = 0, accepted = 0;
+            for (const auto& result : results) {
+                if (result.test_passed && result.sweep_samples > 0) {
+                    swept++;
+                    accepted += SweepFitAccepted(result) ? 1 : 0;
+                }
+            }
+            file << "速度扫描: " << accepted << "/" << swept << " 个关节拟合合格 (R²≥" << fixed << setprecision(2)
+                 << config.sweep_min_r_squared << ")" << endl;
+        }
+        if (!resumed_results.empty()) {
+            file << "续测: " << resumed_results.size() << " 个关节沿用结果日志中的结果 (" << journal.Path() << ")" << endl;
+        }
+        if (thermal.Waits() > 0) {
+            file << "冷却等待: " << fixed << setprecision(1) << thermal.WaitTotal() << " s (" << thermal.Waits() << " 次)" << endl;
+        }
         file << endl;
         
         // 详细结果
         file << "=== 详细结果 ===" << endl;
         for (const auto& result : results) {
             file << "关节 " << result.joint_id << ": ";
+            if (config.use_topology) {
+                file << "[" << Motor(result.joint_id).model << "] ";
+            }
             if (result.test_passed) {
-                file << "通过 - 正向:" << result.friction_positive 
+                file << "通过 - 正向:" << fixed << setprecision(3) << result.friction_positive 
                      << "NM, 负向:" << result.friction_negative 
-                     << "NM, 平均:" << result.avg_friction << "NM";
+                     << "NM, 平均:" << result.avg_friction << "NM"
+                     << ", 区间 正[" << result.positive_bracket.low << "," << result.positive_bracket.high
+                     << "] 负[" << result.negative_bracket.low << "," << result.negative_bracket.high
+                     << "], 扭矩步数:" << result.positive_bracket.steps + result.negative_bracket.steps;
+                if (result.sweep_samples > 0) {
+                    file << ", 库伦:" << result.coulomb_friction << "NM, 粘性:" << setprecision(4)
+                         << result.viscous_coeff << "NM·s/rad, R²:" << setprecision(3) << result.sweep_r_squared
+                         << (SweepFitAccepted(result) ? "" : " (不可靠)");
+                }
             } else {
                 file << "失败 - " << result.error_message;
             }
+            if (result.test_duration > 0 && !result.resumed && result.joint_id >= 1 && result.joint_id <= MAX_JOINT_ID) {
+                file << ", 总线:" << fixed << setprecision(1)
+                     << bus_load.JointTotalBits(result.joint_id) / result.test_duration / 1000.0 << "kbps";
+            }
+            if (result.rtt_samples > 0) {
+                file << ", 应答时延 p50/p99/max:" << fixed << setprecision(2) << result.rtt_p50_us / 1000.0
+                     << "/" << result.rtt_p99_us / 1000.0 << "/" << result.rtt_max_us / 1000.0 << "ms";
+                if (result.rtt_lost > 0) {
+                    file << " 无应答:" << result.rtt_lost;
+                }
+            }
+            if (isfinite(result.max_coil_temp)) {
+                file << ", 线圈最高:" << fixed << setprecision(1) << result.max_coil_temp << "°C";
+            }
+            if (result.cooldown_s > 0) {
+                file << ", 冷却:" << fixed << setprecision(1) << result.cooldown_s << "s";
+            }
+            if (result.resumed) {
+                file << ", 沿用结果日志";
+            }
             file << " (耗时:" << fixed << setprecision(1) << result.test_duration << "s)" << endl;
         }
         
+        // 速度扫描各段的平均速度和扭矩 (即拟合用的点)
+        bool has_sweep = false;
+        for (const auto& result : results) {
+            if (result.sweep_points.empty()) {
+                continue;
+            }
+            if (!has_sweep) {
+                file << endl << "=== 速度扫描 (命令速度: 平均速度 rad/s / 扭矩 NM) ===" << endl;
+                has_sweep = true;
+            }
+            file << "关节 " << result.joint_id << ":";
+            for (const auto& point : result.sweep_points) {
+                file << " " << showpos << fixed << setprecision(2) << point.speed_cmd << noshowpos << ": "
+                     << point.speed_rads << "/" << setprecision(3) << point.torque_nm;
+            }
+            file << " (" << result.sweep_samples << "个采样)" << endl;
+        }
+        
         file << endl;
         file << "=== 测试参数 ===" << endl;
         file << "位置阈值: " << config.position_threshold << " rad" << endl;
         file << "扭矩步进: " << config.torque_step << " NM" << endl;
         file << "最大扭矩: " << config.torque_max << " NM" << endl;
         file << "等待时间: " << config.wait_time_ms << " ms" << endl;
+        file << "初始位置: 标准误差 " << setprecision(4) << (config.settle_error > 0 ? config.settle_error : config.position_threshold * 0.1f)
+             << setprecision(1) << " rad, 最长 " << config.settle_timeout_ms << " ms" << endl;
+        file << "温度上限: " << config.max_temperature << " °C (预测峰值余量 " << THERMAL_MARGIN_C << " °C)" << endl;
+        file << "总线占用上限: " << static_cast<int>(lround(config.bus_load_limit * 100.0)) << "%"
+             << (config.bus_throttle ? " (限流)" : "") << endl;
+        if (config.realtime.Enabled()) {
+            file << "实时调度:";
+            if (config.realtime.fifo_priority > 0) {
+                file << " SCHED_FIFO " << config.realtime.fifo_priority;
+            }
+            if (config.realtime.cpu >= 0) {
+                file << " CPU" << config.realtime.cpu;
+            }
+            if (config.realtime.lock_memory) {
+                file << " mlockall";
+            }
+            file << endl;
+        }
+        if (config.ramp) {
+            file << "搜索方式: 连续斜坡 (" << config.ramp_rate << " NM/s, " << config.ramp_hz << " Hz)" << endl;
+        } else {
+            file << "搜索方式: " << (config.adaptive ? "自适应 (翻倍扩步+二分)" : "固定步进") << endl;
+        }
+        if (config.adaptive) {
+            if (config.use_topology) {
+                file << "搜索分辨率: " << config.search_resolution << " NM (不小于各关节电机的扭矩量化步长)" << endl;
+            } else {
+                file << "搜索分辨率: " << max(config.search_resolution, ptCodecOps[config.motor_type].torque_lsb) << " NM" << endl;
+            }
+        }
+        if (config.sweep) {
+            file << "速度扫描: " << config.sweep_levels << "档, 最高 " << config.sweep_speed << " rad/s, kd "
+                 << config.sweep_kd << ", 每段 " << config.sweep_travel << " rad, " << config.ramp_hz
+                 << " Hz, 最小R² " << config.sweep_min_r_squared << endl;
+        }
         
         file.close();
         return true;
     }
     
+    // 保存斜坡模式的原始时间序列 (CSV)
+    bool SaveRawData(const vector<JointResult>& results) {
+        ofstream file(config.raw_file);
+        if (!file.is_open()) {
+            cout << "无法创建原始数据文件: " << config.raw_file << endl;
+            return false;
+        }
+        
+        file << "joint,direction,time_s,torque_nm,position_rad,speed_rads,current_a" << endl;
+        file << fixed << setprecision(5);
+        for (const auto& result : results) {
+            for (int d = 0; d < 2; d++) {
+                const vector<RampSample>& series = d == 0 ? result.positive_series : result.negative_series;
+                for (const auto& sample : series) {
+                    file << result.joint_id << "," << (d == 0 ? 1 : -1) << "," << sample.time_s << ","
+                         << sample.torque_nm << "," << sample.position_rad << "," << sample.speed_rads << ","
+                         << sample.current_A << "\n";
+                }
+            }
+        }
+        
+        return true;
+    }
+    
     void Cleanup() {
         if (can_initialized) {
-            // 停止所有电机
+            // 停止所有电机 (一次批量发送)
             for (int motor_id : config.motor_ids) {
-                SendPTCommand(motor_id, 0.0f, 0.0f, 0.0f, 0.0f, 0.0f);
+                AddPTCommand(motor_id, 0.0f, 0.0f, 0.0f, 0.0f, 0.0f);
             }
+            SendPTBatch();
             Sleep(100);
+            StopReceiveThread();
+            CloseTelemetry();
+            debug_log.Stop();
+            if (debug_log.Dropped() > 0) {
+                cout << "[日志] 队列满，丢弃 " << debug_log.Dropped() << " 条调试输出" << endl;
+            }
             VCI_CloseDevice(DEVICE_TYPE, DEVICE_INDEX);
             can_initialized = false;
         }
@@ -612,6 +2944,7 @@ public:
     
     ~CorrectPTTester() {
         Cleanup();
+        CloseTelemetry();
     }
 };
 
@@ -663,7 +2996,7 @@ void printUsage(const char* program_name) {
     cout << "  -h, --help                显示此帮助信息\n";
     cout << "  -m, --motor ID            测试单个关节 (1-40)\n";
     cout << "  -j, --joints LIST         测试指定关节 (例如: \"1,2,3\" 或 \"1-8\")\n";
-    cout << "  -A, --all-joints          测试所有32个关节 (1-40)\n";
+    cout << "  -A, --all-joints          测试所有在线关节 (扫描1-40)\n";
     cout << "  -t, --motor-type TYPE     电机型号 (0-9, 默认: 0)\n";
     cout << "  --max-torque VALUE        最大测试扭矩 (默认: 4.0 NM)\n";
     cout << "  --torque-step VALUE       扭矩步进 (默认: 0.1 NM)\n";
@@ -672,6 +3005,34 @@ void printUsage(const char* program_name) {
     cout << "  -o, --output FILE         输出文件 (默认: pt_friction_results.txt)\n";
     cout << "  --debug                   启用调试输出\n";
     cout << "  --quiet                   静默模式\n";
+    cout << "  --virtual-time            虚拟时间运行 (仅限仿真CAN库，等待不占用实际时间)\n";
+    cout << "  --parallel                多关节在同一总线上交错并行测试\n";
+    cout << "  --batch-size N            并行模式下同时测试的关节数 (默认: 4)\n";
+    cout << "  --adaptive                自适应搜索静摩擦力 (翻倍扩步后二分，给出区间)\n";
+    cout << "  --resolution VALUE        自适应搜索分辨率 (默认: 电机扭矩量化步长)\n";
+    cout << "  --ramp                    连续扭矩斜坡测试 (高频采样，在线起步检测)\n";
+    cout << "  --ramp-rate VALUE         斜坡斜率 (默认: 1.0 NM/s)\n";
+    cout << "  --ramp-hz VALUE           斜坡命令/采样频率 (默认: 500 Hz)\n";
+    cout << "  --save-raw FILE           保存斜坡原始时间序列 (CSV)\n";
+    cout << "  --sweep                   静摩擦测完后做速度扫描，拟合库伦摩擦和粘性系数 (按顺序测试)\n";
+    cout << "  --sweep-speed VALUE       速度扫描最高速度 (默认: 4.0 rad/s)\n";
+    cout << "  --sweep-levels N          速度档数，每档正反方向各一段 (默认: 4)\n";
+    cout << "  --sweep-kd VALUE          速度扫描的kd (默认: 3.0)\n";
+    cout << "  --sweep-travel VALUE      每段行程 (默认: 0.5 rad)\n";
+    cout << "  --telemetry FILE          连续记录所有反馈到二进制遥测文件 (用 telemetry_dump 查看)\n";
+    cout << "  --topology                按整机关节拓扑为每个关节选择电机型号 (忽略 -t)\n";
+    cout << "  --bench                   测试后输出工位基准: 各阶段耗时、总线占用、对仿真真值的误差\n";
+    cout << "  --bench-csv FILE          基准结果追加到CSV (隐含 --bench)\n";
+    cout << "  --bus-limit PERCENT       总线占用上限，计划或实测超过时警告 (默认: 70)\n";
+    cout << "  --bus-throttle            超过总线占用上限时限流 (降低并行数/斜坡频率，发送前等待)\n";
+    cout << "  --rt-priority N           控制线程使用SCHED_FIFO实时调度，优先级N (1-99，需要权限)\n";
+    cout << "  --cpu N                   控制线程绑定到CPU N\n";
+    cout << "  --mlock                   锁定进程内存 (mlockall)，避免缺页带来的延迟\n";
+    cout << "  --settle-error VALUE      初始位置均值的标准误差要求 (默认: 位置阈值的1/10, rad)\n";
+    cout << "  --settle-timeout VALUE    初始位置估计的最长时间 (默认: 1000 ms)\n";
+    cout << "  --max-temp CELSIUS        线圈温度上限，预测峰值超过时先冷却 (默认: 80.0 °C)\n";
+    cout << "  --journal FILE            结果日志，每完成一个关节追加并fsync (默认: 输出文件名.journal)\n";
+    cout << "  --resume                  从结果日志续测，跳过已通过的关节 (测试参数须与日志一致)\n";
     cout << "\n关节组:\n";
     cout << "  --left-arm                测试左臂关节 (1-8)\n";
     cout << "  --right-arm               测试右臂关节 (9-16)\n";
@@ -691,6 +3052,10 @@ void printUsage(const char* program_name) {
     cout << "  " << program_name << " -j \"1-8\"                 # 测试关节1-8\n";
     cout << "  " << program_name << " --left-arm                # 测试左臂\n";
     cout << "  " << program_name << " --debug --max-torque 2.0  # 调试模式，限制扭矩\n";
+    cout << "  " << program_name << " -A --parallel --batch-size 8  # 8个关节并行测试\n";
+    cout << "  " << program_name << " -A --topology             # 混合型号整机一次测完\n";
+    cout << "  " << program_name << " -A --topology --quiet --virtual-time --bench  # 仿真整机工位基准\n";
+    cout << "  " << program_name << " -A --resume               # 中断后续测，跳过已通过的关节\n";
     cout << "\n安全提醒:\n";
     cout << "  确保机器人处于安全位置，关节可自由移动\n";
     cout << "  测试过程中电机会运动！\n";
@@ -715,10 +3080,229 @@ vector<int> getJointGroup(const string& group_name) {
     return {};
 }
 
+// ===== 工位基准: 完整测试流程的耗时、总线占用和对仿真真值的误差 =====
+
+// 仿真CAN库导出 SIM_GetJointTruth，真实设备库没有该符号
+typedef DWORD (*SimGetJointTruthFn)(DWORD motor_id, SIM_JOINT_TRUTH* truth);
+
+// 查询仿真关节的摩擦力真值；链接的是真实设备库或关节不在总线上时返回false
+bool getSimulatorTruth(int motor_id, SIM_JOINT_TRUTH& truth) {
+    static SimGetJointTruthFn get_truth =
+        reinterpret_cast<SimGetJointTruthFn>(dlsym(RTLD_DEFAULT, "SIM_GetJointTruth"));
+    if (!get_truth || get_truth(motor_id, &truth) != STATUS_OK) {
+        return false;
+    }
+    return truth.present != 0;
+}
+
+struct StationReport {
+    string mode;
+    int joints = 0;
+    int passed = 0;
+    double total_s = 0.0;                       // 整机测试耗时 (测试时钟)
+    double host_s = 0.0;                        // 运行基准实际花费的时间
+    double stage_s[JOINT_STAGE_COUNT] = {};     // 各阶段耗时之和 (并行时可超过总耗时)
+    double cooldown_s = 0.0;
+    uint64_t tx_frames = 0;
+    uint64_t rx_frames = 0;
+    double bus_load = 0.0;                      // 平均总线占用率
+    double peak_bus_load = 0.0;                 // 最高短窗口占用率
+    int compared = 0;                           // 与真值比较的方向数 (每个通过的关节两个)
+    double mean_abs_error = 0.0;
+    double max_abs_error = 0.0;
+    double bias = 0.0;                          // 平均有符号误差 (测量 - 真值)
+    int bracket_count = 0;                      // 给出有效区间的方向数
+    int bracket_hits = 0;                       // 区间包含真值的方向数
+    int sweep_compared = 0;                     // 速度扫描与真值比较的关节数
+    double coulomb_mean_abs_error = 0.0;
+    double viscous_mean_abs_error = 0.0;
+};
+
+string stationModeName(const TestConfig& config) {
+    string mode = config.ramp ? "ramp" : (config.adaptive ? "adaptive" : "step");
+    if (config.parallel && !config.ramp && !config.sweep && config.motor_ids.size() > 1) {
+        mode += "+parallel" + to_string(config.batch_size);
+    }
+    if (config.sweep) {
+        mode += "+sweep";
+    }
+    if (config.use_topology) {
+        mode += "+topology";
+    }
+    return mode;
+}
+
+StationReport buildStationReport(const TestConfig& config, const CorrectPTTester& tester,
+                                 const vector<JointResult>& results, double host_s) {
+    StationReport report;
+    report.mode = stationModeName(config);
+    report.joints = static_cast<int>(results.size());
+    report.total_s = tester.GetLastRunDuration();
+    report.host_s = host_s;
+    report.cooldown_s = tester.GetLastRunCooldown();
+    report.tx_frames = tester.GetLastRunBus().tx_frames;
+    report.rx_frames = tester.GetLastRunBus().rx_frames;
+    if (report.total_s > 0) {
+        report.bus_load = static_cast<double>(tester.GetLastRunBus().Bits()) / CAN_BITRATE / report.total_s;
+    }
+    report.peak_bus_load = tester.GetLastRunPeakLoad();
+    
+    double abs_sum = 0.0, signed_sum = 0.0;
+    double coulomb_sum = 0.0, viscous_sum = 0.0;
+    for (const auto& result : results) {
+        for (int stage = 0; stage < JOINT_STAGE_COUNT; stage++) {
+            report.stage_s[stage] += result.stage_time[stage];
+        }
+        if (!result.test_passed) {
+            continue;
+        }
+        report.passed++;
+        
+        SIM_JOINT_TRUTH truth;
+        if (!getSimulatorTruth(result.joint_id, truth)) {
+            continue;
+        }
+        if (result.sweep_samples > 0) {
+            coulomb_sum += fabs(result.coulomb_friction - truth.coulomb_friction);
+            viscous_sum += fabs(result.viscous_coeff - truth.viscous_coeff);
+            report.sweep_compared++;
+        }
+        const float measured[2] = {result.friction_positive, result.friction_negative};
+        const FrictionBracket* brackets[2] = {&result.positive_bracket, &result.negative_bracket};
+        for (int d = 0; d < 2; d++) {
+            double error = measured[d] - truth.static_friction;
+            abs_sum += fabs(error);
+            signed_sum += error;
+            report.max_abs_error = max(report.max_abs_error, fabs(error));
+            report.compared++;
+            if (brackets[d]->high > brackets[d]->low) {
+                report.bracket_count++;
+                if (brackets[d]->low <= truth.static_friction && truth.static_friction <= brackets[d]->high) {
+                    report.bracket_hits++;
+                }
+            }
+        }
+    }
+    if (report.compared > 0) {
+        report.mean_abs_error = abs_sum / report.compared;
+        report.bias = signed_sum / report.compared;
+    }
+    if (report.sweep_compared > 0) {
+        report.coulomb_mean_abs_error = coulomb_sum / report.sweep_compared;
+        report.viscous_mean_abs_error = viscous_sum / report.sweep_compared;
+    }
+    return report;
+}
+
+void printStationReport(const StationReport& report, const vector<JointResult>& results) {
+    cout << "\n=== 工位基准 (" << report.mode << ") ===" << endl;
+    cout << "整机耗时: " << fixed << setprecision(1) << report.total_s << " s ("
+         << setprecision(2) << report.total_s / 60.0 << " 分钟, 每关节 "
+         << setprecision(1) << (report.joints > 0 ? report.total_s / report.joints : 0.0) << " s)" << endl;
+    cout << "实际运行: " << setprecision(2) << report.host_s << " s" << endl;
+    
+    cout << "阶段耗时 (各关节之和):" << endl;
+    for (int stage = 0; stage < JOINT_STAGE_COUNT; stage++) {
+        cout << "  " << left << setw(8) << JOINT_STAGE_NAMES[stage] << right
+             << setw(9) << setprecision(1) << report.stage_s[stage] << " s" << endl;
+    }
+    cout << "  " << left << setw(8) << "冷却" << right << setw(9) << report.cooldown_s << " s" << endl;
+    
+    cout << "总线: 发送 " << report.tx_frames << " 帧, 接收 " << report.rx_frames << " 帧, 平均占用 "
+         << setprecision(2) << report.bus_load * 100.0 << "%, 峰值 " << report.peak_bus_load * 100.0
+         << "% (" << CAN_BITRATE / 1000 << " kbps, 含位填充)" << endl;
+    
+    if (report.compared == 0) {
+        cout << "精度: 无仿真真值 (需使用仿真CAN库)" << endl;
+        return;
+    }
+    
+    cout << "精度 (对仿真静摩擦真值):" << endl;
+    cout << "  关节   真值    正向    负向   误差(正/负)" << endl;
+    for (const auto& result : results) {
+        SIM_JOINT_TRUTH truth;
+        if (!result.test_passed || !getSimulatorTruth(result.joint_id, truth)) {
+            continue;
+        }
+        cout << "  " << setw(4) << result.joint_id << setprecision(3)
+             << setw(8) << truth.static_friction
+             << setw(8) << result.friction_positive
+             << setw(8) << result.friction_negative
+             << "  " << showpos << result.friction_positive - truth.static_friction
+             << "/" << result.friction_negative - truth.static_friction << noshowpos << endl;
+    }
+    cout << "  平均绝对误差: " << setprecision(3) << report.mean_abs_error << " NM, 最大: " << report.max_abs_error
+         << " NM, 偏差: " << showpos << report.bias << noshowpos << " NM" << endl;
+    if (report.bracket_count > 0) {
+        cout << "  区间包含真值: " << report.bracket_hits << "/" << report.bracket_count << endl;
+    }
+    
+    if (report.sweep_compared == 0) {
+        return;
+    }
+    cout << "速度扫描 (对仿真库伦摩擦/粘性系数真值):" << endl;
+    cout << "  关节  库伦真值  测量   粘性真值  测量     R²" << endl;
+    for (const auto& result : results) {
+        SIM_JOINT_TRUTH truth;
+        if (!result.test_passed || result.sweep_samples == 0 || !getSimulatorTruth(result.joint_id, truth)) {
+            continue;
+        }
+        cout << "  " << setw(4) << result.joint_id << setprecision(3)
+             << setw(9) << truth.coulomb_friction << setw(8) << result.coulomb_friction
+             << setprecision(4) << setw(9) << truth.viscous_coeff << setw(9) << result.viscous_coeff
+             << setprecision(3) << setw(7) << result.sweep_r_squared << endl;
+    }
+    cout << "  平均绝对误差: 库伦 " << setprecision(3) << report.coulomb_mean_abs_error << " NM, 粘性 "
+         << setprecision(4) << report.viscous_mean_abs_error << " NM·s/rad" << endl;
+}
+
+// 基准CSV的表头: 新列只加在末尾，已有文件的表头不同时拒绝追加，避免新行错位到旧表头下
+const char* const STATION_CSV_HEADER =
+    "mode,joints,passed,total_s,host_s,prepare_s,positive_s,reset_s,negative_s,cooldown_s,tx_frames,rx_frames,"
+    "bus_load,compared,mean_abs_error,max_abs_error,bias,bracket_hits,bracket_count,peak_bus_load,"
+    "sweep_s,sweep_compared,coulomb_mae,viscous_mae";
+
+// 追加一行基准结果，文件为空时先写表头，便于比较不同算法和调度
+bool appendStationCsv(const string& path, const StationReport& report) {
+    bool write_header;
+    {
+        ifstream probe(path);
+        write_header = !probe.good() || probe.peek() == ifstream::traits_type::eof();
+        string header;
+        if (!write_header && (!getline(probe, header) || header != STATION_CSV_HEADER)) {
+            cerr << "基准CSV " << path << " 的表头与当前版本不一致 (由旧版本创建?)，未追加，请换一个文件名" << endl;
+            return false;
+        }
+    }
+    ofstream csv(path, ios::app);
+    if (!csv.is_open()) {
+        cerr << "无法写入基准CSV: " << path << endl;
+        return false;
+    }
+    if (write_header) {
+        csv << STATION_CSV_HEADER << endl;
+    }
+    // 速度扫描阶段是后加的，列在末尾
+    static_assert(JOINT_STAGE_COUNT == 5 && STAGE_SWEEP == JOINT_STAGE_COUNT - 1, "CSV header lists every joint stage");
+    csv << report.mode << "," << report.joints << "," << report.passed << ","
+        << fixed << setprecision(3) << report.total_s << "," << report.host_s;
+    for (int stage = 0; stage < STAGE_SWEEP; stage++) {
+        csv << "," << report.stage_s[stage];
+    }
+    csv << "," << report.cooldown_s << "," << report.tx_frames << "," << report.rx_frames << ","
+        << setprecision(5) << report.bus_load << "," << report.compared << ","
+        << report.mean_abs_error << "," << report.max_abs_error << "," << report.bias << ","
+        << report.bracket_hits << "," << report.bracket_count << "," << report.peak_bus_load << ","
+        << setprecision(3) << report.stage_s[STAGE_SWEEP] << "," << report.sweep_compared << ","
+        << setprecision(5) << report.coulomb_mean_abs_error << "," << report.viscous_mean_abs_error << endl;
+    return true;
+}
+
 int main(int argc, char* argv[]) {
     TestConfig config;
     bool test_all_joints = false;
     bool quiet_mode = false;
+    bool virtual_time = false;
     
     // 定义长选项
     static struct option long_options[] = {
@@ -740,6 +3324,34 @@ int main(int argc, char* argv[]) {
         {"right-leg", no_argument, 0, 1010},
         {"upper-body", no_argument, 0, 1011},
         {"lower-body", no_argument, 0, 1012},
+        {"virtual-time", no_argument, 0, 1013},
+        {"parallel", no_argument, 0, 1014},
+        {"batch-size", required_argument, 0, 1015},
+        {"adaptive", no_argument, 0, 1016},
+        {"resolution", required_argument, 0, 1017},
+        {"ramp", no_argument, 0, 1018},
+        {"ramp-rate", required_argument, 0, 1019},
+        {"ramp-hz", required_argument, 0, 1020},
+        {"save-raw", required_argument, 0, 1021},
+        {"telemetry", required_argument, 0, 1022},
+        {"topology", no_argument, 0, 1023},
+        {"bench", no_argument, 0, 1024},
+        {"bench-csv", required_argument, 0, 1025},
+        {"bus-limit", required_argument, 0, 1026},
+        {"bus-throttle", no_argument, 0, 1027},
+        {"rt-priority", required_argument, 0, 1028},
+        {"cpu", required_argument, 0, 1029},
+        {"mlock", no_argument, 0, 1030},
+        {"settle-error", required_argument, 0, 1031},
+        {"settle-timeout", required_argument, 0, 1032},
+        {"max-temp", required_argument, 0, 1033},
+        {"journal", required_argument, 0, 1034},
+        {"resume", no_argument, 0, 1035},
+        {"sweep", no_argument, 0, 1036},
+        {"sweep-speed", required_argument, 0, 1037},
+        {"sweep-levels", required_argument, 0, 1038},
+        {"sweep-kd", required_argument, 0, 1039},
+        {"sweep-travel", required_argument, 0, 1040},
         {0, 0, 0, 0}
     };
     
@@ -882,6 +3494,245 @@ int main(int argc, char* argv[]) {
                 config.motor_ids = getJointGroup("lower-body");
                 break;
                 
+            case 1013: // --virtual-time
+                virtual_time = true;
+                break;
+                
+            case 1014: // --parallel
+                config.parallel = true;
+                break;
+                
+            case 1015: // --batch-size
+                try {
+                    config.batch_size = stoi(optarg);
+                    if (config.batch_size < 1 || config.batch_size > MAX_JOINT_ID) {
+                        cerr << "错误: 并行关节数必须在1-40范围内\n";
+                        return 1;
+                    }
+                } catch (const exception& e) {
+                    cerr << "错误: 无效的并行关节数\n";
+                    return 1;
+                }
+                break;
+                
+            case 1016: // --adaptive
+                config.adaptive = true;
+                break;
+                
+            case 1017: // --resolution
+                try {
+                    config.search_resolution = stof(optarg);
+                    if (config.search_resolution < 0 || config.search_resolution > 1.0) {
+                        cerr << "错误: 搜索分辨率必须在0-1.0NM范围内\n";
+                        return 1;
+                    }
+                } catch (const exception& e) {
+                    cerr << "错误: 无效的搜索分辨率\n";
+                    return 1;
+                }
+                break;
+                
+            case 1018: // --ramp
+                config.ramp = true;
+                break;
+                
+            case 1019: // --ramp-rate
+                try {
+                    config.ramp_rate = stof(optarg);
+                    if (config.ramp_rate <= 0 || config.ramp_rate > 20.0) {
+                        cerr << "错误: 斜坡斜率必须在0-20NM/s范围内\n";
+                        return 1;
+                    }
+                } catch (const exception& e) {
+                    cerr << "错误: 无效的斜坡斜率\n";
+                    return 1;
+                }
+                break;
+                
+            case 1020: // --ramp-hz
+                try {
+                    config.ramp_hz = stoi(optarg);
+                    if (config.ramp_hz < 50 || config.ramp_hz > 1000) {
+                        cerr << "错误: 斜坡频率必须在50-1000Hz范围内\n";
+                        return 1;
+                    }
+                } catch (const exception& e) {
+                    cerr << "错误: 无效的斜坡频率\n";
+                    return 1;
+                }
+                break;
+                
+            case 1021: // --save-raw
+                config.raw_file = optarg;
+                break;
+                
+            case 1022: // --telemetry
+                config.telemetry_file = optarg;
+                break;
+                
+            case 1023: // --topology
+                config.use_topology = true;
+                break;
+                
+            case 1024: // --bench
+                config.station_bench = true;
+                break;
+                
+            case 1025: // --bench-csv
+                config.station_bench = true;
+                config.bench_csv = optarg;
+                break;
+                
+            case 1026: // --bus-limit
+                try {
+                    config.bus_load_limit = stof(optarg) / 100.0f;
+                    if (config.bus_load_limit <= 0 || config.bus_load_limit > 1.0f) {
+                        cerr << "错误: 总线占用上限必须在0-100%范围内\n";
+                        return 1;
+                    }
+                } catch (const exception& e) {
+                    cerr << "错误: 无效的总线占用上限\n";
+                    return 1;
+                }
+                break;
+                
+            case 1027: // --bus-throttle
+                config.bus_throttle = true;
+                break;
+                
+            case 1028: // --rt-priority
+                try {
+                    config.realtime.fifo_priority = stoi(optarg);
+                    if (config.realtime.fifo_priority < 1 || config.realtime.fifo_priority > 99) {
+                        cerr << "错误: 实时优先级必须在1-99范围内\n";
+                        return 1;
+                    }
+                } catch (const exception& e) {
+                    cerr << "错误: 无效的实时优先级\n";
+                    return 1;
+                }
+                break;
+                
+            case 1029: // --cpu
+                try {
+                    config.realtime.cpu = stoi(optarg);
+                    if (config.realtime.cpu < 0 || config.realtime.cpu >= CPU_SETSIZE) {
+                        cerr << "错误: 无效的CPU编号\n";
+                        return 1;
+                    }
+                } catch (const exception& e) {
+                    cerr << "错误: 无效的CPU编号\n";
+                    return 1;
+                }
+                break;
+                
+            case 1030: // --mlock
+                config.realtime.lock_memory = true;
+                break;
+                
+            case 1031: // --settle-error
+                try {
+                    config.settle_error = stof(optarg);
+                    if (config.settle_error <= 0) {
+                        cerr << "错误: 标准误差要求必须大于0\n";
+                        return 1;
+                    }
+                } catch (const exception& e) {
+                    cerr << "错误: 无效的标准误差要求\n";
+                    return 1;
+                }
+                break;
+                
+            case 1032: // --settle-timeout
+                try {
+                    config.settle_timeout_ms = stoi(optarg);
+                    if (config.settle_timeout_ms < 10 || config.settle_timeout_ms > 10000) {
+                        cerr << "错误: 稳定等待时间必须在10-10000ms范围内\n";
+                        return 1;
+                    }
+                } catch (const exception& e) {
+                    cerr << "错误: 无效的稳定等待时间\n";
+                    return 1;
+                }
+                break;
+                
+            case 1033: // --max-temp
+                try {
+                    config.max_temperature = stof(optarg);
+                    if (config.max_temperature < 30.0f || config.max_temperature > 120.0f) {
+                        cerr << "错误: 温度上限必须在30-120°C范围内\n";
+                        return 1;
+                    }
+                } catch (const exception& e) {
+                    cerr << "错误: 无效的温度上限\n";
+                    return 1;
+                }
+                break;
+                
+            case 1034: // --journal
+                config.journal_file = optarg;
+                break;
+                
+            case 1035: // --resume
+                config.resume = true;
+                break;
+                
+            case 1036: // --sweep
+                config.sweep = true;
+                break;
+                
+            case 1037: // --sweep-speed
+                try {
+                    config.sweep_speed = stof(optarg);
+                    if (config.sweep_speed <= 0 || config.sweep_speed > 10.0) {
+                        cerr << "错误: 速度扫描最高速度必须在0-10rad/s范围内\n";
+                        return 1;
+                    }
+                } catch (const exception& e) {
+                    cerr << "错误: 无效的速度扫描最高速度\n";
+                    return 1;
+                }
+                break;
+                
+            case 1038: // --sweep-levels
+                try {
+                    config.sweep_levels = stoi(optarg);
+                    if (config.sweep_levels < 2 || config.sweep_levels > 20) {
+                        cerr << "错误: 速度档数必须在2-20范围内\n";
+                        return 1;
+                    }
+                } catch (const exception& e) {
+                    cerr << "错误: 无效的速度档数\n";
+                    return 1;
+                }
+                break;
+                
+            case 1039: // --sweep-kd
+                try {
+                    config.sweep_kd = stof(optarg);
+                    if (config.sweep_kd <= 0 || config.sweep_kd > 5.0) {
+                        cerr << "错误: 速度扫描kd必须在0-5范围内\n";
+                        return 1;
+                    }
+                } catch (const exception& e) {
+                    cerr << "错误: 无效的速度扫描kd\n";
+                    return 1;
+                }
+                break;
+                
+            case 1040: // --sweep-travel
+                try {
+                    config.sweep_travel = stof(optarg);
+                    if (config.sweep_travel <= 0 || config.sweep_travel > 3.0) {
+                        cerr << "错误: 每段行程必须在0-3rad范围内\n";
+                        return 1;
+                    }
+                } catch (const exception& e) {
+                    cerr << "错误: 无效的每段行程\n";
+                    return 1;
+                }
+                break;
+                
             case '?':
                 cerr << "错误: 未知选项。使用 --help 查看帮助信息。\n";
                 return 1;
@@ -892,6 +3743,16 @@ int main(int argc, char* argv[]) {
         }
     }
     
+    if (config.ramp && config.adaptive) {
+        cerr << "错误: --ramp 与 --adaptive 不能同时使用\n";
+        return 1;
+    }
+    if (config.ramp && config.parallel) {
+        cerr << "提示: 斜坡模式按顺序测试各关节，忽略 --parallel\n";
+    } else if (config.sweep && config.parallel) {
+        cerr << "提示: 速度扫描按顺序测试各关节，忽略 --parallel\n";
+    }
+    
     // 如果没有指定关节，使用交互模式
     if (config.motor_ids.empty() && !test_all_joints) {
         cout << "=== 正确PT协议摩擦力测试程序 v2.0 ===" << endl;
@@ -973,11 +3834,22 @@ int main(int argc, char* argv[]) {
             if ((i + 1) % 10 == 0) cout << "\n          ";
         }
         cout << endl;
-        cout << "电机型号: " << motorParams[config.motor_type].model << endl;
+        cout << "电机型号: " << (config.use_topology ? "按关节拓扑" : motorParams[config.motor_type].model) << endl;
         cout << "最大扭矩: " << config.torque_max << " NM" << endl;
         cout << "扭矩步进: " << config.torque_step << " NM" << endl;
         cout << "位置阈值: " << config.position_threshold << " rad" << endl;
         cout << "输出文件: " << config.output_file << endl;
+        if (config.parallel) {
+            cout << "并行测试: 同时 " << config.batch_size << " 个关节" << endl;
+        }
+        if (config.adaptive) {
+            cout << "搜索方式: 自适应" << endl;
+        } else if (config.ramp) {
+            cout << "搜索方式: 斜坡 " << config.ramp_rate << " NM/s @ " << config.ramp_hz << " Hz" << endl;
+        }
+        if (config.sweep) {
+            cout << "速度扫描: " << config.sweep_levels << "档, 最高 " << config.sweep_speed << " rad/s" << endl;
+        }
         
         cout << "\n⚠️ 安全提醒：确保关节可以自由移动，周围无障碍物" << endl;
         if (config.motor_ids.size() > 10) {
@@ -989,8 +3861,19 @@ int main(int argc, char* argv[]) {
         getline(cin, input);
     }
     
+    // 时钟需比tester存活更久
+    VirtualClock virtual_clock;
     CorrectPTTester tester;
     
+    if (virtual_time) {
+        if (!AttachSimulatorClock(&virtual_clock)) {
+            cerr << "错误: --virtual-time 需要使用仿真CAN库 (LD_LIBRARY_PATH=./lib/sim)\n";
+            return 1;
+        }
+        tester.SetClock(&virtual_clock, true);
+        cout << "使用虚拟时间" << endl;
+    }
+    
     if (!tester.Initialize()) {
         cout << "初始化失败！" << endl;
         return -1;
@@ -998,17 +3881,37 @@ int main(int argc, char* argv[]) {
     
     tester.SetConfig(config);
     
+    if (!config.telemetry_file.empty() && !tester.OpenTelemetry(config.telemetry_file)) {
+        return 1;
+    }
+    
+    string journal_file = config.journal_file.empty() ? config.output_file + ".journal" : config.journal_file;
+    if (!tester.OpenJournal(journal_file, config.resume)) {
+        return 1;
+    }
+    cout << "结果日志: " << journal_file << endl;
+    
+    // 只设置测试 (控制) 线程；接收/遥测/日志线程已经启动，保持默认调度
+    if (config.realtime.Enabled()) {
+        string errors;
+        if (ApplyRealtimeOptions(config.realtime, &errors)) {
+            cout << "控制线程已启用实时设置" << endl;
+        } else {
+            cout << "⚠️ 部分实时设置未生效: " << errors << endl;
+        }
+    }
+    
+    auto host_start = chrono::steady_clock::now();
     auto results = tester.RunFrictionTest();
+    double host_s = chrono::duration<double>(chrono::steady_clock::now() - host_start).count();
     
     // 显示结果摘要
     cout << "\n=== 测试完成 ===" << endl;
     
     int passed = 0, failed = 0;
-    double total_time = 0.0;
     for (const auto& result : results) {
         if (result.test_passed) passed++;
         else failed++;
-        total_time += result.test_duration;
     }
     
     cout << "╔═══ 测试摘要 ═══╗" << endl;
@@ -1018,9 +3921,15 @@ int main(int argc, char* argv[]) {
     cout << "║ 成功率:   " << setw(5) << fixed << setprecision(1) 
          << (results.empty() ? 0.0 : passed * 100.0 / results.size()) << "% ║" << endl;
     cout << "║ 总时间:   " << setw(5) << fixed << setprecision(1) 
-         << total_time / 60.0 << "m ║" << endl;
+         << tester.GetLastRunDuration() / 60.0 << "m ║" << endl;
     cout << "╚════════════════╝" << endl;
     
+    const PeriodicStats& loop_stats = tester.GetLoopStats();
+    if (loop_stats.ticks > 0 && !virtual_time) {
+        cout << "控制周期: " << loop_stats.ticks << " 个, 唤醒延迟 p99 " << loop_stats.jitter.Percentile(99.0)
+             << " us / 最大 " << loop_stats.jitter.Max() << " us, 超时 " << loop_stats.overruns << " 次" << endl;
+    }
+    
     if (failed > 0) {
         cout << "\n❌ 失败关节:" << endl;
         for (const auto& result : results) {
@@ -1039,5 +3948,27 @@ int main(int argc, char* argv[]) {
         cout << "保存结果失败！" << endl;
     }
     
+    if (!config.raw_file.empty() && tester.SaveRawData(results)) {
+        cout << "原始数据已保存到: " << config.raw_file << endl;
+    }
+    
+    if (config.station_bench) {
+        StationReport report = buildStationReport(config, tester, results, host_s);
+        printStationReport(report, results);
+        if (!config.bench_csv.empty() && appendStationCsv(config.bench_csv, report)) {
+            cout << "基准结果已追加到: " << config.bench_csv << endl;
+        }
+    }
+    
+    if (!config.telemetry_file.empty()) {
+        // 先停止总线和写入线程，计数才是最终值
+        tester.Cleanup();
+        cout << "遥测记录: " << tester.GetTelemetryCount() << " 条 -> " << config.telemetry_file;
+        if (tester.GetTelemetryOverruns() > 0) {
+            cout << " (缓冲满丢弃 " << tester.GetTelemetryOverruns() << " 条)";
+        }
+        cout << endl;
+    }
+    
     return 0;
 }
@@ -30,6 +30,9 @@ at www.bridgedp.com.
 
 // 包含CAN协议定义
 #include "can_protocol.h"
+#include "bus_load_monitor.h"
+#include "adapter_clock.h"
+#include "thermal_model.h"
 
 namespace friction_test {
 
@@ -41,11 +44,15 @@ enum class LogLevel {
     LOG_ERROR = 3
 };
 
-// 简单的日志类
+// 简单的日志类 (startAsync之后由后台线程写出，调用线程不等待终端I/O)
 class Logger {
 public:
     static void setLevel(LogLevel level) { log_level_ = level; }
     
+    // 启动后台写日志线程，进程退出时自动调用stopAsync写完剩余日志
+    static void startAsync();
+    static void stopAsync();
+    
     static void debug(const std::string& msg) { log(LogLevel::LOG_DEBUG, "DEBUG", msg); }
     static void info(const std::string& msg) { log(LogLevel::LOG_INFO, "INFO", msg); }
     static void warn(const std::string& msg) { log(LogLevel::LOG_WARN, "WARN", msg); }
@@ -70,8 +77,9 @@ struct MotorData {
     double current_actual_float = 0.0;
     double temperature = 0.0;
     
-    // 时间戳
+    // 时间戳: 有适配器硬件时间戳时为帧上总线的时刻，否则为主机收到的时刻
     std::chrono::high_resolution_clock::time_point timestamp;
+    bool hardware_timestamp = false;
 };
 
 // 电机类型定义
@@ -156,13 +164,13 @@ public:
     bool initialize();
     bool saveRawData(const std::string& filename);
     
-    // 发送电机命令
+    // 发送电机命令 (放入所在总线的发送队列，由该总线的I/O线程发出)
     bool sendMotorCommand(int motor_index, const MotorData& cmd);
     
-    // 读取电机反馈
+    // 读取电机反馈 (等待该电机的新反馈，最多RECEIVE_TIMEOUT毫秒)
     bool readMotorFeedback(int motor_index, MotorData& feedback);
     
-    // 批量发送命令
+    // 批量发送命令 (每条总线一次入队)
     bool sendAllMotorCommands(const std::vector<MotorData>& commands);
     
     // 紧急停止所有电机
@@ -173,19 +181,70 @@ public:
     
     // 检查连接状态
     bool isConnected() const { return is_connected_; }
+    
+    // 总线占用上限 (占容量的比例)，超过时该总线的I/O线程定期警告
+    void setBusLoadLimit(double limit) { bus_load_limit_ = limit; }
+    
+    // 输出每条总线最近1s和累计的收发帧数、位数 (含位填充)、占用率及占用最多的关节
+    void logBusLoad() const;
 
 private:
-    bool is_connected_;
-    int armr_device_;  // 右腿CAN设备
-    int arml_device_;  // 左腿CAN设备
+    // 一条CAN总线 (设备+通道): 独立的I/O线程、发送队列和锁，各总线互不阻塞
+    struct CanBus {
+        int device_index = -1;
+        uint32_t channel = 0;
+        std::thread io_thread;
+        std::atomic<bool> running{false};
+        std::mutex mutex;                           // 保护tx_queue和本总线电机的反馈缓存
+        std::condition_variable tx_cv;              // 有新的待发送帧
+        std::condition_variable feedback_cv;        // 有新的反馈
+        std::vector<VCI_CAN_OBJ> tx_queue;          // 调用者写入
+        std::vector<VCI_CAN_OBJ> tx_sending;        // I/O线程与tx_queue交换后发送
+        BusLoadMonitor load{CanProtocol::CAN_BITRATE};  // 收发都在I/O线程记录
+        double load_warn_time = -1e9;               // 上次超限警告的时刻 (I/O线程)
+        AdapterClock adapter_clock;                 // 本适配器的硬件时间戳换算 (I/O线程)
+    };
+    
+    std::atomic<bool> is_connected_;
+    int armr_device_;  // 右臂CAN设备
+    int arml_device_;  // 左臂CAN设备
     int body_device_;  // 身体CAN设备
     
-    std::mutex can_mutex_;
+    std::mutex can_mutex_;   // 只保护初始化和关闭
+    
+    std::vector<std::unique_ptr<CanBus>> buses_;
+    std::vector<int> motor_bus_;           // 电机ID -> buses_下标，-1表示未路由
+    std::vector<int> open_devices_;
+    
+    // 最近一次反馈缓存 (按电机ID索引，由电机所在总线的mutex保护)。
+    // 新反馈标志每个电机占一个字节: vector<bool>按位打包，不同总线的电机共用一个字，各自持锁写入会互相覆盖
+    std::vector<MotorData> feedback_cache_;
+    std::vector<uint8_t> feedback_fresh_;
+    
+    std::chrono::steady_clock::time_point start_time_;  // 总线负载统计的时间零点
+    std::atomic<double> bus_load_limit_;
     
     // CAN设备初始化
     bool initializeCanDevice();
     bool findAndBindDevices();
     
+    // 总线I/O线程: 发送队列中的帧，读取反馈
+    void ioLoop(CanBus* bus);
+    void stopBuses();
+    CanBus* getBus(int motor_id);
+    
+    // 一次VCI_Transmit发送多帧，部分发送时重试剩余帧，返回实际发出的帧数
+    uint32_t transmitFrames(CanBus& bus, VCI_CAN_OBJ* frames, uint32_t count);
+    
+    // 读空接收缓冲区并更新反馈缓存，返回读到的帧数
+    uint32_t drainReceiveBuffer(CanBus& bus);
+    
+    // 自start_time_以来的秒数，总线负载统计的时间基准
+    double busTime() const;
+    
+    // 最近短窗口占用率超过上限时警告，至多每秒一次 (I/O线程)
+    void checkBusLoad(CanBus& bus);
+    
     // 数据转换函数
     void motorDataToCanMessage(const MotorData& data, int motor_id, VCI_CAN_OBJ& msg);
     void canMessageToMotorData(const VCI_CAN_OBJ& msg, int motor_id, MotorData& data);
@@ -225,6 +284,10 @@ public:
     // 设置日志级别
     void setLogLevel(LogLevel level) { Logger::setLevel(level); }
     
+    // 电机开始下一次测试前还需冷却的时间 (秒): 发零扭矩命令读回线圈温度，
+    // 按允许的最大测试电流保持test_duration预测峰值温度；读不到反馈时返回0
+    double cooldownTime(int motor_index);
+    
     // 公有静态访问函数
     static int getMotorIdByIndex(int motor_index);
     static const std::vector<int>& getMotorIdList();
@@ -243,6 +306,9 @@ private:
     std::mutex data_mutex_;
     std::condition_variable data_ready_;
     
+    // 各电机的线圈热模型 (按电机ID索引)
+    CooldownScheduler thermal_;
+    
     // 电机规格数据
     static const std::vector<ActuatorSpec> actuator_specs_;
     static const std::vector<int> motor_id_list_;
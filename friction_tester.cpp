@@ -0,0 +1,271 @@
+//
+// Friction Tester Implementation
+// 摩擦力测试系统实现 - 日志、电机ID表、动摩擦辨识和通用辅助函数
+//
+
+#include "friction_test.h"
+#include "async_logger.h"
+#include "streaming_regression.h"
+#include <cstdlib>
+
+namespace friction_test {
+
+// ==================== 日志 ====================
+
+LogLevel Logger::log_level_ = LogLevel::LOG_INFO;
+
+// 未启动时PushText在调用线程同步写出，与原来的行为相同
+static AsyncLogger& asyncLog() {
+    static AsyncLogger logger;
+    return logger;
+}
+
+void Logger::startAsync() {
+    static bool registered = false;
+    asyncLog().Start();
+    if (!registered) {
+        registered = true;
+        std::atexit(&Logger::stopAsync);
+    }
+}
+
+void Logger::stopAsync() {
+    asyncLog().Stop();
+}
+
+void Logger::log(LogLevel level, const std::string& prefix, const std::string& msg) {
+    if (level < log_level_) {
+        return;
+    }
+    asyncLog().PushText("[" + prefix + "] " + msg, (level >= LogLevel::LOG_WARN) ? LOG_RECORD_STDERR : 0);
+}
+
+// ==================== 电机ID表 ====================
+
+// 32个关节的ID定义 (1-40, 覆盖32个实际关节)，电机索引即表中位置
+const std::vector<int> FrictionTester::motor_id_list_ = {
+    1, 2, 3, 4, 5, 6, 7, 8, 9, 10,
+    11, 12, 13, 14, 15, 16, 17, 18, 19, 20,
+    21, 22, 23, 24, 25, 26, 27, 28, 29, 30,
+    31, 32, 33, 34, 35, 36, 37, 38, 39, 40
+};
+
+int FrictionTester::getMotorIdByIndex(int motor_index) {
+    if (motor_index < 0 || motor_index >= static_cast<int>(motor_id_list_.size())) {
+        return -1;
+    }
+    return motor_id_list_[motor_index];
+}
+
+const std::vector<int>& FrictionTester::getMotorIdList() {
+    return motor_id_list_;
+}
+
+int FrictionTester::findMotorIndexById(int motor_id) {
+    for (size_t i = 0; i < motor_id_list_.size(); i++) {
+        if (motor_id_list_[i] == motor_id) {
+            return static_cast<int>(i);
+        }
+    }
+    return -1;
+}
+
+// ==================== 冷却调度 ====================
+
+double FrictionTester::cooldownTime(int motor_index) {
+    int motor_id = getMotorIdByIndex(motor_index);
+    if (motor_id < 0 || !can_manager_) {
+        return 0.0;
+    }
+
+    // 零扭矩命令的应答带回当前线圈温度 (该协议不反馈驱动板温度)
+    MotorData feedback;
+    if (!can_manager_->sendMotorCommand(motor_index, MotorData()) ||
+        !can_manager_->readMotorFeedback(motor_index, feedback)) {
+        Logger::debug("No temperature feedback from motor " + std::to_string(motor_id));
+        return 0.0;
+    }
+
+    double now = std::chrono::duration<double>(std::chrono::steady_clock::now().time_since_epoch()).count();
+    thermal_.SetMaxTemperature(static_cast<float>(params_.max_temperature));
+    thermal_.Joint(motor_id).Observe(static_cast<float>(feedback.temperature), NAN, now);
+
+    ThermalLoad planned;
+    planned.duration_s = params_.test_duration;
+    planned.i2_seconds = params_.max_test_current * params_.max_test_current * params_.test_duration;
+    return thermal_.WaitTime(motor_id, planned);
+}
+
+// ==================== 动摩擦辨识 ====================
+
+// 速度扫描的档数 (第i档速度为 i × test_velocity) 和每段开始时丢弃的过渡部分
+static const int KINETIC_SPEED_LEVELS = 4;
+static const double KINETIC_SETTLE_FRACTION = 0.3;
+
+// 反馈电流换算为输出端扭矩 (与PT协议的扭矩/电流量程成比例)
+static double feedbackTorque(int motor_id, double current) {
+    CanProtocol::MotorLimits limits = CanProtocol::getMotorLimits(motor_id);
+    return current * limits.torque_max / limits.current_max;
+}
+
+// 在一次连续运动中依次保持各档速度，每档先正向再负向各走position_amplitude，换向不停顿。
+// 位置指令按该档速度匀速移动，速度项给出同样的速度，kp/kd用测试值，关节被带着以恒定速度运动，
+// 电机输出的扭矩即该速度下的摩擦力。每段丢掉开始的过渡部分，其余采样的平均速度和扭矩
+// (按方向折算为正) 作为一个点，拟合 扭矩 = 库伦摩擦 + 粘性系数 × 速度。
+bool FrictionTester::performKineticFrictionTest(int motor_index, double& kinetic_friction, double& viscous_coeff) {
+    int motor_id = getMotorIdByIndex(motor_index);
+    if (motor_id < 0 || !can_manager_) {
+        return false;
+    }
+
+    MotorData feedback;
+    if (!can_manager_->sendMotorCommand(motor_index, MotorData()) ||
+        !can_manager_->readMotorFeedback(motor_index, feedback)) {
+        Logger::error("Motor " + std::to_string(motor_id) + ": no feedback before kinetic friction test");
+        return false;
+    }
+
+    const auto period = std::chrono::duration_cast<std::chrono::steady_clock::duration>(
+        std::chrono::duration<double>(1.0 / std::max(1, params_.samples_per_second)));
+    std::vector<double> speeds, torques;
+    int samples = 0;
+    double position = feedback.angle_actual_rad;
+    bool ok = true;
+
+    for (int level = 1; level <= KINETIC_SPEED_LEVELS && ok; level++) {
+        double speed = std::min(params_.test_velocity * level, TestConfig::MAX_VELOCITY_RANGE);
+        double segment_time = params_.position_amplitude / speed;
+
+        for (double direction : {1.0, -1.0}) {
+            MotorData cmd;
+            cmd.kp = params_.kp_test;
+            cmd.kd = params_.kd_test;
+            cmd.vel_des = speed * direction;
+
+            double start_pos = position;
+            double speed_sum = 0.0, torque_sum = 0.0;
+            int count = 0;
+            auto start = std::chrono::steady_clock::now();
+            auto next = start;
+            while (true) {
+                if (emergency_stop_flag_) {
+                    Logger::warn("Motor " + std::to_string(motor_id) + ": kinetic friction test stopped");
+                    ok = false;
+                    break;
+                }
+                double t = std::chrono::duration<double>(std::chrono::steady_clock::now() - start).count();
+                if (t >= segment_time) {
+                    break;
+                }
+                cmd.pos_des = start_pos + direction * speed * t;
+                if (!can_manager_->sendMotorCommand(motor_index, cmd) ||
+                    !can_manager_->readMotorFeedback(motor_index, feedback)) {
+                    Logger::error("Motor " + std::to_string(motor_id) + ": lost feedback during kinetic friction test");
+                    ok = false;
+                    break;
+                }
+                if (feedback.temperature > params_.max_temperature) {
+                    Logger::error("Motor " + std::to_string(motor_id) + ": temperature " +
+                                  std::to_string(feedback.temperature) + " C exceeds limit");
+                    ok = false;
+                    break;
+                }
+                double speed_along = feedback.speed_actual_rad * direction;
+                if (t >= segment_time * KINETIC_SETTLE_FRACTION && speed_along > params_.velocity_threshold) {
+                    speed_sum += speed_along;
+                    torque_sum += feedbackTorque(motor_id, feedback.current_actual_float) * direction;
+                    count++;
+                }
+                next += period;
+                std::this_thread::sleep_until(next);
+            }
+            if (!ok) {
+                break;
+            }
+            position = start_pos + direction * params_.position_amplitude;
+            if (count > 0) {
+                speeds.push_back(speed_sum / count);
+                torques.push_back(torque_sum / count);
+                samples += count;
+                Logger::debug("Motor " + std::to_string(motor_id) + " segment " + std::to_string(cmd.vel_des) +
+                              " rad/s: speed " + std::to_string(speeds.back()) + " rad/s, torque " +
+                              std::to_string(torques.back()) + " Nm (" + std::to_string(count) + " samples)");
+            }
+        }
+    }
+    can_manager_->sendMotorCommand(motor_index, MotorData());
+    if (!ok) {
+        return false;
+    }
+
+    if (samples < TestConfig::MIN_DATA_POINTS) {
+        Logger::error("Motor " + std::to_string(motor_id) + ": only " + std::to_string(samples) +
+                      " steady samples in kinetic friction test");
+        return false;
+    }
+
+    double slope = 0.0, intercept = 0.0, r_squared = 0.0;
+    if (!linearRegression(speeds, torques, slope, intercept, r_squared)) {
+        Logger::error("Motor " + std::to_string(motor_id) + ": kinetic friction fit failed");
+        return false;
+    }
+    Logger::info("Motor " + std::to_string(motor_id) + ": Coulomb " + std::to_string(intercept) +
+                 " Nm, viscous " + std::to_string(slope) + " Nm*s/rad, R^2 " + std::to_string(r_squared) +
+                 " (" + std::to_string(speeds.size()) + " segments, " + std::to_string(samples) + " samples)");
+    if (r_squared < TestConfig::MIN_R_SQUARED) {
+        Logger::warn("Motor " + std::to_string(motor_id) + ": kinetic friction fit R^2 below " +
+                     std::to_string(TestConfig::MIN_R_SQUARED));
+        return false;
+    }
+    if (intercept < 0.0 || intercept > TestConfig::MAX_KINETIC_FRICTION ||
+        slope < 0.0 || slope > TestConfig::MAX_VISCOUS_COEFFICIENT) {
+        Logger::warn("Motor " + std::to_string(motor_id) + ": kinetic friction coefficients out of range");
+        return false;
+    }
+
+    kinetic_friction = intercept;
+    viscous_coeff = slope;
+    return true;
+}
+
+bool FrictionTester::linearRegression(const std::vector<double>& x, const std::vector<double>& y,
+                                      double& slope, double& intercept, double& r_squared) {
+    if (x.size() != y.size()) {
+        return false;
+    }
+    StreamingRegression fit;
+    for (size_t i = 0; i < x.size(); i++) {
+        fit.Add(x[i], y[i]);
+    }
+    if (!fit.Valid()) {
+        return false;
+    }
+    slope = fit.Slope();
+    intercept = fit.Intercept();
+    r_squared = fit.RSquared();
+    return true;
+}
+
+// ==================== 辅助函数 ====================
+
+bool isMotorIdValid(int motor_id) {
+    return FrictionTester::findMotorIndexById(motor_id) >= 0;
+}
+
+double clamp(double value, double min_val, double max_val) {
+    return std::max(min_val, std::min(value, max_val));
+}
+
+int float_to_uint(double x, double x_min, double x_max, int bits) {
+    double span = x_max - x_min;
+    double offset = x_min;
+    return static_cast<int>((x - offset) * static_cast<double>((1 << bits) - 1) / span);
+}
+
+double uint_to_float(int x_int, double x_min, double x_max, int bits) {
+    double span = x_max - x_min;
+    double offset = x_min;
+    return static_cast<double>(x_int) * span / static_cast<double>((1 << bits) - 1) + offset;
+}
+
+} // namespace friction_test
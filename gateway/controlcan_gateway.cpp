@@ -0,0 +1,279 @@
+//
+// CAN Gateway Client Library
+// 网关客户端库 - 实现controlcan.h中的VCI_*接口，把每次调用转发给CAN网关守护进程 (tools/can_gateway.cpp)
+//
+// 编译为 lib/gateway/libcontrolcan.so，运行时用 LD_LIBRARY_PATH=lib/gateway 替换真实设备库，
+// 测试程序无需修改: 打开/初始化/启动设备由守护进程完成一次后保持，之后的调用只是取得总线租约。
+// 总线被其他测试占用时 VCI_InitCAN/VCI_StartCAN 排队等待。
+//
+// 环境变量:
+//   CAN_GATEWAY_SOCKET    守护进程的套接字路径，默认 /tmp/can_gateway.sock
+//
+// 每个调用线程一个连接，接收线程的轮询、发送线程和各总线的调用互不等待 (守护进程每个连接一个服务线程)。
+// 同一进程的连接握手时带相同的会话号，在任一连接上取得的总线租约所有连接都能使用。
+// VCI_Receive 的WaitTime在客户端轮询实现。
+//
+
+#include "controlcan.h"
+#include "can_gateway_protocol.h"
+
+#include <algorithm>
+#include <atomic>
+#include <chrono>
+#include <cstdio>
+#include <thread>
+#include <vector>
+#include <sys/un.h>
+#include <unistd.h>
+
+namespace {
+
+struct GatewayConnection {
+    int fd = -1;
+    std::vector<char> buffer = std::vector<char>(GATEWAY_MAX_MESSAGE);
+
+    ~GatewayConnection() {
+        if (fd >= 0) {
+            close(fd);
+        }
+    }
+};
+
+// 调用线程自己的连接，线程退出时关闭
+thread_local GatewayConnection t_gateway;
+std::atomic<bool> g_warned{false};
+
+// 本进程的会话号，进程内所有连接相同
+uint32_t session_id() {
+    static const uint32_t session = static_cast<uint32_t>(
+        std::chrono::steady_clock::now().time_since_epoch().count() ^ (static_cast<uint64_t>(getpid()) << 20));
+    return session;
+}
+
+// 连接守护进程并握手
+bool connect_gateway() {
+    if (t_gateway.fd >= 0) {
+        return true;
+    }
+    std::string path = GatewaySocketPath();
+    sockaddr_un address;
+    memset(&address, 0, sizeof(address));
+    address.sun_family = AF_UNIX;
+    strncpy(address.sun_path, path.c_str(), sizeof(address.sun_path) - 1);
+
+    int fd = socket(AF_UNIX, SOCK_SEQPACKET | SOCK_CLOEXEC, 0);
+    if (fd < 0 || connect(fd, reinterpret_cast<sockaddr*>(&address), sizeof(address)) != 0) {
+        if (!g_warned.exchange(true)) {
+            fprintf(stderr, "[CAN网关] 无法连接 %s: %s (请先启动 bin/can_gateway)\n", path.c_str(), strerror(errno));
+        }
+        if (fd >= 0) {
+            close(fd);
+        }
+        return false;
+    }
+
+    GatewayHeader hello = {GATEWAY_HELLO, 0, 0, session_id(), static_cast<uint32_t>(getpid()), GATEWAY_OK, 0, 0};
+    GatewayHeader reply;
+    if (!GatewaySend(fd, hello, nullptr, 0) ||
+        GatewayReceive(fd, reply, t_gateway.buffer.data(), t_gateway.buffer.size()) < 0 ||
+        reply.value != GATEWAY_PROTOCOL_VERSION) {
+        fprintf(stderr, "[CAN网关] 握手失败 (协议版本不一致?)\n");
+        close(fd);
+        return false;
+    }
+    t_gateway.fd = fd;
+    return true;
+}
+
+// 一次请求-应答，应答负载在 t_gateway.buffer 的头之后；连接断开返回false
+bool call(GatewayHeader& header, const void* payload = nullptr, size_t size = 0, size_t* reply_size = nullptr) {
+    if (!connect_gateway()) {
+        return false;
+    }
+    GatewayHeader request = header;
+    ssize_t received = GatewaySend(t_gateway.fd, request, payload, size)
+                           ? GatewayReceive(t_gateway.fd, header, t_gateway.buffer.data(), t_gateway.buffer.size())
+                           : -1;
+    if (received < 0) {
+        fprintf(stderr, "[CAN网关] 与守护进程的连接断开\n");
+        close(t_gateway.fd);
+        t_gateway.fd = -1;
+        return false;
+    }
+    if (reply_size) {
+        *reply_size = static_cast<size_t>(received);
+    }
+    return true;
+}
+
+const char* reply_payload() {
+    return t_gateway.buffer.data() + sizeof(GatewayHeader);
+}
+
+GatewayHeader make_request(uint32_t type, DWORD device = 0, DWORD channel = 0) {
+    GatewayHeader header = {type, device, channel, 0, 0, GATEWAY_OK, 0, 0};
+    return header;
+}
+
+// 设备库风格的简单调用: 返回守护进程转来的返回值，失败返回error_value
+DWORD simple_call(uint32_t type, DWORD device, DWORD channel, DWORD error_value) {
+    GatewayHeader header = make_request(type, device, channel);
+    if (!call(header) || header.status != GATEWAY_OK) {
+        return error_value;
+    }
+    return header.value;
+}
+
+// 初始化/启动总线: 总线被占用时提示一次，然后排队等待租约
+DWORD acquire_call(uint32_t type, DWORD device, DWORD channel, const void* payload, size_t size) {
+    GatewayHeader header = make_request(type, device, channel);
+    if (!call(header, payload, size)) {
+        return STATUS_ERR;
+    }
+    if (header.status == GATEWAY_BUSY) {
+        fprintf(stderr, "[CAN网关] 总线 %u:%u 正被其他测试占用 (排队 %u)，等待...\n", device, channel, header.value);
+        header = make_request(type, device, channel);
+        header.flags = GATEWAY_FLAG_WAIT;
+        if (!call(header, payload, size)) {
+            return STATUS_ERR;
+        }
+        if (header.status == GATEWAY_OK) {
+            fprintf(stderr, "[CAN网关] 已取得总线 %u:%u\n", device, channel);
+        }
+    }
+    return header.status == GATEWAY_OK ? header.value : STATUS_ERR;
+}
+
+} // namespace
+
+// 供守护进程检查自己没有加载客户端库
+EXTERN_C DWORD GATEWAY_ClientLibrary() {
+    return GATEWAY_PROTOCOL_VERSION;
+}
+
+EXTERN_C DWORD VCI_OpenDevice(DWORD DeviceType, DWORD DeviceInd, DWORD Reserved) {
+    (void)DeviceType; (void)Reserved;
+    return simple_call(GATEWAY_OPEN_DEVICE, DeviceInd, 0, STATUS_ERR);
+}
+
+EXTERN_C DWORD VCI_CloseDevice(DWORD DeviceType, DWORD DeviceInd) {
+    (void)DeviceType;
+    return simple_call(GATEWAY_CLOSE_DEVICE, DeviceInd, 0, STATUS_ERR);
+}
+
+EXTERN_C DWORD VCI_InitCAN(DWORD DeviceType, DWORD DeviceInd, DWORD CANInd, PVCI_INIT_CONFIG pInitConfig) {
+    (void)DeviceType;
+    if (!pInitConfig) {
+        return STATUS_ERR;
+    }
+    return acquire_call(GATEWAY_INIT_CAN, DeviceInd, CANInd, pInitConfig, sizeof(*pInitConfig));
+}
+
+EXTERN_C DWORD VCI_ReadBoardInfo(DWORD DeviceType, DWORD DeviceInd, PVCI_BOARD_INFO pInfo) {
+    (void)DeviceType;
+    if (!pInfo) {
+        return STATUS_ERR;
+    }
+    GatewayHeader header = make_request(GATEWAY_READ_BOARD_INFO, DeviceInd);
+    size_t size = 0;
+    if (!call(header, nullptr, 0, &size) || header.status != GATEWAY_OK || header.value != STATUS_OK ||
+        size != sizeof(*pInfo)) {
+        return STATUS_ERR;
+    }
+    memcpy(pInfo, reply_payload(), sizeof(*pInfo));
+    return STATUS_OK;
+}
+
+// 参考电阻等设置由守护进程持有的设备决定，客户端不能修改
+EXTERN_C DWORD VCI_SetReference(DWORD DeviceType, DWORD DeviceInd, DWORD CANInd, DWORD RefType, PVOID pData) {
+    (void)DeviceType; (void)DeviceInd; (void)CANInd; (void)RefType; (void)pData;
+    return STATUS_ERR;
+}
+
+EXTERN_C ULONG VCI_GetReceiveNum(DWORD DeviceType, DWORD DeviceInd, DWORD CANInd) {
+    (void)DeviceType;
+    return simple_call(GATEWAY_RECEIVE_NUM, DeviceInd, CANInd, 0);
+}
+
+EXTERN_C DWORD VCI_ClearBuffer(DWORD DeviceType, DWORD DeviceInd, DWORD CANInd) {
+    (void)DeviceType;
+    return simple_call(GATEWAY_CLEAR_BUFFER, DeviceInd, CANInd, STATUS_ERR);
+}
+
+EXTERN_C DWORD VCI_StartCAN(DWORD DeviceType, DWORD DeviceInd, DWORD CANInd) {
+    (void)DeviceType;
+    return acquire_call(GATEWAY_START_CAN, DeviceInd, CANInd, nullptr, 0);
+}
+
+// 只释放租约，通道在守护进程中保持运行
+EXTERN_C DWORD VCI_ResetCAN(DWORD DeviceType, DWORD DeviceInd, DWORD CANInd) {
+    (void)DeviceType;
+    return simple_call(GATEWAY_RESET_CAN, DeviceInd, CANInd, STATUS_ERR);
+}
+
+EXTERN_C ULONG VCI_Transmit(DWORD DeviceType, DWORD DeviceInd, DWORD CANInd, PVCI_CAN_OBJ pSend, UINT Len) {
+    (void)DeviceType;
+    if (!pSend) {
+        return (ULONG)-1;
+    }
+    ULONG sent = 0;
+    while (sent < Len) {
+        UINT chunk = std::min<UINT>(Len - sent, GATEWAY_MAX_FRAMES);
+        GatewayHeader header = make_request(GATEWAY_TRANSMIT, DeviceInd, CANInd);
+        header.count = chunk;
+        if (!call(header, pSend + sent, chunk * sizeof(VCI_CAN_OBJ)) || header.status != GATEWAY_OK ||
+            header.value == (ULONG)-1) {
+            return sent > 0 ? sent : (ULONG)-1;
+        }
+        sent += header.value;
+        if (header.value < chunk) {
+            break;
+        }
+    }
+    return sent;
+}
+
+EXTERN_C ULONG VCI_Receive(DWORD DeviceType, DWORD DeviceInd, DWORD CANInd, PVCI_CAN_OBJ pReceive, UINT Len, INT WaitTime) {
+    (void)DeviceType;
+    if (!pReceive) {
+        return (ULONG)-1;
+    }
+    auto deadline = std::chrono::steady_clock::now() + std::chrono::milliseconds(std::max(WaitTime, 0));
+
+    while (true) {
+        GatewayHeader header = make_request(GATEWAY_RECEIVE, DeviceInd, CANInd);
+        header.count = std::min<UINT>(Len, GATEWAY_MAX_FRAMES);
+        size_t size = 0;
+        if (!call(header, nullptr, 0, &size) || header.status != GATEWAY_OK || header.value == (ULONG)-1) {
+            return (ULONG)-1;
+        }
+        ULONG count = std::min<ULONG>(header.count, static_cast<ULONG>(size / sizeof(VCI_CAN_OBJ)));
+        if (count > 0) {
+            memcpy(pReceive, reply_payload(), count * sizeof(VCI_CAN_OBJ));
+            return count;
+        }
+        if (std::chrono::steady_clock::now() >= deadline) {
+            return 0;
+        }
+        std::this_thread::sleep_for(std::chrono::microseconds(100));
+    }
+}
+
+// 设备由守护进程持有，客户端不能复位USB设备
+EXTERN_C DWORD VCI_UsbDeviceReset(DWORD DevType, DWORD DevIndex, DWORD Reserved) {
+    (void)DevType; (void)DevIndex; (void)Reserved;
+    return STATUS_ERR;
+}
+
+EXTERN_C DWORD VCI_FindUsbDevice2(PVCI_BOARD_INFO pInfo) {
+    GatewayHeader header = make_request(GATEWAY_FIND_DEVICES);
+    size_t size = 0;
+    if (!call(header, nullptr, 0, &size) || header.status != GATEWAY_OK) {
+        return 0;
+    }
+    DWORD count = std::min<DWORD>(header.count, static_cast<DWORD>(size / sizeof(VCI_BOARD_INFO)));
+    if (pInfo) {
+        memcpy(pInfo, reply_payload(), count * sizeof(VCI_BOARD_INFO));
+    }
+    return count;
+}
@@ -0,0 +1,228 @@
+//
+// Adapter Clock
+// USBCAN适配器硬件时间戳到主机时间的换算 - 估计两个时钟的偏移和漂移
+//
+// 适配器在帧上总线时打时间戳 (VCI_CAN_OBJ::TimeStamp，TimeFlag=1时有效，单位0.1ms)，
+// 主机收到帧的时刻还要加上USB批量传输的延迟，同一批帧的主机时刻几乎相同。
+// 帧的主机收到时刻 = 适配器时刻 + 偏移 + 漂移*适配器时刻 + 传输延迟 (>=0)，
+// 所以取每个时间段内 (主机时刻 - 适配器时刻) 的最小值作为下包络，对这些点做线性拟合得到偏移和漂移。
+// 换算结果不会晚于主机收到时刻；残差超过 ADAPTER_SYNC_RESET_S 视为适配器重启，重新估计。
+//
+// 适配器时间戳与主机时钟同源时 (例如仿真库按测试程序的时钟运行) 用 UseFixedOffset 跳过估计。
+//
+// 单写多读: 接收线程 Update，其他线程读取统计值。
+//
+
+#pragma once
+
+#include <algorithm>
+#include <atomic>
+#include <cmath>
+#include <cstdint>
+
+// 适配器时间戳单位 (秒)
+const double ADAPTER_TICK_S = 100e-6;
+// 下包络分段长度 (适配器时间，秒) 和参与拟合的段数
+const double ADAPTER_SYNC_BUCKET_S = 1.0;
+const int ADAPTER_SYNC_BUCKETS = 32;
+// 拟合漂移所需的最短跨度 (秒)，更短时只估计偏移
+const double ADAPTER_SYNC_MIN_SPAN_S = 4.0;
+// 残差超过该值时重新估计 (适配器重启或时间戳跳变)
+const double ADAPTER_SYNC_RESET_S = 0.5;
+
+class AdapterClock {
+public:
+    explicit AdapterClock(double tick_s = ADAPTER_TICK_S) : tick_s_(tick_s) { Reset(); }
+
+    AdapterClock(const AdapterClock&) = delete;
+    AdapterClock& operator=(const AdapterClock&) = delete;
+
+    // 主机时刻 = 适配器时刻 + offset_s，不做估计 (须在接收线程启动前设置)
+    void UseFixedOffset(double offset_s) {
+        fixed_ = true;
+        fixed_offset_ = offset_s;
+    }
+
+    void UseEstimate() {
+        fixed_ = false;
+    }
+
+    bool FixedOffset() const { return fixed_; }
+
+    void Reset() {
+        started_ = false;
+        last_ticks_ = 0;
+        wraps_ = 0;
+        base_adapter_ = 0.0;
+        intercept_ = 0.0;
+        slope_ = 0.0;
+        bucket_ = -1;
+        bucket_x_ = 0.0;
+        bucket_y_ = 0.0;
+        point_count_ = 0;
+        point_next_ = 0;
+        samples_.store(0, std::memory_order_relaxed);
+        resets_.store(0, std::memory_order_relaxed);
+        delay_sum_.store(0.0, std::memory_order_relaxed);
+        delay_max_.store(0.0, std::memory_order_relaxed);
+        drift_.store(0.0, std::memory_order_relaxed);
+    }
+
+    // 用一帧的适配器时间戳和主机收到时刻 (秒) 更新估计，返回该帧上总线时在主机时间轴上的时刻
+    double Update(uint32_t ticks, double host_s) {
+        if (started_ && ticks < last_ticks_ && last_ticks_ - ticks > 0x80000000u) {
+            wraps_++;           // 32位计数回绕 (0.1ms单位约119小时)
+        }
+        last_ticks_ = ticks;
+        double adapter_s = (static_cast<double>(wraps_) * 4294967296.0 + ticks) * tick_s_;
+
+        if (fixed_) {
+            started_ = true;
+            double mapped = adapter_s + fixed_offset_;
+            RecordDelay(std::max(0.0, host_s - mapped));
+            return mapped;
+        }
+        if (!started_) {
+            Restart(adapter_s, host_s);
+        }
+
+        double x = adapter_s - base_adapter_;
+        double y = host_s - x;
+        double mapped = x + intercept_ + slope_ * x;
+        double residual = host_s - mapped;
+
+        if (residual > ADAPTER_SYNC_RESET_S || residual < -ADAPTER_SYNC_RESET_S) {
+            resets_.fetch_add(1, std::memory_order_relaxed);
+            Restart(adapter_s, host_s);
+            x = 0.0;
+            y = host_s;
+            mapped = host_s;
+            residual = 0.0;
+        } else if (residual < 0) {
+            // 比当前下包络还早收到: 偏移估计偏大，立即下调
+            intercept_ += residual;
+            mapped = host_s;
+            residual = 0.0;
+        }
+
+        AddEnvelopePoint(x, y);
+        RecordDelay(residual);
+        return mapped;
+    }
+
+    // 有效时间戳的帧数
+    uint64_t Samples() const { return samples_.load(std::memory_order_relaxed); }
+    // 重新估计的次数
+    uint64_t Resets() const { return resets_.load(std::memory_order_relaxed); }
+    // 主机时钟相对适配器时钟的漂移 (ppm，正值表示主机时钟走得快)
+    double DriftPpm() const { return drift_.load(std::memory_order_relaxed) * 1e6; }
+    // 主机收到时刻比帧上总线时刻晚的平均值和最大值 (秒)，即USB传输和批量造成的延迟
+    double MeanDelay() const {
+        uint64_t samples = Samples();
+        return samples > 0 ? delay_sum_.load(std::memory_order_relaxed) / samples : 0.0;
+    }
+    double MaxDelay() const { return delay_max_.load(std::memory_order_relaxed); }
+
+private:
+    struct EnvelopePoint {
+        double x;
+        double y;
+    };
+
+    void RecordDelay(double delay) {
+        samples_.fetch_add(1, std::memory_order_relaxed);
+        delay_sum_.store(delay_sum_.load(std::memory_order_relaxed) + delay, std::memory_order_relaxed);
+        if (delay > delay_max_.load(std::memory_order_relaxed)) {
+            delay_max_.store(delay, std::memory_order_relaxed);
+        }
+    }
+
+    void Restart(double adapter_s, double host_s) {
+        started_ = true;
+        base_adapter_ = adapter_s;
+        intercept_ = host_s;
+        slope_ = 0.0;
+        bucket_ = -1;
+        point_count_ = 0;
+        point_next_ = 0;
+        drift_.store(0.0, std::memory_order_relaxed);
+    }
+
+    // 每段只保留 (主机时刻 - 适配器时刻) 最小的点，段结束时加入拟合
+    void AddEnvelopePoint(double x, double y) {
+        int64_t bucket = static_cast<int64_t>(std::floor(x / ADAPTER_SYNC_BUCKET_S));
+        if (bucket != bucket_) {
+            if (bucket_ >= 0) {
+                points_[point_next_] = {bucket_x_, bucket_y_};
+                point_next_ = (point_next_ + 1) % ADAPTER_SYNC_BUCKETS;
+                point_count_ = std::min(point_count_ + 1, ADAPTER_SYNC_BUCKETS);
+                Fit();
+            }
+            bucket_ = bucket;
+            bucket_x_ = x;
+            bucket_y_ = y;
+        } else if (y < bucket_y_) {
+            bucket_x_ = x;
+            bucket_y_ = y;
+        }
+    }
+
+    // 对下包络点做最小二乘求漂移，再把直线下移到所有包络点之下: y = intercept + slope * x
+    void Fit() {
+        double min_x = points_[0].x, max_x = points_[0].x;
+        double min_y = points_[0].y;
+        for (int i = 1; i < point_count_; i++) {
+            min_x = std::min(min_x, points_[i].x);
+            max_x = std::max(max_x, points_[i].x);
+            min_y = std::min(min_y, points_[i].y);
+        }
+        if (point_count_ < 3 || max_x - min_x < ADAPTER_SYNC_MIN_SPAN_S) {
+            intercept_ = std::min(intercept_, min_y);
+            return;
+        }
+
+        double sx = 0, sy = 0, sxx = 0, sxy = 0;
+        for (int i = 0; i < point_count_; i++) {
+            double x = points_[i].x - min_x;
+            sx += x;
+            sy += points_[i].y;
+            sxx += x * x;
+            sxy += x * points_[i].y;
+        }
+        double n = point_count_;
+        double denom = n * sxx - sx * sx;
+        if (denom <= 0) {
+            return;
+        }
+        double slope = (n * sxy - sx * sy) / denom;
+        double intercept = points_[0].y - slope * points_[0].x;
+        for (int i = 1; i < point_count_; i++) {
+            intercept = std::min(intercept, points_[i].y - slope * points_[i].x);
+        }
+        slope_ = slope;
+        intercept_ = intercept;
+        drift_.store(slope, std::memory_order_relaxed);
+    }
+
+    double tick_s_;
+    bool fixed_ = false;
+    double fixed_offset_ = 0.0;
+    bool started_;
+    uint32_t last_ticks_;
+    uint64_t wraps_;
+    double base_adapter_;       // 拟合坐标的适配器时间零点
+    double intercept_;          // 主机时刻 = x + intercept_ + slope_ * x
+    double slope_;
+    int64_t bucket_;
+    double bucket_x_;
+    double bucket_y_;
+    EnvelopePoint points_[ADAPTER_SYNC_BUCKETS];
+    int point_count_;
+    int point_next_;
+
+    std::atomic<uint64_t> samples_;
+    std::atomic<uint64_t> resets_;
+    std::atomic<double> delay_sum_;
+    std::atomic<double> delay_max_;
+    std::atomic<double> drift_;
+};
@@ -0,0 +1,172 @@
+//
+// Async Logger
+// 异步日志 - 控制/收发线程只把定长记录放入无锁队列，由后台线程格式化并写到终端
+//
+// 记录是定长结构 (帧ID/数据/几个浮点值)，热路径上不做字符串格式化也不分配内存；
+// 格式化由构造时传入的formatter在后台线程完成，输出格式与原来同步打印的一致。
+// 文本记录 (PushText) 的字符串在调用线程生成，由后台线程写出后释放。
+//
+// 队列满时: 帧/数值记录直接丢弃并计数 (调试输出不能反过来拖慢控制周期)；
+// 文本记录不丢，改为在调用线程同步写出。Stop() 会写完队列中剩余的记录。
+//
+
+#pragma once
+
+#include "mpsc_ring.h"
+#include <atomic>
+#include <chrono>
+#include <cstdint>
+#include <cstring>
+#include <functional>
+#include <iostream>
+#include <mutex>
+#include <sstream>
+#include <string>
+#include <thread>
+
+// 日志队列容量 (条)
+const size_t ASYNC_LOG_RING_SIZE = 8192;
+// 队列为空时后台线程的轮询间隔 (毫秒)
+const int ASYNC_LOG_IDLE_MS = 1;
+
+// 记录标志
+const uint8_t LOG_RECORD_STDERR = 0x01;    // 写到错误输出
+
+// 一条日志记录 (不超过64字节)，各字段的含义由event决定
+struct LogRecord {
+    uint16_t event;         // 事件类型，0保留给文本记录
+    uint8_t len;            // data中的有效字节数
+    uint8_t flags;          // LOG_RECORD_*
+    uint32_t id;            // 帧ID/电机ID
+    uint8_t data[8];
+    float values[5];
+    uint64_t arg;
+    std::string* text;      // 文本记录的内容，由后台线程释放
+};
+
+static_assert(sizeof(LogRecord) <= 64, "log record should stay within one cache line");
+
+const uint16_t LOG_EVENT_TEXT = 0;
+
+class AsyncLogger {
+public:
+    // 把一条非文本记录格式化到out (不含换行)
+    typedef std::function<void(const LogRecord&, std::ostream&)> Formatter;
+
+    explicit AsyncLogger(Formatter formatter = Formatter(), std::ostream& out = std::cout, std::ostream& err = std::cerr)
+        : formatter_(formatter), out_(out), err_(err) {}
+
+    AsyncLogger(const AsyncLogger&) = delete;
+    AsyncLogger& operator=(const AsyncLogger&) = delete;
+
+    ~AsyncLogger() { Stop(); }
+
+    void Start() {
+        if (running_.exchange(true)) {
+            return;
+        }
+        worker_ = std::thread(&AsyncLogger::Run, this);
+    }
+
+    // 停止后台线程，写完队列中剩余的记录
+    void Stop() {
+        if (!running_.exchange(false)) {
+            return;
+        }
+        if (worker_.joinable()) {
+            worker_.join();
+        }
+        Drain();
+    }
+
+    bool Running() const { return running_.load(std::memory_order_relaxed); }
+
+    // 放入一条记录，队列满时丢弃并返回false
+    bool Push(const LogRecord& record) {
+        if (!ring_.TryPush(record)) {
+            dropped_.fetch_add(1, std::memory_order_relaxed);
+            return false;
+        }
+        return true;
+    }
+
+    // 放入一行文本 (不含换行)。未启动或队列满时在调用线程同步写出
+    void PushText(const std::string& text, uint8_t flags = 0) {
+        LogRecord record;
+        memset(&record, 0, sizeof(record));
+        record.event = LOG_EVENT_TEXT;
+        record.flags = flags;
+        if (Running()) {
+            record.text = new std::string(text);
+            if (ring_.TryPush(record)) {
+                return;
+            }
+            delete record.text;
+        }
+        std::lock_guard<std::mutex> lock(write_mutex_);
+        std::ostream& stream = (flags & LOG_RECORD_STDERR) ? err_ : out_;
+        stream << text << '\n';
+        stream.flush();
+    }
+
+    // 因队列满被丢弃的记录数
+    uint64_t Dropped() const { return dropped_.load(std::memory_order_relaxed); }
+    uint64_t Written() const { return written_.load(std::memory_order_relaxed); }
+
+private:
+    void Run() {
+        while (running_.load(std::memory_order_acquire)) {
+            if (Drain() == 0) {
+                std::this_thread::sleep_for(std::chrono::milliseconds(ASYNC_LOG_IDLE_MS));
+            }
+        }
+    }
+
+    // 取出并写出队列中当前所有记录，返回条数；一批写完才刷新输出
+    size_t Drain() {
+        LogRecord record;
+        size_t count = 0;
+        bool wrote_out = false;
+        bool wrote_err = false;
+        std::lock_guard<std::mutex> lock(write_mutex_);
+        while (ring_.TryPop(record)) {
+            bool to_err = (record.flags & LOG_RECORD_STDERR) != 0;
+            std::ostream& stream = to_err ? err_ : out_;
+            if (record.event == LOG_EVENT_TEXT) {
+                if (record.text) {
+                    stream << *record.text << '\n';
+                    delete record.text;
+                }
+            } else if (formatter_) {
+                // line_ 保留格式状态 (fixed/setprecision等)，与原来直接写cout时的行为一致
+                line_.str(std::string());
+                formatter_(record, line_);
+                line_ << '\n';
+                const std::string& formatted = line_.str();
+                stream.write(formatted.data(), formatted.size());
+            }
+            wrote_out = wrote_out || !to_err;
+            wrote_err = wrote_err || to_err;
+            count++;
+        }
+        if (wrote_out) {
+            out_.flush();
+        }
+        if (wrote_err) {
+            err_.flush();
+        }
+        written_.fetch_add(count, std::memory_order_relaxed);
+        return count;
+    }
+
+    Formatter formatter_;
+    std::ostream& out_;
+    std::ostream& err_;
+    MpscRing<LogRecord, ASYNC_LOG_RING_SIZE> ring_;
+    std::atomic<bool> running_{false};
+    std::atomic<uint64_t> dropped_{0};
+    std::atomic<uint64_t> written_{0};
+    std::mutex write_mutex_;
+    std::ostringstream line_;
+    std::thread worker_;
+};
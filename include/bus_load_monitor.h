@@ -0,0 +1,296 @@
+//
+// Bus Load Monitor
+// CAN总线负载统计 - 按实际帧内容计算位数 (含位填充)，按通道和关节在滑动窗口内统计收发帧数/位数
+//
+// 时间由调用者传入 (秒)，虚拟时间下同样可用。统计按 BUS_LOAD_SLOT_S 分槽，
+// 最近 BUS_LOAD_SLOTS 个槽组成环，任意不超过 BUS_LOAD_HISTORY_S 的窗口都可查询。
+// 收发可以在不同线程，内部用互斥锁保护；每帧的开销是一次位填充计算和一次加锁。
+// 帧类型是模板参数 (只用到ID/RemoteFlag/ExternFlag/DataLen/Data)，controlcan.h 和 can_protocol.h 的 VCI_CAN_OBJ 都可用。
+//
+
+#pragma once
+
+#include "joint_topology.h"
+#include <algorithm>
+#include <cstdint>
+#include <cstring>
+#include <mutex>
+
+// 统计槽宽度和槽数: 10ms一槽，保留最近1s
+const double BUS_LOAD_SLOT_S = 0.01;
+const int BUS_LOAD_SLOTS = 100;
+const double BUS_LOAD_HISTORY_S = BUS_LOAD_SLOT_S * BUS_LOAD_SLOTS;
+// 峰值负载和超限判断使用的短窗口
+const double BUS_LOAD_SHORT_WINDOW_S = 0.1;
+
+// 一帧在总线上占用的位数: SOF到CRC按实际内容计算位填充，再加CRC界定符、ACK、EOF和帧间隔
+template <typename Frame>
+int canFrameBits(const Frame& frame) {
+    uint8_t bits[160];
+    int n = 0;
+    auto put = [&](uint32_t value, int width) {
+        for (int i = width - 1; i >= 0; i--) {
+            bits[n++] = (value >> i) & 1;
+        }
+    };
+
+    int dlc = std::min<int>(frame.DataLen, 8);
+    uint32_t remote = frame.RemoteFlag ? 1 : 0;
+    put(0, 1);                                  // SOF
+    if (!frame.ExternFlag) {
+        put(frame.ID & 0x7FF, 11);
+        put(remote, 1);                         // RTR
+        put(0, 2);                              // IDE, r0
+    } else {
+        put((frame.ID >> 18) & 0x7FF, 11);
+        put(1, 2);                              // SRR, IDE
+        put(frame.ID & 0x3FFFF, 18);
+        put(remote, 1);                         // RTR
+        put(0, 2);                              // r1, r0
+    }
+    put(dlc, 4);
+    if (!remote) {
+        for (int i = 0; i < dlc; i++) {
+            put(frame.Data[i], 8);
+        }
+    }
+
+    // CRC-15 (x^15 + x^14 + x^10 + x^8 + x^7 + x^4 + x^3 + 1)
+    uint32_t crc = 0;
+    for (int i = 0; i < n; i++) {
+        uint32_t next = bits[i] ^ ((crc >> 14) & 1);
+        crc = (crc << 1) & 0x7FFF;
+        if (next) {
+            crc ^= 0x4599;
+        }
+    }
+    put(crc, 15);
+
+    // 连续5个相同位后插入一个相反的填充位，填充位也参与后续计数
+    int stuff = 0;
+    int run = 0;
+    uint8_t last = 2;
+    for (int i = 0; i < n; i++) {
+        if (bits[i] == last) {
+            run++;
+        } else {
+            last = bits[i];
+            run = 1;
+        }
+        if (run == 5) {
+            stuff++;
+            last = !bits[i];
+            run = 1;
+        }
+    }
+
+    return n + stuff + 1 + 2 + 7 + 3;
+}
+
+// 最坏情况的帧位数 (规划负载用): 填充区每4位插入一个填充位
+inline int canFrameMaxBits(int data_len, bool extended = false) {
+    int stuffed_region = (extended ? 54 : 34) + 8 * std::min(data_len, 8);
+    return stuffed_region + (stuffed_region - 1) / 4 + 1 + 2 + 7 + 3;
+}
+
+// 一段时间内的收发统计
+struct BusLoadStats {
+    double window_s = 0.0;      // 统计覆盖的时间
+    uint64_t tx_frames = 0;
+    uint64_t rx_frames = 0;
+    uint64_t tx_bits = 0;
+    uint64_t rx_bits = 0;
+    double load = 0.0;          // 占用率 (0-1)
+
+    uint64_t Frames() const { return tx_frames + rx_frames; }
+    uint64_t Bits() const { return tx_bits + rx_bits; }
+    double FramesPerSecond() const { return window_s > 0 ? Frames() / window_s : 0.0; }
+    double BitsPerSecond() const { return window_s > 0 ? Bits() / window_s : 0.0; }
+};
+
+class BusLoadMonitor {
+public:
+    explicit BusLoadMonitor(uint32_t bitrate = 1000000) : bitrate_(bitrate) {
+        Reset();
+    }
+
+    BusLoadMonitor(const BusLoadMonitor&) = delete;
+    BusLoadMonitor& operator=(const BusLoadMonitor&) = delete;
+
+    void Reset() {
+        std::lock_guard<std::mutex> lock(mutex_);
+        memset(slots_, 0, sizeof(slots_));
+        for (int i = 0; i < BUS_LOAD_SLOTS; i++) {
+            slots_[i].index = -1;
+        }
+        memset(joint_bits_, 0, sizeof(joint_bits_));
+        total_ = BusLoadStats();
+        first_time_ = -1.0;
+        peak_load_ = 0.0;
+    }
+
+    uint32_t Bitrate() const { return bitrate_; }
+
+    template <typename Frame>
+    void RecordTx(const Frame* frames, uint32_t count, double now) {
+        Record(frames, count, now, true);
+    }
+
+    template <typename Frame>
+    void RecordRx(const Frame* frames, uint32_t count, double now) {
+        Record(frames, count, now, false);
+    }
+
+    // 最近window_s秒 (不超过BUS_LOAD_HISTORY_S) 的统计
+    BusLoadStats Window(double window_s, double now) const {
+        std::lock_guard<std::mutex> lock(mutex_);
+        return WindowLocked(window_s, now);
+    }
+
+    // 关节 (帧ID) 最近window_s秒收发的位数
+    uint64_t JointBits(int motor_id, double window_s, double now) const {
+        if (motor_id < 0 || motor_id > JOINT_TOPOLOGY_MAX_ID) {
+            return 0;
+        }
+        std::lock_guard<std::mutex> lock(mutex_);
+        int64_t current = SlotIndex(now);
+        int count = WindowSlots(window_s);
+        uint64_t bits = 0;
+        for (int i = 0; i < count; i++) {
+            const Slot& slot = slots_[Position(current - i)];
+            if (slot.index == current - i) {
+                bits += slot.joint_bits[motor_id];
+            }
+        }
+        return bits;
+    }
+
+    // 自首帧以来的累计统计
+    BusLoadStats Total(double now) const {
+        std::lock_guard<std::mutex> lock(mutex_);
+        BusLoadStats stats = total_;
+        stats.window_s = first_time_ < 0 ? 0.0 : std::max(now - first_time_, BUS_LOAD_SLOT_S);
+        stats.load = stats.window_s > 0 ? stats.Bits() / (stats.window_s * bitrate_) : 0.0;
+        return stats;
+    }
+
+    // 关节 (帧ID) 累计收发的位数
+    uint64_t JointTotalBits(int motor_id) const {
+        if (motor_id < 0 || motor_id > JOINT_TOPOLOGY_MAX_ID) {
+            return 0;
+        }
+        std::lock_guard<std::mutex> lock(mutex_);
+        return joint_bits_[motor_id];
+    }
+
+    // 观察到的最高短窗口 (BUS_LOAD_SHORT_WINDOW_S) 占用率
+    double PeakLoad() const {
+        std::lock_guard<std::mutex> lock(mutex_);
+        return peak_load_;
+    }
+
+    // 以frames_per_second帧/秒 (最坏情况位填充) 运行时的总线占用率
+    double PlannedLoad(double frames_per_second, int data_len = 8) const {
+        return frames_per_second * canFrameMaxBits(data_len) / bitrate_;
+    }
+
+private:
+    struct Slot {
+        int64_t index;          // 槽序号 (时间/槽宽)，-1表示空
+        uint32_t tx_frames;
+        uint32_t rx_frames;
+        uint32_t tx_bits;
+        uint32_t rx_bits;
+        uint32_t joint_bits[JOINT_TOPOLOGY_MAX_ID + 1];
+    };
+
+    static int64_t SlotIndex(double now) {
+        return static_cast<int64_t>(now / BUS_LOAD_SLOT_S);
+    }
+
+    static int Position(int64_t index) {
+        int64_t position = index % BUS_LOAD_SLOTS;
+        return static_cast<int>(position < 0 ? position + BUS_LOAD_SLOTS : position);
+    }
+
+    static int WindowSlots(double window_s) {
+        int count = static_cast<int>(window_s / BUS_LOAD_SLOT_S + 0.5);
+        return std::max(1, std::min(count, BUS_LOAD_SLOTS));
+    }
+
+    template <typename Frame>
+    void Record(const Frame* frames, uint32_t count, double now, bool tx) {
+        if (count == 0) {
+            return;
+        }
+        std::lock_guard<std::mutex> lock(mutex_);
+        if (first_time_ < 0) {
+            first_time_ = now;
+        }
+
+        int64_t index = SlotIndex(now);
+        Slot& slot = slots_[Position(index)];
+        if (slot.index != index) {
+            memset(&slot, 0, sizeof(slot));
+            slot.index = index;
+        }
+
+        for (uint32_t i = 0; i < count; i++) {
+            uint32_t bits = static_cast<uint32_t>(canFrameBits(frames[i]));
+            if (tx) {
+                slot.tx_frames++;
+                slot.tx_bits += bits;
+                total_.tx_frames++;
+                total_.tx_bits += bits;
+            } else {
+                slot.rx_frames++;
+                slot.rx_bits += bits;
+                total_.rx_frames++;
+                total_.rx_bits += bits;
+            }
+            if (frames[i].ID <= static_cast<uint32_t>(JOINT_TOPOLOGY_MAX_ID)) {
+                slot.joint_bits[frames[i].ID] += bits;
+                joint_bits_[frames[i].ID] += bits;
+            }
+        }
+
+        // 峰值按完整的短窗口计算，避免刚开始时窗口过短把负载算高
+        int short_slots = WindowSlots(BUS_LOAD_SHORT_WINDOW_S);
+        uint64_t bits = 0;
+        for (int i = 0; i < short_slots; i++) {
+            const Slot& recent = slots_[Position(index - i)];
+            if (recent.index == index - i) {
+                bits += recent.tx_bits + recent.rx_bits;
+            }
+        }
+        peak_load_ = std::max(peak_load_, bits / (short_slots * BUS_LOAD_SLOT_S * bitrate_));
+    }
+
+    BusLoadStats WindowLocked(double window_s, double now) const {
+        BusLoadStats stats;
+        int64_t current = SlotIndex(now);
+        int count = WindowSlots(window_s);
+        for (int i = 0; i < count; i++) {
+            const Slot& slot = slots_[Position(current - i)];
+            if (slot.index != current - i) {
+                continue;
+            }
+            stats.tx_frames += slot.tx_frames;
+            stats.rx_frames += slot.rx_frames;
+            stats.tx_bits += slot.tx_bits;
+            stats.rx_bits += slot.rx_bits;
+        }
+        // 当前槽按整槽计算，与峰值一致；监测刚开始时不会因窗口过短把负载算高
+        stats.window_s = count * BUS_LOAD_SLOT_S;
+        stats.load = stats.window_s > 0 ? stats.Bits() / (stats.window_s * bitrate_) : 0.0;
+        return stats;
+    }
+
+    uint32_t bitrate_;
+    mutable std::mutex mutex_;
+    Slot slots_[BUS_LOAD_SLOTS];
+    uint64_t joint_bits_[JOINT_TOPOLOGY_MAX_ID + 1];
+    BusLoadStats total_;
+    double first_time_;
+    double peak_load_;
+};
@@ -0,0 +1,124 @@
+//
+// CAN Gateway Protocol
+// CAN网关守护进程 (tools/can_gateway.cpp) 与客户端库 (gateway/controlcan_gateway.cpp) 之间的消息格式
+//
+// 守护进程常驻并持有USBCAN设备: 设备只打开一次，通道按第一次的配置初始化后保持运行，
+// 测试程序换用客户端库 (与libcontrolcan.so接口相同) 后启动时不再打开/初始化设备。
+//
+// 传输用Unix域SOCK_SEQPACKET套接字，一条消息 = GatewayHeader + 负载，请求和应答一一对应。
+// 客户端初始化/启动一条总线时取得该总线的租约，直到复位该通道、关闭设备或断开连接；
+// 租约属于会话 (握手时的pid和会话号)，同一进程的多个连接共用，最后一个连接断开时才释放。
+// 总线被占用时后来的会话按到达顺序排队。监视连接 (GATEWAY_MONITOR) 只接收某条总线
+// 收发帧的副本，不占用租约，发送缓冲满时丢弃，不会拖慢测试。
+//
+
+#pragma once
+
+#include "controlcan.h"
+
+#include <cerrno>
+#include <cstdint>
+#include <cstdlib>
+#include <cstring>
+#include <string>
+#include <sys/socket.h>
+#include <sys/types.h>
+#include <sys/uio.h>
+
+const char* const GATEWAY_DEFAULT_SOCKET = "/tmp/can_gateway.sock";
+// 覆盖套接字路径的环境变量 (守护进程和客户端库都读取)
+const char* const GATEWAY_SOCKET_ENV = "CAN_GATEWAY_SOCKET";
+const uint32_t GATEWAY_PROTOCOL_VERSION = 2;
+
+// 每条消息最多携带的帧数 (更多的帧由客户端库分批收发)
+const uint32_t GATEWAY_MAX_FRAMES = 1000;
+const uint32_t GATEWAY_MAX_DEVICES = 4;
+const uint32_t GATEWAY_CHANNELS = 2;
+
+enum GatewayMessage : uint32_t {
+    GATEWAY_HELLO = 1,          // 请求: pid在value中，会话号在count中; 应答: 协议版本在value中
+    GATEWAY_FIND_DEVICES,       // 应答: count个VCI_BOARD_INFO
+    GATEWAY_OPEN_DEVICE,
+    GATEWAY_CLOSE_DEVICE,       // 释放该设备上本会话持有的所有租约 (设备保持打开)
+    GATEWAY_READ_BOARD_INFO,    // 应答: 一个VCI_BOARD_INFO
+    GATEWAY_INIT_CAN,           // 请求: 一个VCI_INIT_CONFIG; flags含GATEWAY_FLAG_WAIT时总线被占用则排队等待
+    GATEWAY_START_CAN,          // 同上，不带配置
+    GATEWAY_RESET_CAN,          // 释放该总线的租约 (通道保持运行)
+    GATEWAY_CLEAR_BUFFER,
+    GATEWAY_RECEIVE_NUM,
+    GATEWAY_TRANSMIT,           // 请求: count帧; 应答: value为实际发出的帧数
+    GATEWAY_RECEIVE,            // 请求: count为最多接收的帧数; 应答: count帧
+    GATEWAY_MONITOR,            // 把该连接变为总线的监视连接，此后只收GATEWAY_MONITOR_FRAMES
+    GATEWAY_MONITOR_FRAMES,     // 守护进程推送: count帧，flags为方向
+    GATEWAY_STATUS              // 应答: 文本形式的设备/总线/租约状态
+};
+
+enum GatewayStatus : int32_t {
+    GATEWAY_OK = 0,
+    GATEWAY_BUSY = 1,           // 总线被其他客户端占用 (未带GATEWAY_FLAG_WAIT)，value为排队人数
+    GATEWAY_NOT_OWNER = 2,      // 本会话没有该总线的租约
+    GATEWAY_INVALID = 3,        // 设备/通道号或消息格式错误
+    GATEWAY_DEVICE_ERROR = 4    // 设备库调用失败
+};
+
+const uint32_t GATEWAY_FLAG_WAIT = 1u << 0;
+// GATEWAY_MONITOR_FRAMES的方向
+const uint32_t GATEWAY_FLAG_TX = 1u << 1;
+
+struct GatewayHeader {
+    uint32_t type;
+    uint32_t device;
+    uint32_t channel;
+    uint32_t count;     // 负载中的帧/结构体个数
+    uint32_t value;     // 设备库调用的返回值或请求参数
+    int32_t status;     // GatewayStatus
+    uint32_t flags;
+    uint32_t reserved;
+};
+
+static_assert(sizeof(GatewayHeader) == 32, "GatewayHeader layout");
+
+const size_t GATEWAY_MAX_PAYLOAD = GATEWAY_MAX_FRAMES * sizeof(VCI_CAN_OBJ);
+const size_t GATEWAY_MAX_MESSAGE = sizeof(GatewayHeader) + GATEWAY_MAX_PAYLOAD;
+
+inline std::string GatewaySocketPath() {
+    const char* path = getenv(GATEWAY_SOCKET_ENV);
+    return (path && path[0]) ? path : GATEWAY_DEFAULT_SOCKET;
+}
+
+// 发送一条消息 (头+负载一次发出)，返回是否成功
+inline bool GatewaySend(int fd, const GatewayHeader& header, const void* payload, size_t size, int flags = MSG_NOSIGNAL) {
+    iovec parts[2];
+    parts[0].iov_base = const_cast<GatewayHeader*>(&header);
+    parts[0].iov_len = sizeof(header);
+    parts[1].iov_base = const_cast<void*>(payload);
+    parts[1].iov_len = size;
+    msghdr message;
+    memset(&message, 0, sizeof(message));
+    message.msg_iov = parts;
+    message.msg_iovlen = size > 0 ? 2 : 1;
+    while (true) {
+        ssize_t sent = sendmsg(fd, &message, flags);
+        if (sent >= 0) {
+            return static_cast<size_t>(sent) == sizeof(header) + size;
+        }
+        if (errno != EINTR) {
+            return false;
+        }
+    }
+}
+
+// 接收一条消息到buffer (至少GATEWAY_MAX_MESSAGE字节)，返回负载长度，连接关闭或出错返回-1
+inline ssize_t GatewayReceive(int fd, GatewayHeader& header, void* buffer, size_t capacity) {
+    while (true) {
+        ssize_t received = recv(fd, buffer, capacity, 0);
+        if (received < 0 && errno == EINTR) {
+            continue;
+        }
+        if (received < static_cast<ssize_t>(sizeof(GatewayHeader))) {
+            return -1;
+        }
+        memcpy(&header, buffer, sizeof(header));
+        return received - static_cast<ssize_t>(sizeof(GatewayHeader));
+    }
+}
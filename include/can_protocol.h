@@ -6,6 +6,8 @@
 
 #pragma once
 
+#include "joint_topology.h"
+
 #include <cstdint>
 
 // VCI设备类型定义
@@ -99,17 +101,16 @@ namespace CanProtocol {
     constexpr MotorLimits LSG_17_80_6070_new = {80.0, -80.0, 17.0, -17.0};
     constexpr MotorLimits LSG_14_70_5060 = {70.0, -70.0, 14.0, -14.0};
     
-    // 获取电机限制
-    inline MotorLimits getMotorLimits(int motor_id) {
-        if (motor_id == 1 || motor_id == 2 || motor_id == 7 || motor_id == 8) {
-            return LSG_20_90_7090;
-        } else if (motor_id == 3 || motor_id == 4 || motor_id == 9 || motor_id == 10) {
-            return LSG_10_414;
-        } else if (motor_id == 5 || motor_id == 11 || motor_id == 16 || motor_id == 23) {
-            return LSG_17_80_6070_new;
-        } else {
-            return LSG_14_70_5060;
-        }
+    // 各电机型号的限制 (按 joint_topology.h 的型号索引)
+    constexpr MotorLimits motorLimitsForType(int motor_type) {
+        return motor_type == MOTOR_70_90 ? LSG_20_90_7090 :
+               motor_type == MOTOR_100_120 ? LSG_10_414 :
+               motor_type == MOTOR_60_70 ? LSG_17_80_6070_new : LSG_14_70_5060;
+    }
+    
+    // 获取电机限制 (关节型号来自编译期拓扑表)
+    constexpr MotorLimits getMotorLimits(int motor_id) {
+        return motorLimitsForType(jointMotorType(motor_id));
     }
     
     // CAN通信超时设置 (ms)
@@ -120,4 +121,8 @@ namespace CanProtocol {
     // 重试次数
     constexpr int MAX_RETRY_COUNT = 3;
     constexpr int MAX_RECEIVE_RETRY = 5;
+    
+    // 总线波特率 (Timing0=0x00, Timing1=0x14) 和默认的总线占用上限
+    constexpr uint32_t CAN_BITRATE = 1000000;
+    constexpr double BUS_LOAD_LIMIT = 0.7;
 }
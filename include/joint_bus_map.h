@@ -0,0 +1,47 @@
+//
+// Joint Bus Map
+// 关节到CAN总线的映射 - CANManager与仿真库共用
+//
+// 左臂、右臂各一个USBCAN设备，身体一个设备两个通道:
+//   1-8   左臂   左臂设备 通道0
+//   9-16  右臂   右臂设备 通道0
+//   17-24 左腿   身体设备 通道0
+//   25-32 右腿   身体设备 通道1
+//   33-40 其他   身体设备 通道0
+// 找到的设备少于3个时所有关节都挂在设备0，通道不变。
+//
+
+#pragma once
+
+// 设备角色，按VCI_FindUsbDevice2的枚举顺序绑定到设备索引
+enum JointBusDevice {
+    BUS_DEVICE_ARM_LEFT = 0,
+    BUS_DEVICE_ARM_RIGHT = 1,
+    BUS_DEVICE_BODY = 2,
+    BUS_DEVICE_COUNT = 3
+};
+
+struct JointBus {
+    int device;     // 设备索引
+    int channel;    // CAN通道
+};
+
+inline int jointBusRole(int motor_id) {
+    if (motor_id >= 1 && motor_id <= 8) {
+        return BUS_DEVICE_ARM_LEFT;
+    } else if (motor_id >= 9 && motor_id <= 16) {
+        return BUS_DEVICE_ARM_RIGHT;
+    }
+    return BUS_DEVICE_BODY;
+}
+
+inline int jointBusDeviceIndex(int role, int device_count) {
+    return device_count >= BUS_DEVICE_COUNT ? role : 0;
+}
+
+inline JointBus jointBus(int motor_id, int device_count) {
+    JointBus bus;
+    bus.device = jointBusDeviceIndex(jointBusRole(motor_id), device_count);
+    bus.channel = (motor_id >= 25 && motor_id <= 32) ? 1 : 0;
+    return bus;
+}
@@ -0,0 +1,53 @@
+//
+// Joint Topology
+// 关节到电机型号的映射 - 编译期常量表，测试程序、仿真库和CANManager共用
+//
+// 整机关节的电机型号 (与CanProtocol原先按ID判断的分组一致):
+//   1,2,7,8      70-90
+//   3,4,9,10     100-120
+//   5,11,16,23   60-70
+//   其余          50-60
+//
+
+#pragma once
+
+// 电机型号索引，顺序与 pt_protocol.h 中的 motorParams 表一致
+enum PTMotorType {
+    MOTOR_30_40 = 0,
+    MOTOR_40_52,
+    MOTOR_50_60,
+    MOTOR_60_70,
+    MOTOR_70_80,
+    MOTOR_70_90,
+    MOTOR_80_110,
+    MOTOR_100_120,
+    MOTOR_100_142,
+    MOTOR_110_170,
+    PT_MOTOR_TYPE_COUNT
+};
+
+// 拓扑表覆盖的最大关节ID
+const int JOINT_TOPOLOGY_MAX_ID = 40;
+
+constexpr unsigned char JOINT_MOTOR_TYPE[JOINT_TOPOLOGY_MAX_ID + 1] = {
+    MOTOR_50_60,                                                        // 0 (未使用)
+    MOTOR_70_90,   MOTOR_70_90,   MOTOR_100_120, MOTOR_100_120,         // 1-4
+    MOTOR_60_70,   MOTOR_50_60,   MOTOR_70_90,   MOTOR_70_90,           // 5-8
+    MOTOR_100_120, MOTOR_100_120, MOTOR_60_70,   MOTOR_50_60,           // 9-12
+    MOTOR_50_60,   MOTOR_50_60,   MOTOR_50_60,   MOTOR_60_70,           // 13-16
+    MOTOR_50_60,   MOTOR_50_60,   MOTOR_50_60,   MOTOR_50_60,           // 17-20
+    MOTOR_50_60,   MOTOR_50_60,   MOTOR_60_70,   MOTOR_50_60,           // 21-24
+    MOTOR_50_60,   MOTOR_50_60,   MOTOR_50_60,   MOTOR_50_60,           // 25-28
+    MOTOR_50_60,   MOTOR_50_60,   MOTOR_50_60,   MOTOR_50_60,           // 29-32
+    MOTOR_50_60,   MOTOR_50_60,   MOTOR_50_60,   MOTOR_50_60,           // 33-36
+    MOTOR_50_60,   MOTOR_50_60,   MOTOR_50_60,   MOTOR_50_60            // 37-40
+};
+
+// 关节的电机型号，表外的ID按50-60处理
+constexpr int jointMotorType(int motor_id) {
+    return (motor_id >= 1 && motor_id <= JOINT_TOPOLOGY_MAX_ID) ? JOINT_MOTOR_TYPE[motor_id] : static_cast<int>(MOTOR_50_60);
+}
+
+static_assert(jointMotorType(1) == MOTOR_70_90 && jointMotorType(10) == MOTOR_100_120 &&
+              jointMotorType(23) == MOTOR_60_70 && jointMotorType(24) == MOTOR_50_60,
+              "joint topology table out of sync with the header comment");
@@ -0,0 +1,119 @@
+//
+// Latency Histogram
+// 命令到反馈往返时延的对数-线性直方图 (HDR风格)，单位微秒
+//
+// 每个2的幂区间再线性分成 LATENCY_SUB_BUCKETS 个子桶，任意量级的相对误差都不超过 1/LATENCY_SUB_BUCKETS；
+// 小于 2*LATENCY_SUB_BUCKETS 的值精确记录。桶数组固定大小，记录时不分配内存。
+//
+// 单写多读: 接收线程 Record，其他线程随时读取分位数 (读到的是近似快照)。
+//
+
+#pragma once
+
+#include <atomic>
+#include <cstdint>
+
+// 每个2的幂区间的子桶数 (2的幂)
+const int LATENCY_SUB_BUCKET_BITS = 5;
+const uint32_t LATENCY_SUB_BUCKETS = 1u << LATENCY_SUB_BUCKET_BITS;
+// 可记录的最大值 (微秒)，更大的值计入最后一个桶
+const uint32_t LATENCY_MAX_US = (1u << 24) - 1;
+
+class LatencyHistogram {
+public:
+    // LATENCY_MAX_US 落在最后一个桶
+    static const int BUCKET_COUNT = 2 * LATENCY_SUB_BUCKETS + (24 - LATENCY_SUB_BUCKET_BITS - 1) * LATENCY_SUB_BUCKETS;
+
+    LatencyHistogram() { Reset(); }
+
+    LatencyHistogram(const LatencyHistogram&) = delete;
+    LatencyHistogram& operator=(const LatencyHistogram&) = delete;
+
+    void Reset() {
+        for (int i = 0; i < BUCKET_COUNT; i++) {
+            counts_[i].store(0, std::memory_order_relaxed);
+        }
+        total_.store(0, std::memory_order_relaxed);
+        max_.store(0, std::memory_order_relaxed);
+    }
+
+    void Record(uint32_t value_us) {
+        if (value_us > LATENCY_MAX_US) {
+            value_us = LATENCY_MAX_US;
+        }
+        counts_[BucketIndex(value_us)].fetch_add(1, std::memory_order_relaxed);
+        if (value_us > max_.load(std::memory_order_relaxed)) {
+            max_.store(value_us, std::memory_order_relaxed);
+        }
+        total_.fetch_add(1, std::memory_order_release);
+    }
+
+    // 把other的计数加到本直方图 (汇总多个关节)
+    void Merge(const LatencyHistogram& other) {
+        for (int i = 0; i < BUCKET_COUNT; i++) {
+            uint32_t count = other.counts_[i].load(std::memory_order_relaxed);
+            if (count) {
+                counts_[i].fetch_add(count, std::memory_order_relaxed);
+            }
+        }
+        total_.fetch_add(other.Count(), std::memory_order_relaxed);
+        if (other.Max() > Max()) {
+            max_.store(other.Max(), std::memory_order_relaxed);
+        }
+    }
+
+    uint64_t Count() const { return total_.load(std::memory_order_acquire); }
+    uint32_t Max() const { return max_.load(std::memory_order_relaxed); }
+
+    // 第percentile百分位 (0-100) 所在桶的上界，没有样本时返回0
+    uint32_t Percentile(double percentile) const {
+        uint64_t total = 0;
+        for (int i = 0; i < BUCKET_COUNT; i++) {
+            total += counts_[i].load(std::memory_order_relaxed);
+        }
+        if (total == 0) {
+            return 0;
+        }
+        uint64_t rank = static_cast<uint64_t>(percentile / 100.0 * total + 0.5);
+        if (rank < 1) {
+            rank = 1;
+        }
+        uint64_t seen = 0;
+        for (int i = 0; i < BUCKET_COUNT; i++) {
+            seen += counts_[i].load(std::memory_order_relaxed);
+            if (seen >= rank) {
+                uint32_t high = BucketHigh(i);
+                uint32_t max_value = Max();
+                return high < max_value ? high : max_value;
+            }
+        }
+        return Max();
+    }
+
+    static int BucketIndex(uint32_t value) {
+        if (value < 2 * LATENCY_SUB_BUCKETS) {
+            return static_cast<int>(value);
+        }
+        int msb = 31 - __builtin_clz(value);
+        int shift = msb - LATENCY_SUB_BUCKET_BITS;
+        uint32_t mantissa = value >> shift;             // [SUB, 2*SUB)
+        return static_cast<int>(2 * LATENCY_SUB_BUCKETS + (shift - 1) * LATENCY_SUB_BUCKETS +
+                                (mantissa - LATENCY_SUB_BUCKETS));
+    }
+
+    // 桶内的最大值
+    static uint32_t BucketHigh(int index) {
+        if (index < static_cast<int>(2 * LATENCY_SUB_BUCKETS)) {
+            return static_cast<uint32_t>(index);
+        }
+        int offset = index - 2 * LATENCY_SUB_BUCKETS;
+        int shift = offset / LATENCY_SUB_BUCKETS + 1;
+        uint32_t mantissa = offset % LATENCY_SUB_BUCKETS + LATENCY_SUB_BUCKETS;
+        return ((mantissa + 1) << shift) - 1;
+    }
+
+private:
+    std::atomic<uint32_t> counts_[BUCKET_COUNT];
+    std::atomic<uint64_t> total_;
+    std::atomic<uint32_t> max_;
+};
@@ -0,0 +1,93 @@
+//
+// MPSC Ring
+// 多生产者单消费者无锁环形缓冲 - 多个线程写日志记录，由一个后台线程取出
+//
+// 每个槽带序号 (Vyukov有界队列): 生产者用CAS抢占写入位置，写完后发布序号；消费者按序号判断槽是否可读。
+// 生产者从不等待: 缓冲满时丢弃并计入overrun。
+//
+
+#pragma once
+
+#include <atomic>
+#include <cstddef>
+#include <cstdint>
+#include <memory>
+
+#include "spsc_ring.h"
+
+template <typename T, size_t Capacity>
+class MpscRing {
+    static_assert(Capacity >= 2 && (Capacity & (Capacity - 1)) == 0, "Capacity must be a power of two");
+
+public:
+    MpscRing() : cells_(new Cell[Capacity]) {
+        for (size_t i = 0; i < Capacity; i++) {
+            cells_[i].sequence.store(i, std::memory_order_relaxed);
+        }
+    }
+
+    MpscRing(const MpscRing&) = delete;
+    MpscRing& operator=(const MpscRing&) = delete;
+
+    // 生产者 (任意线程): 放入一条记录，缓冲满时丢弃并返回false
+    bool TryPush(const T& item) {
+        uint64_t pos = producer_.head.load(std::memory_order_relaxed);
+        Cell* cell;
+        while (true) {
+            cell = &cells_[pos & (Capacity - 1)];
+            uint64_t sequence = cell->sequence.load(std::memory_order_acquire);
+            int64_t diff = static_cast<int64_t>(sequence) - static_cast<int64_t>(pos);
+            if (diff == 0) {
+                if (producer_.head.compare_exchange_weak(pos, pos + 1, std::memory_order_relaxed)) {
+                    break;
+                }
+            } else if (diff < 0) {
+                producer_.overruns.fetch_add(1, std::memory_order_relaxed);
+                return false;
+            } else {
+                pos = producer_.head.load(std::memory_order_relaxed);
+            }
+        }
+        cell->value = item;
+        cell->sequence.store(pos + 1, std::memory_order_release);
+        return true;
+    }
+
+    // 消费者: 取出一条记录，没有已发布的记录时返回false
+    bool TryPop(T& item) {
+        uint64_t pos = consumer_.tail.load(std::memory_order_relaxed);
+        Cell& cell = cells_[pos & (Capacity - 1)];
+        if (cell.sequence.load(std::memory_order_acquire) != pos + 1) {
+            return false;
+        }
+        item = cell.value;
+        cell.sequence.store(pos + Capacity, std::memory_order_release);
+        consumer_.tail.store(pos + 1, std::memory_order_relaxed);
+        return true;
+    }
+
+    uint64_t Pushed() const { return producer_.head.load(std::memory_order_relaxed); }
+    uint64_t Overruns() const { return producer_.overruns.load(std::memory_order_relaxed); }
+    static size_t capacity() { return Capacity; }
+
+private:
+    struct Cell {
+        std::atomic<uint64_t> sequence;
+        T value;
+    };
+
+    // 生产者共享的写入位置
+    struct alignas(SPSC_CACHE_LINE) ProducerSide {
+        std::atomic<uint64_t> head{0};
+        std::atomic<uint64_t> overruns{0};
+    };
+
+    // 消费者独占的读取位置
+    struct alignas(SPSC_CACHE_LINE) ConsumerSide {
+        std::atomic<uint64_t> tail{0};
+    };
+
+    ProducerSide producer_;
+    ConsumerSide consumer_;
+    std::unique_ptr<Cell[]> cells_;
+};
@@ -0,0 +1,145 @@
+//
+// Periodic Executor
+// 按绝对截止时刻运行的周期执行器 - 每个周期的时刻由起点和周期算出，发送/打印的耗时不累积成漂移
+//
+// 实时时钟下用 clock_nanosleep(CLOCK_MONOTONIC, TIMER_ABSTIME) 等到截止时刻 (见 Clock::SleepUntil)，
+// 虚拟时钟下直接推进到截止时刻。每次唤醒记录相对截止时刻的延迟 (抖动)；上一周期的工作超过截止时刻
+// 记为超时并立即开始下一周期；落后超过一个整周期时跳过错过的周期，不连续补发。
+//
+// ApplyRealtimeOptions 可把调用线程设为 SCHED_FIFO、绑定到指定CPU并锁定内存，减少调度和缺页带来的抖动。
+//
+
+#pragma once
+
+#include "latency_histogram.h"
+#include "test_clock.h"
+#include <algorithm>
+#include <cerrno>
+#include <cmath>
+#include <cstdint>
+#include <cstring>
+#include <pthread.h>
+#include <sched.h>
+#include <string>
+#include <sys/mman.h>
+
+// 周期执行统计: 唤醒延迟 (微秒) 分布、超时和跳过的周期数。可由多个先后运行的执行器累计
+struct PeriodicStats {
+    uint64_t ticks = 0;         // 完成的周期数
+    uint64_t overruns = 0;      // 工作超过截止时刻的周期数
+    uint64_t missed = 0;        // 因超时跳过的周期数
+    double jitter_sum_us = 0.0;
+    LatencyHistogram jitter;    // 唤醒时刻相对截止时刻的延迟
+
+    void Reset() {
+        ticks = overruns = missed = 0;
+        jitter_sum_us = 0.0;
+        jitter.Reset();
+    }
+
+    double MeanJitterUs() const { return ticks > 0 ? jitter_sum_us / ticks : 0.0; }
+};
+
+class PeriodicExecutor {
+public:
+    // 统计记录到stats (调用者持有，须比执行器存活更久)
+    PeriodicExecutor(Clock* clock, double period_s, PeriodicStats& stats)
+        : clock_(clock), period_(period_s), stats_(stats) {}
+
+    PeriodicExecutor(const PeriodicExecutor&) = delete;
+    PeriodicExecutor& operator=(const PeriodicExecutor&) = delete;
+
+    // 以当前时刻为第0个周期的起点
+    void Start() {
+        start_ = clock_->Now();
+        index_ = 0;
+    }
+
+    double Period() const { return period_; }
+    double StartTime() const { return start_; }
+
+    // 当前周期的序号和计划时刻
+    uint64_t Index() const { return index_; }
+    double Deadline() const { return start_ + index_ * period_; }
+
+    // 等到下一个周期的截止时刻，返回因超时跳过的周期数
+    uint64_t WaitNext() {
+        uint64_t skipped = 0;
+        double now = clock_->Now();
+        index_++;
+        if (now > Deadline()) {
+            // 已过截止时刻: 立即运行最近一个过期的周期，更早的整周期跳过，不连续补发
+            stats_.overruns++;
+            skipped = static_cast<uint64_t>(std::floor((now - Deadline()) / period_));
+            index_ += skipped;
+            stats_.missed += skipped;
+        }
+
+        double deadline = Deadline();
+        clock_->SleepUntil(deadline);
+
+        double late_us = (clock_->Now() - deadline) * 1e6;
+        uint32_t jitter = late_us > 0 ? static_cast<uint32_t>(std::min(late_us, static_cast<double>(LATENCY_MAX_US))) : 0;
+        stats_.jitter.Record(jitter);
+        stats_.jitter_sum_us += jitter;
+        stats_.ticks++;
+        return skipped;
+    }
+
+private:
+    Clock* clock_;
+    double period_;
+    double start_ = 0.0;
+    uint64_t index_ = 0;
+    PeriodicStats& stats_;
+};
+
+// 控制线程的实时设置
+struct RealtimeOptions {
+    int fifo_priority = 0;      // SCHED_FIFO优先级 (1-99)，0表示保持默认调度
+    int cpu = -1;               // 绑定的CPU，-1表示不绑定
+    bool lock_memory = false;   // mlockall锁定当前和以后分配的内存
+
+    bool Enabled() const { return fifo_priority > 0 || cpu >= 0 || lock_memory; }
+};
+
+// 对调用线程应用实时设置，全部成功返回true；失败的项写入errors (通常是权限不足)，其余项照常生效
+inline bool ApplyRealtimeOptions(const RealtimeOptions& options, std::string* errors) {
+    bool ok = true;
+    auto fail = [&](const char* what, int error) {
+        ok = false;
+        if (errors) {
+            if (!errors->empty()) {
+                *errors += "; ";
+            }
+            *errors += what;
+            *errors += ": ";
+            *errors += strerror(error);
+        }
+    };
+
+    if (options.lock_memory && mlockall(MCL_CURRENT | MCL_FUTURE) != 0) {
+        fail("mlockall", errno);
+    }
+
+    if (options.cpu >= 0) {
+        cpu_set_t cpus;
+        CPU_ZERO(&cpus);
+        CPU_SET(options.cpu, &cpus);
+        int error = pthread_setaffinity_np(pthread_self(), sizeof(cpus), &cpus);
+        if (error != 0) {
+            fail("绑定CPU", error);
+        }
+    }
+
+    if (options.fifo_priority > 0) {
+        sched_param param;
+        memset(&param, 0, sizeof(param));
+        param.sched_priority = std::min(options.fifo_priority, sched_get_priority_max(SCHED_FIFO));
+        int error = pthread_setschedparam(pthread_self(), SCHED_FIFO, &param);
+        if (error != 0) {
+            fail("SCHED_FIFO", error);
+        }
+    }
+    return ok;
+}
@@ -0,0 +1,293 @@
+//
+// PT Batch Codec
+// PT命令/反馈的批量编解码 - 输入输出为结构数组，一次处理一个周期内所有关节的帧
+//
+// 浮点与定点之间的转换按8路(AVX2)或4路(SSE2)并行，关节型号不同的通道各自按ptScales取量化参数；
+// 字节打包/拆包仍逐帧进行。结果与PTCodec<Type>逐帧编解码逐位一致: 各路径都是先减后乘再截断、
+// 先乘后加，不使用FMA (标量代码也不能用 -mfma 编译，否则编译器可能把乘加合并)。
+// AVX2在运行时检测，x86以外的平台只有标量路径。
+//
+
+#pragma once
+
+#include "pt_protocol.h"
+
+#include <cstddef>
+#include <cstdint>
+#include <cstring>
+
+#if defined(__GNUC__) && (defined(__x86_64__) || defined(__i386__))
+#include <immintrin.h>
+#define PT_BATCH_X86 1
+#endif
+
+// 一批PT命令: 第i条命令的各参数为各数组的第i项
+struct PTCommandBatch {
+    const int* motor_id;
+    const uint8_t* motor_type;      // 每个关节的电机型号索引 (PTMotorType)
+    const float* kp;
+    const float* kd;
+    const float* pos;
+    const float* speed;
+    const float* torque;
+    size_t count;
+};
+
+// 一批反馈的解码输出: 第i帧写入各数组的第i项
+struct PTFeedbackBatch {
+    const uint8_t* motor_type;      // 输入: 每帧所属关节的电机型号索引
+    float* pos;
+    float* speed;
+    float* current;
+};
+
+enum PTBatchPath {
+    PT_BATCH_SCALAR = 0,
+    PT_BATCH_SSE2,
+    PT_BATCH_AVX2
+};
+
+inline const char* ptBatchPathName(PTBatchPath path) {
+    return path == PT_BATCH_AVX2 ? "avx2" : (path == PT_BATCH_SSE2 ? "sse2" : "scalar");
+}
+
+namespace pt_batch_detail {
+
+const size_t BLOCK = 8;
+const int COMMAND_FIELDS = 5;       // kp, kd, pos, speed, torque
+const int FEEDBACK_FIELDS = 3;      // pos, speed, current
+
+// ptScales 中各量化参数相对一行起点的float下标
+const int SCALES_STRIDE = sizeof(PTScales) / sizeof(float);
+const int COMMAND_MIN[COMMAND_FIELDS] = {
+    offsetof(PTScales, kp_min) / sizeof(float), offsetof(PTScales, kd_min) / sizeof(float),
+    offsetof(PTScales, pos_min) / sizeof(float), offsetof(PTScales, spd_min) / sizeof(float),
+    offsetof(PTScales, t_min) / sizeof(float)};
+const int COMMAND_SCALE[COMMAND_FIELDS] = {
+    offsetof(PTScales, kp_scale) / sizeof(float), offsetof(PTScales, kd_scale) / sizeof(float),
+    offsetof(PTScales, pos_scale) / sizeof(float), offsetof(PTScales, spd_scale) / sizeof(float),
+    offsetof(PTScales, t_scale) / sizeof(float)};
+const int FEEDBACK_MIN[FEEDBACK_FIELDS] = {
+    offsetof(PTScales, pos_min) / sizeof(float), offsetof(PTScales, spd_min) / sizeof(float),
+    offsetof(PTScales, i_min) / sizeof(float)};
+const int FEEDBACK_LSB[FEEDBACK_FIELDS] = {
+    offsetof(PTScales, pos_lsb) / sizeof(float), offsetof(PTScales, spd_lsb) / sizeof(float),
+    offsetof(PTScales, i_lsb) / sizeof(float)};
+
+static_assert(sizeof(PTScales) % sizeof(float) == 0, "PTScales must contain only floats");
+
+inline const float* scalesRow(uint8_t motor_type) {
+    return reinterpret_cast<const float*>(&ptScales[motor_type]);
+}
+
+inline void commandFields(const PTCommandBatch& batch, const float* fields[COMMAND_FIELDS]) {
+    fields[0] = batch.kp;
+    fields[1] = batch.kd;
+    fields[2] = batch.pos;
+    fields[3] = batch.speed;
+    fields[4] = batch.torque;
+}
+
+inline void feedbackFields(const PTFeedbackBatch& batch, float* fields[FEEDBACK_FIELDS]) {
+    fields[0] = batch.pos;
+    fields[1] = batch.speed;
+    fields[2] = batch.current;
+}
+
+// 物理量 -> 定点 (一个块，n <= BLOCK)
+inline void quantizeScalar(const float* const fields[COMMAND_FIELDS], const uint8_t* types, size_t n,
+                           int32_t out[COMMAND_FIELDS][BLOCK]) {
+    for (size_t i = 0; i < n; i++) {
+        const float* row = scalesRow(types[i]);
+        for (int f = 0; f < COMMAND_FIELDS; f++) {
+            out[f][i] = (int32_t)((fields[f][i] - row[COMMAND_MIN[f]]) * row[COMMAND_SCALE[f]]);
+        }
+    }
+}
+
+// 定点 -> 物理量 (一个块，n <= BLOCK)
+inline void dequantizeScalar(const int32_t raw[FEEDBACK_FIELDS][BLOCK], const uint8_t* types, size_t n,
+                             float* const fields[FEEDBACK_FIELDS]) {
+    for (size_t i = 0; i < n; i++) {
+        const float* row = scalesRow(types[i]);
+        for (int f = 0; f < FEEDBACK_FIELDS; f++) {
+            fields[f][i] = raw[f][i] * row[FEEDBACK_LSB[f]] + row[FEEDBACK_MIN[f]];
+        }
+    }
+}
+
+#ifdef PT_BATCH_X86
+
+inline __m128 lanesSSE2(const uint8_t* types, int index) {
+    return _mm_setr_ps(scalesRow(types[0])[index], scalesRow(types[1])[index],
+                       scalesRow(types[2])[index], scalesRow(types[3])[index]);
+}
+
+inline void quantizeSSE2(const float* const fields[COMMAND_FIELDS], const uint8_t* types,
+                         int32_t out[COMMAND_FIELDS][BLOCK]) {
+    for (size_t half = 0; half < BLOCK; half += 4) {
+        for (int f = 0; f < COMMAND_FIELDS; f++) {
+            __m128 x = _mm_loadu_ps(fields[f] + half);
+            __m128 scaled = _mm_mul_ps(_mm_sub_ps(x, lanesSSE2(types + half, COMMAND_MIN[f])),
+                                       lanesSSE2(types + half, COMMAND_SCALE[f]));
+            _mm_storeu_si128(reinterpret_cast<__m128i*>(out[f] + half), _mm_cvttps_epi32(scaled));
+        }
+    }
+}
+
+inline void dequantizeSSE2(const int32_t raw[FEEDBACK_FIELDS][BLOCK], const uint8_t* types,
+                           float* const fields[FEEDBACK_FIELDS]) {
+    for (size_t half = 0; half < BLOCK; half += 4) {
+        for (int f = 0; f < FEEDBACK_FIELDS; f++) {
+            __m128 x = _mm_cvtepi32_ps(_mm_loadu_si128(reinterpret_cast<const __m128i*>(raw[f] + half)));
+            __m128 value = _mm_add_ps(_mm_mul_ps(x, lanesSSE2(types + half, FEEDBACK_LSB[f])),
+                                      lanesSSE2(types + half, FEEDBACK_MIN[f]));
+            _mm_storeu_ps(fields[f] + half, value);
+        }
+    }
+}
+
+// 8个通道的型号 -> ptScales中各行起点的float下标
+__attribute__((target("avx2"))) inline __m256i rowIndexAVX2(const uint8_t* types) {
+    int64_t packed;
+    memcpy(&packed, types, sizeof(packed));
+    __m256i type = _mm256_cvtepu8_epi32(_mm_cvtsi64_si128(packed));
+    return _mm256_mullo_epi32(type, _mm256_set1_epi32(SCALES_STRIDE));
+}
+
+__attribute__((target("avx2"))) inline __m256 lanesAVX2(__m256i rows, int index) {
+    return _mm256_i32gather_ps(reinterpret_cast<const float*>(ptScales) + index, rows, sizeof(float));
+}
+
+__attribute__((target("avx2"))) inline void quantizeAVX2(const float* const fields[COMMAND_FIELDS],
+                                                         const uint8_t* types,
+                                                         int32_t out[COMMAND_FIELDS][BLOCK]) {
+    __m256i rows = rowIndexAVX2(types);
+    for (int f = 0; f < COMMAND_FIELDS; f++) {
+        __m256 x = _mm256_loadu_ps(fields[f]);
+        __m256 scaled = _mm256_mul_ps(_mm256_sub_ps(x, lanesAVX2(rows, COMMAND_MIN[f])),
+                                      lanesAVX2(rows, COMMAND_SCALE[f]));
+        _mm256_storeu_si256(reinterpret_cast<__m256i*>(out[f]), _mm256_cvttps_epi32(scaled));
+    }
+}
+
+__attribute__((target("avx2"))) inline void dequantizeAVX2(const int32_t raw[FEEDBACK_FIELDS][BLOCK],
+                                                           const uint8_t* types,
+                                                           float* const fields[FEEDBACK_FIELDS]) {
+    __m256i rows = rowIndexAVX2(types);
+    for (int f = 0; f < FEEDBACK_FIELDS; f++) {
+        __m256 x = _mm256_cvtepi32_ps(_mm256_loadu_si256(reinterpret_cast<const __m256i*>(raw[f])));
+        __m256 value = _mm256_add_ps(_mm256_mul_ps(x, lanesAVX2(rows, FEEDBACK_LSB[f])),
+                                     lanesAVX2(rows, FEEDBACK_MIN[f]));
+        _mm256_storeu_ps(fields[f], value);
+    }
+}
+
+#endif // PT_BATCH_X86
+
+// 一个完整块走SIMD，不足一块的尾部走标量
+inline void quantizeBlock(PTBatchPath path, const float* const fields[COMMAND_FIELDS], const uint8_t* types,
+                          size_t n, int32_t out[COMMAND_FIELDS][BLOCK]) {
+#ifdef PT_BATCH_X86
+    if (n == BLOCK && path == PT_BATCH_AVX2) {
+        quantizeAVX2(fields, types, out);
+        return;
+    }
+    if (n == BLOCK && path == PT_BATCH_SSE2) {
+        quantizeSSE2(fields, types, out);
+        return;
+    }
+#else
+    (void)path;
+#endif
+    quantizeScalar(fields, types, n, out);
+}
+
+inline void dequantizeBlock(PTBatchPath path, const int32_t raw[FEEDBACK_FIELDS][BLOCK], const uint8_t* types,
+                            size_t n, float* const fields[FEEDBACK_FIELDS]) {
+#ifdef PT_BATCH_X86
+    if (n == BLOCK && path == PT_BATCH_AVX2) {
+        dequantizeAVX2(raw, types, fields);
+        return;
+    }
+    if (n == BLOCK && path == PT_BATCH_SSE2) {
+        dequantizeSSE2(raw, types, fields);
+        return;
+    }
+#else
+    (void)path;
+#endif
+    dequantizeScalar(raw, types, n, fields);
+}
+
+} // namespace pt_batch_detail
+
+// 本机可用的最快路径 (首次调用时检测)
+inline PTBatchPath ptBatchBestPath() {
+#ifdef PT_BATCH_X86
+    static const PTBatchPath path = __builtin_cpu_supports("avx2") ? PT_BATCH_AVX2 : PT_BATCH_SSE2;
+    return path;
+#else
+    return PT_BATCH_SCALAR;
+#endif
+}
+
+// 编码一批PT命令到frames[0..count)，帧格式与PTCodec<Type>::EncodeCommand相同。
+// Frame 为 VCI_CAN_OBJ (controlcan.h 或 can_protocol.h 中的定义均可)。
+template <typename Frame>
+void encodePTCommandBatch(const PTCommandBatch& batch, Frame* frames, PTBatchPath path = ptBatchBestPath()) {
+    using namespace pt_batch_detail;
+    int32_t q[COMMAND_FIELDS][BLOCK];
+
+    for (size_t begin = 0; begin < batch.count; begin += BLOCK) {
+        size_t n = batch.count - begin < BLOCK ? batch.count - begin : BLOCK;
+        const float* fields[COMMAND_FIELDS];
+        commandFields(batch, fields);
+        for (int f = 0; f < COMMAND_FIELDS; f++) {
+            fields[f] += begin;
+        }
+        quantizeBlock(path, fields, batch.motor_type + begin, n, q);
+
+        for (size_t i = 0; i < n; i++) {
+            Frame& frame = frames[begin + i];
+            memset(&frame, 0, sizeof(frame));
+            frame.ID = batch.motor_id[begin + i];
+            frame.DataLen = 8;
+            int kp = q[0][i], kd = q[1][i], pos = q[2][i], spd = q[3][i], tor = q[4][i];
+            frame.Data[0] = (kp >> 7) & 0xFF;
+            frame.Data[1] = ((kp & 0x7F) << 1) | ((kd >> 8) & 0x1);
+            frame.Data[2] = kd & 0xFF;
+            frame.Data[3] = (pos >> 8) & 0xFF;
+            frame.Data[4] = pos & 0xFF;
+            frame.Data[5] = (spd >> 4) & 0xFF;
+            frame.Data[6] = ((spd & 0xF) << 4) | ((tor >> 8) & 0xF);
+            frame.Data[7] = tor & 0xFF;
+        }
+    }
+}
+
+// 解码count帧PT反馈的位置/速度/电流，数值与PTCodec<Type>::DecodeFeedback相同。
+// 不检查ID和DataLen，调用者自行跳过无效帧。
+template <typename Frame>
+void decodePTFeedbackBatch(const Frame* frames, size_t count, const PTFeedbackBatch& batch,
+                           PTBatchPath path = ptBatchBestPath()) {
+    using namespace pt_batch_detail;
+    int32_t raw[FEEDBACK_FIELDS][BLOCK];
+
+    for (size_t begin = 0; begin < count; begin += BLOCK) {
+        size_t n = count - begin < BLOCK ? count - begin : BLOCK;
+        for (size_t i = 0; i < n; i++) {
+            const uint8_t* d = frames[begin + i].Data;
+            raw[0][i] = (d[1] << 8) | d[2];
+            raw[1][i] = (d[3] << 4) | ((d[4] >> 4) & 0xF);
+            raw[2][i] = ((d[4] & 0xF) << 8) | d[5];
+        }
+
+        float* fields[FEEDBACK_FIELDS];
+        feedbackFields(batch, fields);
+        for (int f = 0; f < FEEDBACK_FIELDS; f++) {
+            fields[f] += begin;
+        }
+        dequantizeBlock(path, raw, batch.motor_type + begin, n, fields);
+    }
+}
@@ -0,0 +1,175 @@
+//
+// PT Protocol Definitions
+// PT模式协议定义 - 电机型号参数表和定点转换函数 (测试程序与仿真库共用)
+//
+
+#pragma once
+
+#include "joint_topology.h"
+
+#include <cstdint>
+
+// 电机参数定义 (根据提供的电机型号表)
+struct MotorParams {
+    const char* model;
+    float def_ratio;
+    float KT;
+    float T_MINX, T_MAXX;
+    float I_MINX, I_MAXX;
+    float KP_MINX, KP_MAXX;
+    float KD_MINX, KD_MAXX;
+    float POS_MINX, POS_MAXX;
+    float SPD_MINX, SPD_MAXX;
+};
+
+// 预定义的电机参数 (下标即 PTMotorType)
+constexpr MotorParams motorParams[] = {
+    {"30-40",   101, 0.024f, -30.0f, 30.0f,   -30.0f, 30.0f,   0.0f, 500.0f, 0.0f, 5.0f, -12.5f, 12.5f, -18.0f, 18.0f},
+    {"40-52",   101, 0.05f,  -30.0f, 30.0f,   -30.0f, 30.0f,   0.0f, 500.0f, 0.0f, 5.0f, -12.5f, 12.5f, -18.0f, 18.0f},
+    {"50-60",   51,  0.089f, -13.2f, 13.2f,   -9.0f,  9.0f,    0.0f, 500.0f, 0.0f, 5.0f, -12.5f, 12.5f, -18.0f, 18.0f},
+    {"60-70",   51,  0.096f, -39.6f, 39.6f,   -20.0f, 20.0f,   0.0f, 500.0f, 0.0f, 5.0f, -12.5f, 12.5f, -18.0f, 18.0f},
+    {"70-80",   101, 0.118f, -30.0f, 30.0f,   -30.0f, 30.0f,   0.0f, 500.0f, 0.0f, 5.0f, -12.5f, 12.5f, -18.0f, 18.0f},
+    {"70-90",   51,  0.118f, -64.0f, 64.0f,   -22.0f, 22.0f,   0.0f, 500.0f, 0.0f, 5.0f, -12.5f, 12.5f, -18.0f, 18.0f},
+    {"80-110",  101, 0.143f, -30.0f, 30.0f,   -30.0f, 30.0f,   0.0f, 500.0f, 0.0f, 5.0f, -12.5f, 12.5f, -18.0f, 18.0f},
+    {"100-120", 51,  0.175f, -188.0f, 188.0f, -40.0f, 40.0f,   0.0f, 500.0f, 0.0f, 5.0f, -12.5f, 12.5f, -18.0f, 18.0f},
+    {"100-142", 101, 0.175f, -30.0f, 30.0f,   -30.0f, 30.0f,   0.0f, 500.0f, 0.0f, 5.0f, -12.5f, 12.5f, -18.0f, 18.0f},
+    {"110-170", 101, 0.293f, -30.0f, 30.0f,   -30.0f, 30.0f,   0.0f, 500.0f, 0.0f, 5.0f, -12.5f, 12.5f, -18.0f, 18.0f}
+};
+
+const int MOTOR_TYPE_COUNT = sizeof(motorParams) / sizeof(motorParams[0]);
+
+static_assert(MOTOR_TYPE_COUNT == PT_MOTOR_TYPE_COUNT, "motorParams and PTMotorType must list the same models");
+
+// 根据电机代码实现的转换函数
+inline int float_to_uint(float x, float x_min, float x_max, int bits) {
+    float span = x_max - x_min;
+    float offset = x_min;
+    return (int)((x - offset) * ((float)((1 << bits) - 1)) / span);
+}
+
+inline float uint_to_float(int x_int, float x_min, float x_max, int bits) {
+    float span = x_max - x_min;
+    float offset = x_min;
+    return ((float)x_int) * span / ((float)((1 << bits) - 1)) + offset;
+}
+
+// 按型号特化的PT编解码: 量化比例和步长在编译期由motorParams算出，每帧只做乘加。
+// 命令打包与电机端解析方式一致，不做限幅 (扭矩范围由调用者检查)。
+template <int Type>
+struct PTCodec {
+    static constexpr float KP_MIN = motorParams[Type].KP_MINX;
+    static constexpr float KD_MIN = motorParams[Type].KD_MINX;
+    static constexpr float POS_MIN = motorParams[Type].POS_MINX;
+    static constexpr float SPD_MIN = motorParams[Type].SPD_MINX;
+    static constexpr float T_MIN = motorParams[Type].T_MINX;
+    static constexpr float I_MIN = motorParams[Type].I_MINX;
+
+    // 物理量 -> 定点
+    static constexpr float KP_SCALE = 4095.0f / (motorParams[Type].KP_MAXX - KP_MIN);
+    static constexpr float KD_SCALE = 511.0f / (motorParams[Type].KD_MAXX - KD_MIN);
+    static constexpr float POS_SCALE = 65535.0f / (motorParams[Type].POS_MAXX - POS_MIN);
+    static constexpr float SPD_SCALE = 4095.0f / (motorParams[Type].SPD_MAXX - SPD_MIN);
+    static constexpr float T_SCALE = 4095.0f / (motorParams[Type].T_MAXX - T_MIN);
+
+    // 定点 -> 物理量 (一个量化步长)
+    static constexpr float POS_LSB = (motorParams[Type].POS_MAXX - POS_MIN) / 65535.0f;
+    static constexpr float SPD_LSB = (motorParams[Type].SPD_MAXX - SPD_MIN) / 4095.0f;
+    static constexpr float T_LSB = (motorParams[Type].T_MAXX - T_MIN) / 4095.0f;
+    static constexpr float I_LSB = (motorParams[Type].I_MAXX - I_MIN) / 4095.0f;
+
+    // PT命令: KP 12位, KD 9位, 位置 16位, 速度 12位, 扭矩 12位
+    static void EncodeCommand(uint8_t* data, float kp, float kd, float pos, float spd, float torque) {
+        int kp_int = (int)((kp - KP_MIN) * KP_SCALE);
+        int kd_int = (int)((kd - KD_MIN) * KD_SCALE);
+        int pos_int = (int)((pos - POS_MIN) * POS_SCALE);
+        int spd_int = (int)((spd - SPD_MIN) * SPD_SCALE);
+        int t_int = (int)((torque - T_MIN) * T_SCALE);
+
+        data[0] = (kp_int >> 7) & 0xFF;
+        data[1] = ((kp_int & 0x7F) << 1) | ((kd_int >> 8) & 0x1);
+        data[2] = kd_int & 0xFF;
+        data[3] = (pos_int >> 8) & 0xFF;
+        data[4] = pos_int & 0xFF;
+        data[5] = (spd_int >> 4) & 0xFF;
+        data[6] = ((spd_int & 0xF) << 4) | ((t_int >> 8) & 0xF);
+        data[7] = t_int & 0xFF;
+    }
+
+    // PT反馈: 位置 16位, 速度 12位, 电流 12位
+    static void DecodeFeedback(const uint8_t* data, float* pos, float* spd, float* current) {
+        int pos_int = (data[1] << 8) | data[2];
+        int spd_int = (data[3] << 4) | ((data[4] >> 4) & 0xF);
+        int cur_int = ((data[4] & 0xF) << 8) | data[5];
+
+        *pos = pos_int * POS_LSB + POS_MIN;
+        *spd = spd_int * SPD_LSB + SPD_MIN;
+        *current = cur_int * I_LSB + I_MIN;
+    }
+};
+
+// 运行时按型号索引选择编解码 (每个关节保存一个指针，取代逐帧读取型号参数)
+struct PTCodecOps {
+    void (*encode_command)(uint8_t* data, float kp, float kd, float pos, float spd, float torque);
+    void (*decode_feedback)(const uint8_t* data, float* pos, float* spd, float* current);
+    float torque_lsb;
+    float speed_lsb;
+    float current_lsb;
+    float position_lsb;
+};
+
+template <int Type>
+constexpr PTCodecOps makePTCodecOps() {
+    return PTCodecOps{&PTCodec<Type>::EncodeCommand, &PTCodec<Type>::DecodeFeedback,
+                      PTCodec<Type>::T_LSB, PTCodec<Type>::SPD_LSB, PTCodec<Type>::I_LSB,
+                      PTCodec<Type>::POS_LSB};
+}
+
+constexpr PTCodecOps ptCodecOps[] = {
+    makePTCodecOps<MOTOR_30_40>(),
+    makePTCodecOps<MOTOR_40_52>(),
+    makePTCodecOps<MOTOR_50_60>(),
+    makePTCodecOps<MOTOR_60_70>(),
+    makePTCodecOps<MOTOR_70_80>(),
+    makePTCodecOps<MOTOR_70_90>(),
+    makePTCodecOps<MOTOR_80_110>(),
+    makePTCodecOps<MOTOR_100_120>(),
+    makePTCodecOps<MOTOR_100_142>(),
+    makePTCodecOps<MOTOR_110_170>()
+};
+
+static_assert(sizeof(ptCodecOps) / sizeof(ptCodecOps[0]) == MOTOR_TYPE_COUNT, "ptCodecOps must cover every motor type");
+
+// 各型号量化参数的平铺表，供批量编解码按关节型号逐通道取用 (数值与PTCodec<Type>完全相同)
+struct PTScales {
+    float kp_min, kp_scale;
+    float kd_min, kd_scale;
+    float pos_min, pos_scale, pos_lsb;
+    float spd_min, spd_scale, spd_lsb;
+    float t_min, t_scale;
+    float i_min, i_lsb;
+};
+
+template <int Type>
+constexpr PTScales makePTScales() {
+    return PTScales{PTCodec<Type>::KP_MIN, PTCodec<Type>::KP_SCALE,
+                    PTCodec<Type>::KD_MIN, PTCodec<Type>::KD_SCALE,
+                    PTCodec<Type>::POS_MIN, PTCodec<Type>::POS_SCALE, PTCodec<Type>::POS_LSB,
+                    PTCodec<Type>::SPD_MIN, PTCodec<Type>::SPD_SCALE, PTCodec<Type>::SPD_LSB,
+                    PTCodec<Type>::T_MIN, PTCodec<Type>::T_SCALE,
+                    PTCodec<Type>::I_MIN, PTCodec<Type>::I_LSB};
+}
+
+constexpr PTScales ptScales[] = {
+    makePTScales<MOTOR_30_40>(),
+    makePTScales<MOTOR_40_52>(),
+    makePTScales<MOTOR_50_60>(),
+    makePTScales<MOTOR_60_70>(),
+    makePTScales<MOTOR_70_80>(),
+    makePTScales<MOTOR_70_90>(),
+    makePTScales<MOTOR_80_110>(),
+    makePTScales<MOTOR_100_120>(),
+    makePTScales<MOTOR_100_142>(),
+    makePTScales<MOTOR_110_170>()
+};
+
+static_assert(sizeof(ptScales) / sizeof(ptScales[0]) == MOTOR_TYPE_COUNT, "ptScales must cover every motor type");
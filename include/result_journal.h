@@ -0,0 +1,194 @@
+//
+// Result Journal
+// 追加写入的结果日志 - 每完成一个关节追加一条记录并fsync，测试中断 (Ctrl+C/USB断开/断电) 后可从日志恢复
+//
+// 文本文件，每行一条记录: 字段以制表符分隔，行尾是整行内容的校验和 (FNV-1a 32位，十六进制)。
+// 每条记录写出后立即fsync，中断时最多丢失正在写的那一行；读取时跳过没有换行结尾
+// 或校验和不符的行。字段内容由调用者定义 (通常是 "键=值")，不能包含制表符和换行。
+//
+
+#pragma once
+
+#include <cerrno>
+#include <cstdint>
+#include <cstdio>
+#include <cstring>
+#include <fstream>
+#include <iterator>
+#include <string>
+#include <vector>
+#include <fcntl.h>
+#include <unistd.h>
+
+class ResultJournal {
+public:
+    ResultJournal() {}
+    ~ResultJournal() { Close(); }
+
+    ResultJournal(const ResultJournal&) = delete;
+    ResultJournal& operator=(const ResultJournal&) = delete;
+
+    // 打开日志用于追加；truncate为true时清空原有内容。新建文件时同步所在目录，保证文件本身不会丢失。
+    // 接着已有内容追加时先截掉没写完的最后一行，否则新记录会接在半行后面
+    bool Open(const std::string& path, bool truncate) {
+        Close();
+        bool existed = access(path.c_str(), F_OK) == 0;
+        int flags = O_RDWR | O_CREAT | O_APPEND | O_CLOEXEC | (truncate ? O_TRUNC : 0);
+        fd_ = open(path.c_str(), flags, 0644);
+        if (fd_ < 0) {
+            error_ = errno;
+            return false;
+        }
+        path_ = path;
+        if (!existed || truncate) {
+            SyncDirectory(path);
+        } else if (!TrimPartialLine()) {
+            error_ = errno;
+            Close();
+            return false;
+        }
+        return true;
+    }
+
+    void Close() {
+        if (fd_ >= 0) {
+            close(fd_);
+            fd_ = -1;
+        }
+    }
+
+    bool IsOpen() const { return fd_ >= 0; }
+    const std::string& Path() const { return path_; }
+    const char* Error() const { return strerror(error_); }
+
+    // 追加一条记录 (各字段不含制表符和换行) 并fsync
+    bool Append(const std::vector<std::string>& fields) {
+        if (fd_ < 0) {
+            return false;
+        }
+        std::string line;
+        for (size_t i = 0; i < fields.size(); i++) {
+            if (i > 0) {
+                line += '\t';
+            }
+            line += fields[i];
+        }
+        char checksum[16];
+        snprintf(checksum, sizeof(checksum), "\t%08x\n", Checksum(line));
+        line += checksum;
+
+        const char* data = line.data();
+        size_t remaining = line.size();
+        while (remaining > 0) {
+            ssize_t written = write(fd_, data, remaining);
+            if (written < 0) {
+                if (errno == EINTR) {
+                    continue;
+                }
+                error_ = errno;
+                return false;
+            }
+            data += written;
+            remaining -= static_cast<size_t>(written);
+        }
+        if (fsync(fd_) != 0) {
+            error_ = errno;
+            return false;
+        }
+        return true;
+    }
+
+    // 读取日志中所有完整且校验通过的记录，返回false表示文件不存在或无法读取；skipped为跳过的行数
+    static bool Load(const std::string& path, std::vector<std::vector<std::string>>& records, size_t* skipped = nullptr) {
+        std::ifstream file(path, std::ios::binary);
+        if (!file.is_open()) {
+            return false;
+        }
+        std::string content((std::istreambuf_iterator<char>(file)), std::istreambuf_iterator<char>());
+
+        size_t bad = 0;
+        size_t start = 0;
+        while (start < content.size()) {
+            size_t end = content.find('\n', start);
+            if (end == std::string::npos) {
+                bad++;      // 最后一行没写完
+                break;
+            }
+            std::string line = content.substr(start, end - start);
+            start = end + 1;
+
+            size_t tab = line.rfind('\t');
+            if (tab == std::string::npos || line.size() - tab != 9 ||
+                strtoul(line.c_str() + tab + 1, nullptr, 16) != Checksum(line.substr(0, tab))) {
+                bad++;
+                continue;
+            }
+            records.push_back(Split(line.substr(0, tab)));
+        }
+        if (skipped) {
+            *skipped = bad;
+        }
+        return true;
+    }
+
+    static std::vector<std::string> Split(const std::string& line) {
+        std::vector<std::string> fields;
+        size_t start = 0;
+        while (true) {
+            size_t tab = line.find('\t', start);
+            fields.push_back(line.substr(start, tab == std::string::npos ? std::string::npos : tab - start));
+            if (tab == std::string::npos) {
+                return fields;
+            }
+            start = tab + 1;
+        }
+    }
+
+    static uint32_t Checksum(const std::string& text) {
+        uint32_t hash = 2166136261u;
+        for (unsigned char c : text) {
+            hash = (hash ^ c) * 16777619u;
+        }
+        return hash;
+    }
+
+private:
+    // 从文件末尾向前找到最后一个换行，截掉其后的内容
+    bool TrimPartialLine() {
+        off_t size = lseek(fd_, 0, SEEK_END);
+        if (size < 0) {
+            return false;
+        }
+        off_t end = size;
+        char buffer[256];
+        while (end > 0) {
+            off_t start = end > static_cast<off_t>(sizeof(buffer)) ? end - static_cast<off_t>(sizeof(buffer)) : 0;
+            ssize_t count = pread(fd_, buffer, static_cast<size_t>(end - start), start);
+            if (count <= 0) {
+                return false;
+            }
+            for (ssize_t i = count - 1; i >= 0; i--) {
+                if (buffer[i] == '\n') {
+                    off_t keep = start + i + 1;
+                    return keep == size || (ftruncate(fd_, keep) == 0 && fsync(fd_) == 0);
+                }
+            }
+            end = start;
+        }
+        return size == 0 || (ftruncate(fd_, 0) == 0 && fsync(fd_) == 0);
+    }
+
+    static void SyncDirectory(const std::string& path) {
+        size_t slash = path.rfind('/');
+        std::string dir = slash == std::string::npos ? "." : (slash == 0 ? "/" : path.substr(0, slash));
+        int fd = open(dir.c_str(), O_RDONLY | O_DIRECTORY | O_CLOEXEC);
+        if (fd >= 0) {
+            fsync(fd);
+            close(fd);
+        }
+    }
+
+    int fd_ = -1;
+    int error_ = 0;
+    std::string path_;
+};
@@ -0,0 +1,77 @@
+//
+// Settle Detector
+// 关节静止位置的流式估计 - 逐个加入零扭矩反馈，均值的标准误差达到要求即可结束采样
+//
+// 位置用Welford算法累计均值和方差；速度超过阈值说明关节仍在运动，之前的样本作废重新累计。
+// 样本数不少于 min_samples 且均值的标准误差 sqrt(var/n) 不超过 max_std_error 时判为稳定。
+// 调用者负责超时: 超时后仍可用 Mean() (或没有静止样本时用 LastPosition()) 作为估计。
+//
+
+#pragma once
+
+#include <cmath>
+#include <cstdint>
+
+struct SettleCriteria {
+    float max_std_error = 0.002f;   // 均值的最大标准误差 (rad)
+    float max_speed = 0.05f;        // 视为静止的最大速度 (rad/s)
+    int min_samples = 4;            // 最少静止样本数 (避免前几个样本恰好相同就判为稳定)
+};
+
+class SettleDetector {
+public:
+    explicit SettleDetector(const SettleCriteria& criteria = SettleCriteria()) : criteria_(criteria) {}
+
+    void Reset() {
+        count_ = 0;
+        mean_ = 0.0;
+        m2_ = 0.0;
+        samples_ = 0;
+        restarts_ = 0;
+        last_position_ = NAN;
+    }
+
+    // 加入一个反馈样本，返回是否已稳定
+    bool Add(float position_rad, float speed_rads) {
+        samples_++;
+        last_position_ = position_rad;
+        if (std::fabs(speed_rads) > criteria_.max_speed) {
+            if (count_ > 0) {
+                restarts_++;
+            }
+            count_ = 0;
+            mean_ = 0.0;
+            m2_ = 0.0;
+            return false;
+        }
+
+        count_++;
+        double delta = position_rad - mean_;
+        mean_ += delta / count_;
+        m2_ += delta * (position_rad - mean_);
+        return Settled();
+    }
+
+    bool Settled() const {
+        return count_ >= criteria_.min_samples && StdError() <= criteria_.max_std_error;
+    }
+
+    // 静止样本的位置均值、方差和均值的标准误差
+    float Mean() const { return static_cast<float>(mean_); }
+    double Variance() const { return count_ > 1 ? m2_ / (count_ - 1) : 0.0; }
+    double StdError() const { return count_ > 0 ? std::sqrt(Variance() / count_) : INFINITY; }
+
+    int Count() const { return count_; }              // 参与估计的静止样本数
+    int Samples() const { return samples_; }          // 加入的全部样本数
+    int Restarts() const { return restarts_; }        // 因运动重新累计的次数
+    float LastPosition() const { return last_position_; }
+
+private:
+    SettleCriteria criteria_;
+    int count_ = 0;
+    double mean_ = 0.0;
+    double m2_ = 0.0;
+    int samples_ = 0;
+    int restarts_ = 0;
+    float last_position_ = NAN;
+};
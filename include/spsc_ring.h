@@ -0,0 +1,89 @@
+//
+// SPSC Ring
+// 单生产者单消费者无锁环形缓冲 - 接收线程把解码后的反馈交给分析/记录线程
+//
+// 生产者从不等待: 缓冲满时丢弃新样本并计入overrun，总线线程的节拍不受消费者影响。
+// 读写下标各占一个缓存行，并各自缓存对方下标，只有缓冲看起来满/空时才读取对方的下标。
+//
+
+#pragma once
+
+#include <atomic>
+#include <cstddef>
+#include <cstdint>
+#include <memory>
+
+#define SPSC_CACHE_LINE 64
+
+template <typename T, size_t Capacity>
+class SpscRing {
+    static_assert(Capacity >= 2 && (Capacity & (Capacity - 1)) == 0, "Capacity must be a power of two");
+
+public:
+    SpscRing() : buffer_(new T[Capacity]) {}
+
+    SpscRing(const SpscRing&) = delete;
+    SpscRing& operator=(const SpscRing&) = delete;
+
+    // 生产者: 放入一个样本，缓冲满时丢弃并返回false
+    bool TryPush(const T& item) {
+        uint64_t head = producer_.head.load(std::memory_order_relaxed);
+        if (head - producer_.cached_tail >= Capacity) {
+            producer_.cached_tail = consumer_.tail.load(std::memory_order_acquire);
+            if (head - producer_.cached_tail >= Capacity) {
+                producer_.overruns.fetch_add(1, std::memory_order_relaxed);
+                return false;
+            }
+        }
+        buffer_[head & (Capacity - 1)] = item;
+        producer_.head.store(head + 1, std::memory_order_release);
+        return true;
+    }
+
+    // 消费者: 取出一个样本，缓冲空时返回false
+    bool TryPop(T& item) {
+        uint64_t tail = consumer_.tail.load(std::memory_order_relaxed);
+        if (tail == consumer_.cached_head) {
+            consumer_.cached_head = producer_.head.load(std::memory_order_acquire);
+            if (tail == consumer_.cached_head) {
+                return false;
+            }
+        }
+        item = buffer_[tail & (Capacity - 1)];
+        consumer_.tail.store(tail + 1, std::memory_order_release);
+        return true;
+    }
+
+    // 消费者: 丢弃当前所有样本 (开始新一段分析前清掉旧数据)
+    void Discard() {
+        consumer_.cached_head = producer_.head.load(std::memory_order_acquire);
+        consumer_.tail.store(consumer_.cached_head, std::memory_order_release);
+    }
+
+    // 以下统计可在任意线程读取
+    uint64_t Pushed() const { return producer_.head.load(std::memory_order_acquire); }
+    uint64_t Overruns() const { return producer_.overruns.load(std::memory_order_relaxed); }
+    size_t Size() const {
+        return static_cast<size_t>(producer_.head.load(std::memory_order_acquire) -
+                                   consumer_.tail.load(std::memory_order_acquire));
+    }
+    static size_t capacity() { return Capacity; }
+
+private:
+    // 生产者独占的缓存行
+    struct alignas(SPSC_CACHE_LINE) ProducerSide {
+        std::atomic<uint64_t> head{0};
+        uint64_t cached_tail = 0;
+        std::atomic<uint64_t> overruns{0};
+    };
+
+    // 消费者独占的缓存行
+    struct alignas(SPSC_CACHE_LINE) ConsumerSide {
+        std::atomic<uint64_t> tail{0};
+        uint64_t cached_head = 0;
+    };
+
+    ProducerSide producer_;
+    ConsumerSide consumer_;
+    std::unique_ptr<T[]> buffer_;
+};
@@ -0,0 +1,65 @@
+//
+// Streaming Regression
+// 流式一元线性回归 - 逐个加入 (x, y) 样本，随时给出斜率、截距和决定系数R²
+//
+// 用Welford式的增量更新累计均值和离差平方和/积和 (Sxx, Syy, Sxy)，不保存样本，
+// 高频采样时内存和每个样本的开销都是常数，也避免了 Σx²-n·x̄² 形式的相消误差。
+// 速度扫描用它拟合 扭矩 = 库伦摩擦 + 粘性系数 × 速度: 截距为库伦摩擦，斜率为粘性系数。
+//
+
+#pragma once
+
+#include <cmath>
+
+class StreamingRegression {
+public:
+    void Reset() {
+        count_ = 0;
+        mean_x_ = 0.0;
+        mean_y_ = 0.0;
+        sxx_ = 0.0;
+        syy_ = 0.0;
+        sxy_ = 0.0;
+    }
+
+    void Add(double x, double y) {
+        count_++;
+        double dx = x - mean_x_;
+        double dy = y - mean_y_;
+        mean_x_ += dx / count_;
+        mean_y_ += dy / count_;
+        // 用更新前的dx乘更新后的离差，与Welford方差更新相同
+        sxx_ += dx * (x - mean_x_);
+        syy_ += dy * (y - mean_y_);
+        sxy_ += dx * (y - mean_y_);
+    }
+
+    // 至少两个样本且x不全相同时才能拟合
+    bool Valid() const { return count_ >= 2 && sxx_ > 0.0; }
+
+    double Slope() const { return Valid() ? sxy_ / sxx_ : 0.0; }
+    double Intercept() const { return mean_y_ - Slope() * mean_x_; }
+
+    // 决定系数: y全相同时拟合是精确的，记为1
+    double RSquared() const {
+        if (!Valid()) {
+            return 0.0;
+        }
+        if (syy_ <= 0.0) {
+            return 1.0;
+        }
+        return (sxy_ * sxy_) / (sxx_ * syy_);
+    }
+
+    int Count() const { return count_; }
+    double MeanX() const { return mean_x_; }
+    double MeanY() const { return mean_y_; }
+
+private:
+    int count_ = 0;
+    double mean_x_ = 0.0;
+    double mean_y_ = 0.0;
+    double sxx_ = 0.0;
+    double syy_ = 0.0;
+    double sxy_ = 0.0;
+};
@@ -0,0 +1,247 @@
+//
+// Telemetry Capture
+// 二进制遥测格式 - 测试过程中连续写入每个关节的反馈，读取端mmap整个文件按记录访问
+//
+// 文件布局 (小端):
+//   TelemetryHeader    固定大小，含电机型号表和测试参数
+//   TelemetryRecord[]  每条反馈一条定长记录，按到达顺序追加
+// 记录数由文件大小推出，采集中途中断时只丢弃最后一条不完整的记录。
+//
+
+#pragma once
+
+#include "pt_protocol.h"
+
+#include <cstdint>
+#include <cstdio>
+#include <cstring>
+#include <string>
+#include <fcntl.h>
+#include <sys/mman.h>
+#include <sys/stat.h>
+#include <unistd.h>
+
+const char TELEMETRY_MAGIC[8] = {'P', 'T', 'T', 'E', 'L', 'E', 'M', '1'};
+const uint32_t TELEMETRY_VERSION = 1;
+const int TELEMETRY_MAX_MOTORS = 16;
+
+// 测试模式标志 (TelemetryHeader::flags)
+const uint32_t TELEMETRY_FLAG_ADAPTIVE = 1u << 0;
+const uint32_t TELEMETRY_FLAG_RAMP = 1u << 1;
+const uint32_t TELEMETRY_FLAG_PARALLEL = 1u << 2;
+
+// 一条关节反馈 (32字节)
+struct TelemetryRecord {
+    uint64_t time_ns;           // 相对采集开始 (测试时钟)
+    uint8_t joint_id;
+    uint8_t motor_error;
+    uint8_t coil_temp_raw;      // 温度原始字节，(x - 50) / 2 °C
+    uint8_t board_temp_raw;
+    float torque_cmd;           // 收到该反馈时该关节最近一次的命令扭矩 (NM)
+    float position_rad;
+    float speed_rads;
+    float current_A;
+    uint32_t reserved;
+};
+
+// 电机型号参数 (与MotorParams对应，型号名定长)
+struct TelemetryMotor {
+    char model[16];
+    float def_ratio;
+    float KT;
+    float T_MINX, T_MAXX;
+    float I_MINX, I_MAXX;
+    float KP_MINX, KP_MAXX;
+    float KD_MINX, KD_MAXX;
+    float POS_MINX, POS_MAXX;
+    float SPD_MINX, SPD_MAXX;
+};
+
+struct TelemetryHeader {
+    char magic[8];
+    uint32_t version;
+    uint32_t header_size;       // 记录区起始偏移
+    uint32_t record_size;
+    uint32_t motor_count;       // motors[] 有效条目数
+    int32_t motor_type;         // 本次测试使用的型号索引，-1表示按关节拓扑 (见joint_motor_type)
+    uint32_t flags;             // TELEMETRY_FLAG_*
+    uint64_t start_unix_ns;     // 采集开始的系统时间
+    uint64_t joint_mask;        // 测试关节，bit i 对应关节 i
+
+    // 测试参数
+    float torque_start;
+    float torque_step;
+    float torque_max;
+    float position_threshold;
+    int32_t wait_time_ms;
+    float ramp_rate;
+    int32_t ramp_hz;
+    uint8_t joint_motor_type[48];   // 每个关节ID的型号索引
+    uint32_t reserved[1];
+
+    TelemetryMotor motors[TELEMETRY_MAX_MOTORS];
+};
+
+static_assert(sizeof(TelemetryRecord) == 32, "TelemetryRecord layout changed");
+static_assert(sizeof(TelemetryMotor) == 72, "TelemetryMotor layout changed");
+static_assert(sizeof(TelemetryHeader) % sizeof(TelemetryRecord) == 0, "records must stay aligned");
+
+inline float TelemetryTemperature(uint8_t raw) {
+    return (raw - 50) / 2.0f;
+}
+
+// 生成文件头: 填好格式字段和完整的电机型号表，测试参数由调用者填写
+inline TelemetryHeader MakeTelemetryHeader(int motor_type) {
+    TelemetryHeader header;
+    memset(&header, 0, sizeof(header));
+    memcpy(header.magic, TELEMETRY_MAGIC, sizeof(header.magic));
+    header.version = TELEMETRY_VERSION;
+    header.header_size = sizeof(TelemetryHeader);
+    header.record_size = sizeof(TelemetryRecord);
+    header.motor_type = motor_type;
+
+    int count = MOTOR_TYPE_COUNT < TELEMETRY_MAX_MOTORS ? MOTOR_TYPE_COUNT : TELEMETRY_MAX_MOTORS;
+    header.motor_count = count;
+    for (int i = 0; i < count; i++) {
+        const MotorParams& src = motorParams[i];
+        TelemetryMotor& dst = header.motors[i];
+        strncpy(dst.model, src.model, sizeof(dst.model) - 1);
+        dst.def_ratio = src.def_ratio;
+        dst.KT = src.KT;
+        dst.T_MINX = src.T_MINX;
+        dst.T_MAXX = src.T_MAXX;
+        dst.I_MINX = src.I_MINX;
+        dst.I_MAXX = src.I_MAXX;
+        dst.KP_MINX = src.KP_MINX;
+        dst.KP_MAXX = src.KP_MAXX;
+        dst.KD_MINX = src.KD_MINX;
+        dst.KD_MAXX = src.KD_MAXX;
+        dst.POS_MINX = src.POS_MINX;
+        dst.POS_MAXX = src.POS_MAXX;
+        dst.SPD_MINX = src.SPD_MINX;
+        dst.SPD_MAXX = src.SPD_MAXX;
+    }
+    return header;
+}
+
+// 顺序追加记录，经stdio缓冲按块写盘；单线程使用
+class TelemetryWriter {
+public:
+    ~TelemetryWriter() { Close(); }
+
+    bool Open(const std::string& path, const TelemetryHeader& header) {
+        Close();
+        file_ = fopen(path.c_str(), "wb");
+        if (!file_) {
+            return false;
+        }
+        setvbuf(file_, nullptr, _IOFBF, 1 << 16);
+        count_ = 0;
+        if (fwrite(&header, sizeof(header), 1, file_) != 1) {
+            Close();
+            return false;
+        }
+        return true;
+    }
+
+    bool IsOpen() const { return file_ != nullptr; }
+
+    void Write(const TelemetryRecord& record) {
+        if (file_ && fwrite(&record, sizeof(record), 1, file_) == 1) {
+            count_++;
+        }
+    }
+
+    void Flush() {
+        if (file_) {
+            fflush(file_);
+        }
+    }
+
+    void Close() {
+        if (file_) {
+            fclose(file_);
+            file_ = nullptr;
+        }
+    }
+
+    uint64_t Count() const { return count_; }
+
+private:
+    FILE* file_ = nullptr;
+    uint64_t count_ = 0;
+};
+
+// 只读映射整个文件，记录按下标随机访问，不做任何解析或拷贝
+class TelemetryReader {
+public:
+    ~TelemetryReader() { Close(); }
+
+    bool Open(const std::string& path, std::string* error = nullptr) {
+        Close();
+        int fd = open(path.c_str(), O_RDONLY);
+        if (fd < 0) {
+            return Fail(error, "无法打开文件");
+        }
+
+        struct stat st;
+        if (fstat(fd, &st) != 0 || static_cast<size_t>(st.st_size) < sizeof(TelemetryHeader)) {
+            close(fd);
+            return Fail(error, "文件过小，不是遥测文件");
+        }
+
+        size_ = static_cast<size_t>(st.st_size);
+        void* data = mmap(nullptr, size_, PROT_READ, MAP_PRIVATE, fd, 0);
+        close(fd);
+        if (data == MAP_FAILED) {
+            size_ = 0;
+            return Fail(error, "mmap失败");
+        }
+        data_ = static_cast<const uint8_t*>(data);
+        madvise(data, size_, MADV_SEQUENTIAL);
+
+        const TelemetryHeader& header = Header();
+        if (memcmp(header.magic, TELEMETRY_MAGIC, sizeof(header.magic)) != 0) {
+            Close();
+            return Fail(error, "文件标识不匹配");
+        }
+        if (header.version != TELEMETRY_VERSION || header.record_size != sizeof(TelemetryRecord) ||
+            header.header_size < sizeof(TelemetryHeader) || header.header_size > size_) {
+            Close();
+            return Fail(error, "不支持的遥测格式版本");
+        }
+
+        records_ = reinterpret_cast<const TelemetryRecord*>(data_ + header.header_size);
+        count_ = (size_ - header.header_size) / sizeof(TelemetryRecord);
+        return true;
+    }
+
+    void Close() {
+        if (data_) {
+            munmap(const_cast<uint8_t*>(data_), size_);
+        }
+        data_ = nullptr;
+        records_ = nullptr;
+        size_ = 0;
+        count_ = 0;
+    }
+
+    const TelemetryHeader& Header() const { return *reinterpret_cast<const TelemetryHeader*>(data_); }
+    size_t Count() const { return count_; }
+    const TelemetryRecord& operator[](size_t i) const { return records_[i]; }
+    const TelemetryRecord* begin() const { return records_; }
+    const TelemetryRecord* end() const { return records_ + count_; }
+
+private:
+    static bool Fail(std::string* error, const char* message) {
+        if (error) {
+            *error = message;
+        }
+        return false;
+    }
+
+    const uint8_t* data_ = nullptr;
+    const TelemetryRecord* records_ = nullptr;
+    size_t size_ = 0;
+    size_t count_ = 0;
+};
@@ -0,0 +1,166 @@
+//
+// Test Clock
+// 测试时钟接口 - 测试程序中所有等待和计时都经过这里
+//
+// RealTimeClock 使用系统单调时钟；VirtualClock 是离散事件虚拟时间，Sleep立即推进时间，
+// 配合仿真CAN库时整套测试可以远快于实时运行。
+//
+
+#pragma once
+
+#include <algorithm>
+#include <atomic>
+#include <cerrno>
+#include <chrono>
+#include <cmath>
+#include <condition_variable>
+#include <cstdint>
+#include <mutex>
+#include <thread>
+#include <dlfcn.h>
+#include <time.h>
+
+class Clock {
+public:
+    virtual ~Clock() {}
+
+    // 当前时刻 (秒)
+    virtual double Now() = 0;
+
+    // 等待指定时长 (秒)
+    virtual void SleepFor(double seconds) = 0;
+
+    // 等待到绝对时刻 (与Now()同一时间轴)，已过去时立即返回
+    virtual void SleepUntil(double deadline) { SleepFor(deadline - Now()); }
+
+    // 后台线程 (例如CAN接收线程) 的同步点:
+    // 线程开始一轮工作前取 Generation()，工作完成后调用 Idle(generation) 等待下一次时间推进。
+    virtual uint64_t Generation() { return 0; }
+    virtual void Idle(uint64_t generation) = 0;
+
+    // 注册/注销参与同步的后台线程，Wake() 唤醒所有在 Idle 中等待的线程 (用于停止线程)
+    virtual void AddFollower() {}
+    virtual void RemoveFollower() {}
+    virtual void Wake() {}
+
+    void SleepMs(int ms) { SleepFor(ms / 1000.0); }
+};
+
+class RealTimeClock : public Clock {
+public:
+    double Now() override {
+        return std::chrono::duration<double>(std::chrono::steady_clock::now().time_since_epoch()).count();
+    }
+
+    void SleepFor(double seconds) override {
+        if (seconds > 0) {
+            std::this_thread::sleep_for(std::chrono::duration<double>(seconds));
+        }
+    }
+
+    // steady_clock 在Linux上即 CLOCK_MONOTONIC，按绝对时刻睡眠不受唤醒前耗时的影响
+    void SleepUntil(double deadline) override {
+        timespec ts;
+        ts.tv_sec = static_cast<time_t>(deadline);
+        ts.tv_nsec = static_cast<long>((deadline - ts.tv_sec) * 1e9);
+        if (ts.tv_nsec >= 1000000000L) {
+            ts.tv_sec++;
+            ts.tv_nsec -= 1000000000L;
+        }
+        while (clock_nanosleep(CLOCK_MONOTONIC, TIMER_ABSTIME, &ts, nullptr) == EINTR) {
+        }
+    }
+
+    // 实时模式下后台线程空闲时短暂休眠，避免空转
+    void Idle(uint64_t) override {
+        std::this_thread::sleep_for(std::chrono::microseconds(200));
+    }
+};
+
+class VirtualClock : public Clock {
+public:
+    double Now() override {
+        return now_ns_.load(std::memory_order_acquire) * 1e-9;
+    }
+
+    // 推进虚拟时间，并等所有后台线程处理完新时刻之前的事件后再返回
+    void SleepFor(double seconds) override {
+        Advance(seconds > 0 ? static_cast<int64_t>(seconds * 1e9) : 0);
+    }
+
+    // 直接推进到截止时刻 (四舍五入到纳秒)，避免换算成时长时截断导致的逐周期漂移
+    void SleepUntil(double deadline) override {
+        int64_t target = static_cast<int64_t>(std::llround(deadline * 1e9));
+        Advance(std::max<int64_t>(0, target - now_ns_.load(std::memory_order_acquire)));
+    }
+
+    uint64_t Generation() override {
+        std::lock_guard<std::mutex> lock(mutex_);
+        return generation_;
+    }
+
+    void Idle(uint64_t generation) override {
+        std::unique_lock<std::mutex> lock(mutex_);
+        if (generation != generation_) {
+            return;     // 工作期间时间已推进，需要再处理一轮
+        }
+        idle_followers_++;
+        cv_.notify_all();
+        cv_.wait(lock, [this, generation] { return generation_ != generation; });
+    }
+
+    void AddFollower() override {
+        std::lock_guard<std::mutex> lock(mutex_);
+        followers_++;
+    }
+
+    void RemoveFollower() override {
+        std::lock_guard<std::mutex> lock(mutex_);
+        followers_--;
+        cv_.notify_all();
+    }
+
+    void Wake() override {
+        std::lock_guard<std::mutex> lock(mutex_);
+        generation_++;
+        cv_.notify_all();
+    }
+
+private:
+    void Advance(int64_t ns) {
+        std::unique_lock<std::mutex> lock(mutex_);
+        if (ns > 0) {
+            now_ns_.fetch_add(ns, std::memory_order_acq_rel);
+        }
+        generation_++;
+        idle_followers_ = 0;
+        cv_.notify_all();
+        cv_.wait(lock, [this] { return idle_followers_ >= followers_; });
+    }
+
+    std::atomic<int64_t> now_ns_{0};
+    std::mutex mutex_;
+    std::condition_variable cv_;
+    uint64_t generation_ = 0;
+    int followers_ = 0;
+    int idle_followers_ = 0;
+};
+
+// 仿真CAN库导出 SIM_SetTimeSource，真实设备库没有该符号
+typedef double (*SimTimeSourceFn)(void* context);
+typedef void (*SimSetTimeSourceFn)(SimTimeSourceFn source, void* context);
+
+inline double ClockTimeSource(void* context) {
+    return static_cast<Clock*>(context)->Now();
+}
+
+// 让仿真库按给定时钟推进物理模型；链接的是真实设备库时返回false
+inline bool AttachSimulatorClock(Clock* clock) {
+    SimSetTimeSourceFn set_time_source =
+        reinterpret_cast<SimSetTimeSourceFn>(dlsym(RTLD_DEFAULT, "SIM_SetTimeSource"));
+    if (!set_time_source) {
+        return false;
+    }
+    set_time_source(&ClockTimeSource, clock);
+    return true;
+}
@@ -0,0 +1,217 @@
+//
+// Thermal Model
+// 关节线圈的一阶热模型和冷却调度 - 按预测的峰值温度决定下一个方向/关节何时开始，代替固定的冷却时间
+//
+// 线圈相对驱动板 (外壳) 的温升: C·dTc/dt = I²·R - (Tc - Tb)/Rth，时间常数 τ = Rth·C。
+// 驱动板热容大得多，一个方向的测试期间视为不变。模型用命令电流按分段恒定积分，
+// 收到反馈的线圈/驱动板温度时直接校正 (温度反馈为0.5°C量化)。
+//
+// 负载 (ThermalLoad) 是一段测试的 ∫I²dt 和时长；从当前温度按平均功率施加该负载，
+// 线圈温度单调趋向稳态，峰值在开始或结束时刻。峰值不超过 max_temp - margin 即可开始，
+// 否则按零电流冷却的指数曲线算出需要等待的时间。
+//
+// 单线程使用 (测试线程)。
+//
+
+#pragma once
+
+#include <algorithm>
+#include <cmath>
+#include <vector>
+
+// 预测峰值相对温度上限的余量 (°C)，覆盖温度量化和驱动板在测试中的温升
+const float THERMAL_MARGIN_C = 2.0f;
+// 负载本身就会超过上限时，线圈冷却到比驱动板高不超过该值即开始 (°C)
+const float THERMAL_COOLED_C = 1.0f;
+
+struct ThermalParams {
+    float winding_resistance_ohm = 0.5f;    // 线圈电阻
+    float thermal_resistance_k_w = 2.0f;    // 线圈到驱动板的热阻 (K/W)
+    float heat_capacity_j_k = 30.0f;        // 线圈热容 (J/K)
+    float ambient_c = 25.0f;                // 未收到温度反馈时的初始温度
+
+    double TimeConstant() const { return static_cast<double>(thermal_resistance_k_w) * heat_capacity_j_k; }
+};
+
+// 一段测试的发热量: 电流平方的积分和时长
+struct ThermalLoad {
+    double i2_seconds = 0.0;    // ∫I²dt (A²·s)
+    double duration_s = 0.0;
+
+    double MeanSquare() const { return duration_s > 0 ? i2_seconds / duration_s : 0.0; }
+};
+
+// 单个关节的热状态
+class ThermalModel {
+public:
+    explicit ThermalModel(const ThermalParams& params = ThermalParams())
+        : params_(params), coil_(params.ambient_c), board_(params.ambient_c) {}
+
+    // 用反馈的温度校正状态；board_c 为NAN时 (只有线圈温度的协议) 保持原来的驱动板温度
+    void Observe(float coil_c, float board_c, double now) {
+        Advance(now);
+        coil_ = coil_c;
+        if (!std::isnan(board_c)) {
+            board_ = board_c;
+        }
+        observed_ = true;
+        max_observed_ = std::max(max_observed_, coil_c);
+    }
+
+    // 命令电流改变: 之前的电流积分到now，此后保持current_A
+    void Command(float current_A, double now) {
+        Advance(now);
+        current_ = current_A;
+    }
+
+    // 按保持的电流把状态积分到now
+    void Advance(double now) {
+        if (last_time_ < 0) {
+            last_time_ = now;
+            return;
+        }
+        double dt = now - last_time_;
+        if (dt <= 0) {
+            return;
+        }
+        last_time_ = now;
+        double i2 = static_cast<double>(current_) * current_;
+        coil_ = static_cast<float>(Approach(coil_, i2, dt));
+        if (load_active_) {
+            load_.i2_seconds += i2 * dt;
+        }
+    }
+
+    // 开始/结束一段负载的累计 (一个方向的测试)，结束时的负载作为下一段的预测
+    void BeginLoad(double now) {
+        Advance(now);
+        load_ = ThermalLoad();
+        load_start_ = now;
+        load_active_ = true;
+    }
+
+    void EndLoad(double now) {
+        if (!load_active_) {
+            return;
+        }
+        Advance(now);
+        load_.duration_s = now - load_start_;
+        load_active_ = false;
+        last_load_ = load_;
+        has_load_ = true;
+    }
+
+    bool HasLoad() const { return has_load_; }
+    const ThermalLoad& LastLoad() const { return last_load_; }
+
+    // 从当前状态施加load后的线圈峰值温度
+    float PredictPeak(const ThermalLoad& load) const {
+        return static_cast<float>(std::max(static_cast<double>(coil_), Approach(coil_, load.MeanSquare(), load.duration_s)));
+    }
+
+    // 施加load前需要的零电流冷却时间 (秒)，使峰值不超过limit_c。
+    // 负载从驱动板温度开始也会超过上限时 (通常是按扭矩上限估计的负载)，等待无济于事，冷却到接近驱动板温度即可；
+    // 驱动板本身已接近上限时只靠线圈冷却达不到，返回INFINITY
+    double CooldownTime(const ThermalLoad& load, float limit_c) const {
+        double tau = params_.TimeConstant();
+        double decay = std::exp(-load.duration_s / tau);
+        double rise = load.MeanSquare() * params_.winding_resistance_ohm * params_.thermal_resistance_k_w * (1.0 - decay);
+        // 开始时的线圈温度上限: 开始时不超过limit，结束时 Tb + (Tc0 - Tb)·decay + rise 不超过limit
+        double target = std::min(static_cast<double>(limit_c), board_ + (limit_c - board_ - rise) / decay);
+        if (target <= board_) {
+            if (board_ + THERMAL_COOLED_C > limit_c) {
+                return INFINITY;
+            }
+            target = board_ + THERMAL_COOLED_C;
+        }
+        if (coil_ <= target) {
+            return 0.0;
+        }
+        return tau * std::log((coil_ - board_) / (target - board_));
+    }
+
+    bool Observed() const { return observed_; }
+    float Coil() const { return coil_; }
+    float Board() const { return board_; }
+    float MaxObserved() const { return max_observed_; }
+
+private:
+    // 电流平方保持i2经过dt后的线圈温度
+    double Approach(double coil, double i2, double dt) const {
+        double steady = board_ + i2 * params_.winding_resistance_ohm * params_.thermal_resistance_k_w;
+        return steady + (coil - steady) * std::exp(-dt / params_.TimeConstant());
+    }
+
+    ThermalParams params_;
+    float coil_;
+    float board_;
+    float current_ = 0.0f;
+    double last_time_ = -1.0;
+    bool observed_ = false;
+    float max_observed_ = -INFINITY;
+
+    ThermalLoad load_;
+    double load_start_ = 0.0;
+    bool load_active_ = false;
+    ThermalLoad last_load_;
+    bool has_load_ = false;
+};
+
+// 各关节的热模型和冷却决策
+class CooldownScheduler {
+public:
+    explicit CooldownScheduler(float max_temp_c = 80.0f, const ThermalParams& params = ThermalParams())
+        : params_(params), max_temp_(max_temp_c) {}
+
+    void Configure(float max_temp_c, const ThermalParams& params = ThermalParams()) {
+        max_temp_ = max_temp_c;
+        params_ = params;
+        joints_.clear();
+        Reset();
+    }
+
+    void Reset() {
+        waits_ = 0;
+        wait_time_ = 0.0;
+        for (auto& joint : joints_) {
+            joint = ThermalModel(params_);
+        }
+    }
+
+    ThermalModel& Joint(int joint_id) {
+        if (joint_id >= static_cast<int>(joints_.size())) {
+            joints_.resize(joint_id + 1, ThermalModel(params_));
+        }
+        return joints_[joint_id];
+    }
+
+    void SetMaxTemperature(float max_temp_c) { max_temp_ = max_temp_c; }
+
+    // 预测峰值须不超过的温度
+    float Limit() const { return max_temp_ - THERMAL_MARGIN_C; }
+    float MaxTemperature() const { return max_temp_; }
+
+    // 关节开始下一段测试前还需冷却的时间 (秒)。该关节测过一个方向时按实际负载预测，否则按planned
+    double WaitTime(int joint_id, const ThermalLoad& planned) {
+        ThermalModel& joint = Joint(joint_id);
+        return joint.CooldownTime(joint.HasLoad() ? joint.LastLoad() : planned, Limit());
+    }
+
+    // 记录一次实际发生的冷却等待
+    void RecordWait(double seconds) {
+        if (seconds > 0) {
+            waits_++;
+            wait_time_ += seconds;
+        }
+    }
+
+    int Waits() const { return waits_; }
+    double WaitTotal() const { return wait_time_; }
+
+private:
+    ThermalParams params_;
+    float max_temp_;
+    std::vector<ThermalModel> joints_;
+    int waits_ = 0;
+    double wait_time_ = 0.0;
+};
@@ -5,6 +5,7 @@
 //
 
 #include "friction_test.h"
+#include "test_clock.h"
 #include <signal.h>
 #include <iostream>
 #include <string>
@@ -17,6 +18,11 @@ using namespace friction_test;
 FrictionTester* g_tester = nullptr;
 std::atomic<bool> g_shutdown_requested(false);
 
+// 测试时钟 (冷却等待和进度计时)，--virtual-time 时替换为虚拟时钟
+RealTimeClock g_real_clock;
+VirtualClock g_virtual_clock;
+Clock* g_clock = &g_real_clock;
+
 // 32个关节的ID定义 (1-40, 覆盖32个实际关节)
 const std::vector<int> ALL_JOINT_IDS = {
     1, 2, 3, 4, 5, 6, 7, 8, 9, 10,
@@ -25,6 +31,10 @@ const std::vector<int> ALL_JOINT_IDS = {
     31, 32, 33, 34, 35, 36, 37, 38, 39, 40
 };
 
+// 冷却等待期间重新读取温度的间隔和最长等待时间 (秒)
+const double COOLDOWN_POLL_S = 1.0;
+const double COOLDOWN_MAX_S = 600.0;
+
 // 信号处理函数
 void signalHandler(int sig) {
     std::cout << "\nReceived signal " << sig << ", initiating emergency stop..." << std::endl;
@@ -60,6 +70,7 @@ void printUsage(const char* program_name) {
     std::cout << "  --save-raw FILE           Save raw test data to file\n";
     std::cout << "  --parallel                Enable parallel testing (multiple joints)\n";
     std::cout << "  --batch-size N            Number of joints to test in parallel (default: 4)\n";
+    std::cout << "  --virtual-time            Run on virtual time (simulated CAN library only)\n";
     std::cout << "\nJoint Groups:\n";
     std::cout << "  --left-arm                Test left arm joints (1-8)\n";
     std::cout << "  --right-arm               Test right arm joints (9-16)\n";
@@ -314,6 +325,35 @@ bool confirmTestStart(const TestParams& params, const std::vector<int>& test_joi
 }
 
 // 验证关节ID是否有效
+// 等到这些电机的预测峰值温度都低于上限 (冷的电机不等待)，返回等待的秒数
+double waitForCooldown(FrictionTester& tester, const std::vector<int>& motor_indices) {
+    double start = g_clock->Now();
+    bool announced = false;
+    while (!g_shutdown_requested) {
+        double wait = 0.0;
+        for (int motor_index : motor_indices) {
+            wait = std::max(wait, tester.cooldownTime(motor_index));
+        }
+        if (wait <= 0.0) {
+            break;
+        }
+        if (g_clock->Now() - start > COOLDOWN_MAX_S) {
+            Logger::warn("Cooldown did not finish within " + std::to_string(static_cast<int>(COOLDOWN_MAX_S)) + " s, continuing");
+            break;
+        }
+        if (!announced) {
+            announced = true;
+            std::cout << "Predicted peak temperature above limit. Cooling down";
+            if (std::isfinite(wait)) {
+                std::cout << " for about " << static_cast<int>(std::ceil(wait)) << " seconds";
+            }
+            std::cout << "...\n";
+        }
+        g_clock->SleepFor(std::min(wait, COOLDOWN_POLL_S));
+    }
+    return g_clock->Now() - start;
+}
+
 bool isValidJointId(int joint_id) {
     return joint_id >= 1 && joint_id <= 40;
 }
@@ -373,6 +413,7 @@ int main(int argc, char** argv) {
         {"right-leg", no_argument, 0, 1015},
         {"upper-body", no_argument, 0, 1016},
         {"lower-body", no_argument, 0, 1017},
+        {"virtual-time", no_argument, 0, 1018},
         {0, 0, 0, 0}
     };
     
@@ -590,6 +631,14 @@ int main(int argc, char** argv) {
                 test_joints = getJointGroup("lower-body");
                 break;
                 
+            case 1018: // --virtual-time
+                if (!AttachSimulatorClock(&g_virtual_clock)) {
+                    std::cerr << "Error: --virtual-time requires the simulated CAN library (LD_LIBRARY_PATH=./lib/sim)\n";
+                    return 1;
+                }
+                g_clock = &g_virtual_clock;
+                break;
+                
             case '?':
                 std::cerr << "Error: Unknown option. Use --help for usage information.\n";
                 return 1;
@@ -632,6 +681,9 @@ int main(int argc, char** argv) {
         return 0;
     }
     
+    // 之后的日志由后台线程写出，控制和收发线程不等待终端输出
+    Logger::startAsync();
+    
     try {
         // 创建测试器
         FrictionTester tester;
@@ -714,15 +766,12 @@ int main(int argc, char** argv) {
                     }
                 }
                 
+                // 批次中的电机都冷却到位后再开始
+                waitForCooldown(tester, motor_indices);
+                
                 // 执行并行测试 (需要实现并行测试功能)
                 auto batch_results = tester.testMotorsBatch(motor_indices);
                 results.insert(results.end(), batch_results.begin(), batch_results.end());
-                
-                // 批次间休息
-                if (i + batch_size < test_joints.size()) {
-                    std::cout << "Batch completed. Cooling down for 30 seconds...\n";
-                    std::this_thread::sleep_for(std::chrono::seconds(30));
-                }
             }
         } else {
             // 顺序测试所有关节
@@ -730,7 +779,7 @@ int main(int argc, char** argv) {
             std::cout << "Press Ctrl+C to emergency stop at any time.\n\n";
             
             // 显示进度信息
-            auto start_time = std::chrono::steady_clock::now();
+            double start_time = g_clock->Now();
             
             for (size_t i = 0; i < test_joints.size(); i++) {
                 int joint_id = test_joints[i];
@@ -748,6 +797,7 @@ int main(int argc, char** argv) {
                 }
                 
                 if (motor_index >= 0) {
+                    waitForCooldown(tester, {motor_index});
                     MotorFrictionResult result = tester.testSingleMotor(motor_index);
                     results.push_back(result);
                     
@@ -762,21 +812,14 @@ int main(int argc, char** argv) {
                     
                     // 显示进度和预估时间
                     if (i < test_joints.size() - 1) {
-                        auto current_time = std::chrono::steady_clock::now();
-                        auto elapsed = std::chrono::duration_cast<std::chrono::seconds>(current_time - start_time);
-                        double avg_time_per_joint = static_cast<double>(elapsed.count()) / (i + 1);
+                        double elapsed = g_clock->Now() - start_time;
+                        double avg_time_per_joint = elapsed / (i + 1);
                         double estimated_remaining = avg_time_per_joint * (test_joints.size() - i - 1);
                         
                         std::cout << "Progress: " << std::fixed << std::setprecision(1) 
                                   << (100.0 * (i + 1) / test_joints.size()) << "%, "
                                   << "Estimated remaining: " << static_cast<int>(estimated_remaining / 60) 
                                   << "m " << static_cast<int>(estimated_remaining) % 60 << "s\n";
-                        
-                        // 关节间冷却时间
-                        if (params.test_duration > 5.0) {
-                            std::cout << "Cooling down for 10 seconds...\n";
-                            std::this_thread::sleep_for(std::chrono::seconds(10));
-                        }
                     }
                 } else {
                     Logger::error("Joint ID " + std::to_string(joint_id) + " not found in motor list");
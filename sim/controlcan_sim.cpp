@@ -0,0 +1,543 @@
+//
+// Simulated USBCAN Library
+// 仿真CAN库 - 实现controlcan.h中的VCI_*接口，每个关节ID背后是一个带摩擦模型的刚体关节
+//
+// 编译为 lib/sim/libcontrolcan.so，运行时用 LD_LIBRARY_PATH=lib/sim 替换真实设备库。
+//
+// 环境变量:
+//   SIM_JOINTS            在线关节列表 (例如 "1-32" 或 "1,2,5")，默认 1-40
+//   SIM_FAULTS            报告错误码的关节 (例如 "5:3,7:1" 表示关节5错误码3、关节7错误码1)，默认无
+//   SIM_MOTOR_TYPE        电机型号索引 (与测试程序 -t 一致)，默认 0；
+//                         取 "topology" 时每个关节按 joint_topology.h 的整机型号 (与 --topology 一致)
+//   SIM_SEED              摩擦参数随机种子，默认 1
+//   SIM_REPLY_LATENCY_US  电机收到命令到发出反馈的延迟 (us)，默认 300
+//   SIM_VERBOSE           打开设备时打印每个关节的摩擦力真值
+//   SIM_DEVICES           VCI_FindUsbDevice2 报告的设备数，默认 1
+//   SIM_BUS_ROUTING       置1时关节只在 joint_bus_map.h 规定的设备/通道上应答，默认任意总线都应答
+//
+// 测试程序可通过 SIM_SetTimeSource 接管仿真时间 (见 include/test_clock.h)。
+//
+
+#include "controlcan_sim.h"
+#include "pt_protocol.h"
+#include "joint_bus_map.h"
+
+#include <chrono>
+#include <cmath>
+#include <cstdio>
+#include <cstdlib>
+#include <cstring>
+#include <algorithm>
+#include <deque>
+#include <mutex>
+#include <random>
+#include <sstream>
+#include <string>
+#include <thread>
+
+namespace {
+
+const int SIM_MAX_JOINT_ID = 40;
+const int SIM_MAX_DEVICES = 4;
+const int SIM_CHANNELS = 2;
+const double SIM_STEP_S = 0.00025;          // 物理积分步长
+const double SIM_STICK_VELOCITY = 1e-4;     // 低于此速度视为静止 (rad/s)
+const double SIM_FRAME_TIME_S = 130e-6;     // 1Mbps下一帧8字节标准帧约130位
+const double SIM_AMBIENT_TEMP = 25.0;
+
+// 刚体关节: J·dω/dt = τ_cmd - τ_friction(ω)
+struct SimJoint {
+    bool present = false;
+    int motor_type = 0;
+
+    // 物理参数 (真值)
+    double inertia = 0.02;
+    double static_friction = 0.5;
+    double coulomb_friction = 0.4;
+    double viscous_coeff = 0.05;
+    double stribeck_velocity = 0.05;
+
+    // 状态
+    double position = 0.0;
+    double velocity = 0.0;
+    double applied_torque = 0.0;
+    double coil_temp = SIM_AMBIENT_TEMP;
+    double board_temp = SIM_AMBIENT_TEMP;
+    uint8_t error = 0;
+
+    // 最近一次PT命令
+    double kp = 0.0, kd = 0.0, pos_des = 0.0, vel_des = 0.0, torque_ff = 0.0;
+};
+
+struct PendingFrame {
+    double deliver_time;
+    VCI_CAN_OBJ frame;
+};
+
+struct SimChannel {
+    bool initialized = false;
+    bool started = false;
+    double bus_free_time = 0.0;   // 总线空闲时刻，用于估计帧排队
+    std::deque<PendingFrame> rx_queue;
+};
+
+struct SimDevice {
+    bool open = false;
+    SimChannel channels[SIM_CHANNELS];
+};
+
+struct SimState {
+    std::mutex mutex;
+    bool configured = false;
+    SIM_TIME_SOURCE time_source = nullptr;
+    void* time_context = nullptr;
+    double sim_time = 0.0;        // 物理状态已积分到的时刻
+    double reply_latency = 300e-6;
+    bool bus_routing = false;     // 关节只在所属总线上应答
+    int device_count = 1;
+    SimJoint joints[SIM_MAX_JOINT_ID + 1];
+    SimDevice devices[SIM_MAX_DEVICES];
+};
+
+SimState g_sim;
+
+double sim_now() {
+    if (g_sim.time_source) {
+        return g_sim.time_source(g_sim.time_context);
+    }
+    static const auto start = std::chrono::steady_clock::now();
+    return std::chrono::duration<double>(std::chrono::steady_clock::now() - start).count();
+}
+
+int env_int(const char* name, int default_value) {
+    const char* value = getenv(name);
+    return value ? atoi(value) : default_value;
+}
+
+// 解析 "1-32" 或 "1,2,5" 格式的关节列表
+void parse_joint_list(const std::string& text, bool present[]) {
+    std::stringstream ss(text);
+    std::string token;
+    while (std::getline(ss, token, ',')) {
+        size_t dash = token.find('-');
+        int first = atoi(token.substr(0, dash).c_str());
+        int last = (dash == std::string::npos) ? first : atoi(token.substr(dash + 1).c_str());
+        for (int id = first; id <= last; id++) {
+            if (id >= 1 && id <= SIM_MAX_JOINT_ID) {
+                present[id] = true;
+            }
+        }
+    }
+}
+
+void configure() {
+    if (g_sim.configured) {
+        return;
+    }
+
+    bool present[SIM_MAX_JOINT_ID + 1] = {false};
+    const char* joints = getenv("SIM_JOINTS");
+    parse_joint_list(joints ? joints : "1-40", present);
+
+    const char* type_env = getenv("SIM_MOTOR_TYPE");
+    bool topology = type_env && strcmp(type_env, "topology") == 0;
+    int motor_type = topology ? 0 : env_int("SIM_MOTOR_TYPE", 0);
+    if (motor_type < 0 || motor_type >= MOTOR_TYPE_COUNT) {
+        motor_type = 0;
+    }
+    int seed = env_int("SIM_SEED", 1);
+    g_sim.reply_latency = env_int("SIM_REPLY_LATENCY_US", 300) * 1e-6;
+    g_sim.bus_routing = env_int("SIM_BUS_ROUTING", 0) != 0;
+    g_sim.device_count = std::min(std::max(env_int("SIM_DEVICES", 1), 1), SIM_MAX_DEVICES);
+
+    for (int id = 1; id <= SIM_MAX_JOINT_ID; id++) {
+        SimJoint& joint = g_sim.joints[id];
+        std::mt19937 rng(static_cast<unsigned>(seed * 1000 + id));
+        std::uniform_real_distribution<double> unit(0.0, 1.0);
+
+        joint.present = present[id];
+        joint.motor_type = topology ? jointMotorType(id) : motor_type;
+        joint.inertia = 0.01 + 0.04 * unit(rng);
+        joint.static_friction = 0.3 + 1.5 * unit(rng);
+        joint.coulomb_friction = joint.static_friction * (0.6 + 0.25 * unit(rng));
+        joint.viscous_coeff = 0.02 + 0.18 * unit(rng);
+        joint.stribeck_velocity = 0.02 + 0.08 * unit(rng);
+        joint.position = -0.5 + unit(rng);
+    }
+
+    const char* faults = getenv("SIM_FAULTS");
+    if (faults) {
+        std::stringstream ss(faults);
+        std::string token;
+        while (std::getline(ss, token, ',')) {
+            size_t colon = token.find(':');
+            int id = atoi(token.substr(0, colon).c_str());
+            int code = (colon == std::string::npos) ? 1 : atoi(token.substr(colon + 1).c_str());
+            if (id >= 1 && id <= SIM_MAX_JOINT_ID) {
+                g_sim.joints[id].error = static_cast<uint8_t>(code);
+            }
+        }
+    }
+
+    if (getenv("SIM_VERBOSE")) {
+        fprintf(stderr, "[SIM] 电机型号 %s, 种子 %d\n", topology ? "按关节拓扑" : motorParams[motor_type].model, seed);
+        for (int id = 1; id <= SIM_MAX_JOINT_ID; id++) {
+            const SimJoint& joint = g_sim.joints[id];
+            if (!joint.present) continue;
+            fprintf(stderr, "[SIM] 关节%2d %-7s: Fs=%.3f Fc=%.3f b=%.3f J=%.4f\n", id, motorParams[joint.motor_type].model,
+                    joint.static_friction, joint.coulomb_friction, joint.viscous_coeff, joint.inertia);
+        }
+    }
+
+    g_sim.sim_time = sim_now();
+    g_sim.configured = true;
+}
+
+// Stribeck摩擦曲线 (运动状态)
+double friction_torque(const SimJoint& joint, double velocity) {
+    double ratio = velocity / joint.stribeck_velocity;
+    double magnitude = joint.coulomb_friction +
+                       (joint.static_friction - joint.coulomb_friction) * exp(-ratio * ratio);
+    return (velocity > 0 ? magnitude : -magnitude) + joint.viscous_coeff * velocity;
+}
+
+// PT控制律输出扭矩，限制在电机扭矩范围内
+double commanded_torque(const SimJoint& joint) {
+    const MotorParams& motor = motorParams[joint.motor_type];
+    double torque = joint.kp * (joint.pos_des - joint.position) +
+                    joint.kd * (joint.vel_des - joint.velocity) + joint.torque_ff;
+    return std::max<double>(motor.T_MINX, std::min<double>(motor.T_MAXX, torque));
+}
+
+void step_joint(SimJoint& joint, double dt) {
+    const MotorParams& motor = motorParams[joint.motor_type];
+
+    double torque = commanded_torque(joint);
+    joint.applied_torque = torque;
+
+    if (fabs(joint.velocity) < SIM_STICK_VELOCITY) {
+        // 粘滞: 驱动扭矩未超过静摩擦则保持静止，否则按剩余扭矩起步
+        if (fabs(torque) <= joint.static_friction) {
+            joint.velocity = 0.0;
+        } else {
+            double net = torque - (torque > 0 ? joint.static_friction : -joint.static_friction);
+            joint.velocity += net / joint.inertia * dt;
+        }
+    } else {
+        double next = joint.velocity + (torque - friction_torque(joint, joint.velocity)) / joint.inertia * dt;
+        // 速度过零时重新判断是否粘住
+        if (next * joint.velocity < 0 && fabs(torque) <= joint.static_friction) {
+            next = 0.0;
+        }
+        joint.velocity = next;
+    }
+    joint.position += joint.velocity * dt;
+
+    // 一阶热模型: 线圈铜损加热，向驱动板散热
+    double current = torque / (motor.KT * motor.def_ratio);
+    joint.coil_temp += (current * current * 0.5 - (joint.coil_temp - joint.board_temp) / 2.0) / 30.0 * dt;
+    joint.board_temp += ((joint.coil_temp - joint.board_temp) / 2.0 -
+                         (joint.board_temp - SIM_AMBIENT_TEMP) / 1.0) / 200.0 * dt;
+}
+
+// 把所有关节积分到当前时刻
+void advance(double now) {
+    while (g_sim.sim_time + SIM_STEP_S <= now) {
+        for (int id = 1; id <= SIM_MAX_JOINT_ID; id++) {
+            if (g_sim.joints[id].present) {
+                step_joint(g_sim.joints[id], SIM_STEP_S);
+            }
+        }
+        g_sim.sim_time += SIM_STEP_S;
+    }
+}
+
+int clamp_int(int value, int low, int high) {
+    return value < low ? low : (value > high ? high : value);
+}
+
+uint8_t encode_temperature(double temp) {
+    return static_cast<uint8_t>(clamp_int(static_cast<int>(lround(temp * 2.0 + 50.0)), 0, 255));
+}
+
+// 解码PT命令 (电机端解析方式)
+void apply_command(SimJoint& joint, const VCI_CAN_OBJ& frame) {
+    const MotorParams& motor = motorParams[joint.motor_type];
+    const BYTE* d = frame.Data;
+
+    int kp = (d[0] << 7) | (d[1] >> 1);
+    int kd = ((d[1] & 0x1) << 8) | d[2];
+    int pos = (d[3] << 8) | d[4];
+    int spd = (d[5] << 4) | (d[6] >> 4);
+    int tor = ((d[6] & 0xF) << 8) | d[7];
+
+    joint.kp = uint_to_float(kp, motor.KP_MINX, motor.KP_MAXX, 12);
+    joint.kd = uint_to_float(kd, motor.KD_MINX, motor.KD_MAXX, 9);
+    joint.pos_des = uint_to_float(pos, motor.POS_MINX, motor.POS_MAXX, 16);
+    joint.vel_des = uint_to_float(spd, motor.SPD_MINX, motor.SPD_MAXX, 12);
+    joint.torque_ff = uint_to_float(tor, motor.T_MINX, motor.T_MAXX, 12);
+}
+
+// 编码PT反馈帧 (电机端发送方式)
+void encode_feedback(const SimJoint& joint, int motor_id, VCI_CAN_OBJ& frame) {
+    const MotorParams& motor = motorParams[joint.motor_type];
+
+    double current = joint.applied_torque / (motor.KT * motor.def_ratio);
+    int pos = clamp_int(float_to_uint(joint.position, motor.POS_MINX, motor.POS_MAXX, 16), 0, 0xFFFF);
+    int spd = clamp_int(float_to_uint(joint.velocity, motor.SPD_MINX, motor.SPD_MAXX, 12), 0, 0xFFF);
+    int cur = clamp_int(float_to_uint(current, motor.I_MINX, motor.I_MAXX, 12), 0, 0xFFF);
+
+    memset(&frame, 0, sizeof(frame));
+    frame.ID = motor_id;
+    frame.DataLen = 8;
+    frame.Data[0] = joint.error + 0x01;
+    frame.Data[1] = (pos >> 8) & 0xFF;
+    frame.Data[2] = pos & 0xFF;
+    frame.Data[3] = (spd >> 4) & 0xFF;
+    frame.Data[4] = ((spd & 0xF) << 4) | ((cur >> 8) & 0xF);
+    frame.Data[5] = cur & 0xFF;
+    frame.Data[6] = encode_temperature(joint.coil_temp);
+    frame.Data[7] = encode_temperature(joint.board_temp);
+}
+
+SimChannel* find_channel(DWORD device_index, DWORD can_index) {
+    if (device_index >= SIM_MAX_DEVICES || can_index >= SIM_CHANNELS) {
+        return nullptr;
+    }
+    SimDevice& device = g_sim.devices[device_index];
+    return device.open ? &device.channels[can_index] : nullptr;
+}
+
+} // namespace
+
+EXTERN_C DWORD VCI_OpenDevice(DWORD DeviceType, DWORD DeviceInd, DWORD Reserved) {
+    (void)DeviceType; (void)Reserved;
+    std::lock_guard<std::mutex> lock(g_sim.mutex);
+    configure();
+    if (DeviceInd >= SIM_MAX_DEVICES) {
+        return STATUS_ERR;
+    }
+    g_sim.devices[DeviceInd] = SimDevice();
+    g_sim.devices[DeviceInd].open = true;
+    return STATUS_OK;
+}
+
+EXTERN_C DWORD VCI_CloseDevice(DWORD DeviceType, DWORD DeviceInd) {
+    (void)DeviceType;
+    std::lock_guard<std::mutex> lock(g_sim.mutex);
+    if (DeviceInd >= SIM_MAX_DEVICES || !g_sim.devices[DeviceInd].open) {
+        return STATUS_ERR;
+    }
+    g_sim.devices[DeviceInd] = SimDevice();
+    return STATUS_OK;
+}
+
+EXTERN_C DWORD VCI_InitCAN(DWORD DeviceType, DWORD DeviceInd, DWORD CANInd, PVCI_INIT_CONFIG pInitConfig) {
+    (void)DeviceType; (void)pInitConfig;
+    std::lock_guard<std::mutex> lock(g_sim.mutex);
+    SimChannel* channel = find_channel(DeviceInd, CANInd);
+    if (!channel) {
+        return STATUS_ERR;
+    }
+    channel->initialized = true;
+    return STATUS_OK;
+}
+
+EXTERN_C DWORD VCI_ReadBoardInfo(DWORD DeviceType, DWORD DeviceInd, PVCI_BOARD_INFO pInfo) {
+    (void)DeviceType;
+    if (!pInfo || DeviceInd >= SIM_MAX_DEVICES) {
+        return STATUS_ERR;
+    }
+    memset(pInfo, 0, sizeof(*pInfo));
+    pInfo->hw_Version = 0x0100;
+    pInfo->fw_Version = 0x0100;
+    pInfo->can_Num = SIM_CHANNELS;
+    snprintf(pInfo->str_Serial_Num, sizeof(pInfo->str_Serial_Num), "SIM%05u", DeviceInd);
+    snprintf(pInfo->str_hw_Type, sizeof(pInfo->str_hw_Type), "USBCAN-SIM");
+    return STATUS_OK;
+}
+
+EXTERN_C DWORD VCI_SetReference(DWORD DeviceType, DWORD DeviceInd, DWORD CANInd, DWORD RefType, PVOID pData) {
+    (void)DeviceType; (void)DeviceInd; (void)CANInd; (void)RefType; (void)pData;
+    return STATUS_OK;
+}
+
+EXTERN_C ULONG VCI_GetReceiveNum(DWORD DeviceType, DWORD DeviceInd, DWORD CANInd) {
+    (void)DeviceType;
+    std::lock_guard<std::mutex> lock(g_sim.mutex);
+    SimChannel* channel = find_channel(DeviceInd, CANInd);
+    if (!channel) {
+        return 0;
+    }
+    double now = sim_now();
+    ULONG count = 0;
+    for (const PendingFrame& pending : channel->rx_queue) {
+        if (pending.deliver_time <= now) count++;
+    }
+    return count;
+}
+
+EXTERN_C DWORD VCI_ClearBuffer(DWORD DeviceType, DWORD DeviceInd, DWORD CANInd) {
+    (void)DeviceType;
+    std::lock_guard<std::mutex> lock(g_sim.mutex);
+    SimChannel* channel = find_channel(DeviceInd, CANInd);
+    if (!channel) {
+        return STATUS_ERR;
+    }
+    channel->rx_queue.clear();
+    return STATUS_OK;
+}
+
+EXTERN_C DWORD VCI_StartCAN(DWORD DeviceType, DWORD DeviceInd, DWORD CANInd) {
+    (void)DeviceType;
+    std::lock_guard<std::mutex> lock(g_sim.mutex);
+    SimChannel* channel = find_channel(DeviceInd, CANInd);
+    if (!channel || !channel->initialized) {
+        return STATUS_ERR;
+    }
+    channel->started = true;
+    return STATUS_OK;
+}
+
+EXTERN_C DWORD VCI_ResetCAN(DWORD DeviceType, DWORD DeviceInd, DWORD CANInd) {
+    (void)DeviceType;
+    std::lock_guard<std::mutex> lock(g_sim.mutex);
+    SimChannel* channel = find_channel(DeviceInd, CANInd);
+    if (!channel) {
+        return STATUS_ERR;
+    }
+    channel->started = false;
+    channel->rx_queue.clear();
+    return STATUS_OK;
+}
+
+EXTERN_C ULONG VCI_Transmit(DWORD DeviceType, DWORD DeviceInd, DWORD CANInd, PVCI_CAN_OBJ pSend, UINT Len) {
+    (void)DeviceType;
+    std::lock_guard<std::mutex> lock(g_sim.mutex);
+    SimChannel* channel = find_channel(DeviceInd, CANInd);
+    if (!channel || !channel->started || !pSend) {
+        return (ULONG)-1;
+    }
+
+    double now = sim_now();
+    advance(now);
+
+    for (UINT i = 0; i < Len; i++) {
+        const VCI_CAN_OBJ& frame = pSend[i];
+
+        // 命令帧占用总线
+        channel->bus_free_time = std::max(channel->bus_free_time, now) + SIM_FRAME_TIME_S;
+
+        if (frame.ID < 1 || frame.ID > (UINT)SIM_MAX_JOINT_ID || frame.DataLen != 8 || frame.RemoteFlag) {
+            continue;
+        }
+        SimJoint& joint = g_sim.joints[frame.ID];
+        if (!joint.present) {
+            continue;
+        }
+        if (g_sim.bus_routing) {
+            JointBus route = jointBus(frame.ID, g_sim.device_count);
+            if (route.device != (int)DeviceInd || route.channel != (int)CANInd) {
+                continue;     // 不在这条总线上，命令帧只占用带宽
+            }
+        }
+
+        apply_command(joint, frame);
+        joint.applied_torque = commanded_torque(joint);
+
+        // 电机应答: 收到命令后延迟发送当前状态，反馈帧同样占用总线带宽
+        PendingFrame reply;
+        encode_feedback(joint, frame.ID, reply.frame);
+        reply.deliver_time = channel->bus_free_time + g_sim.reply_latency + SIM_FRAME_TIME_S;
+        channel->bus_free_time += SIM_FRAME_TIME_S;
+        reply.frame.TimeStamp = static_cast<UINT>(reply.deliver_time * 10000.0);  // 0.1ms单位
+        reply.frame.TimeFlag = 1;
+        channel->rx_queue.push_back(reply);
+    }
+
+    return Len;
+}
+
+EXTERN_C ULONG VCI_Receive(DWORD DeviceType, DWORD DeviceInd, DWORD CANInd, PVCI_CAN_OBJ pReceive, UINT Len, INT WaitTime) {
+    (void)DeviceType;
+    // 虚拟时间下等待没有意义，时间只由测试程序推进
+    int wait_ms = (WaitTime > 0 && !g_sim.time_source) ? WaitTime : 0;
+    auto deadline = std::chrono::steady_clock::now() + std::chrono::milliseconds(wait_ms);
+
+    while (true) {
+        {
+            std::lock_guard<std::mutex> lock(g_sim.mutex);
+            SimChannel* channel = find_channel(DeviceInd, CANInd);
+            if (!channel || !pReceive) {
+                return (ULONG)-1;
+            }
+
+            double now = sim_now();
+            advance(now);
+
+            // 反馈按发出顺序入队，只交付已到达的帧
+            ULONG count = 0;
+            while (count < Len && !channel->rx_queue.empty() &&
+                   channel->rx_queue.front().deliver_time <= now) {
+                pReceive[count++] = channel->rx_queue.front().frame;
+                channel->rx_queue.pop_front();
+            }
+            if (count > 0) {
+                return count;
+            }
+        }
+
+        if (std::chrono::steady_clock::now() >= deadline) {
+            return 0;
+        }
+        std::this_thread::sleep_for(std::chrono::microseconds(100));
+    }
+}
+
+EXTERN_C DWORD VCI_UsbDeviceReset(DWORD DevType, DWORD DevIndex, DWORD Reserved) {
+    (void)DevType; (void)DevIndex; (void)Reserved;
+    return STATUS_OK;
+}
+
+EXTERN_C DWORD VCI_FindUsbDevice2(PVCI_BOARD_INFO pInfo) {
+    DWORD count = static_cast<DWORD>(env_int("SIM_DEVICES", 1));
+    if (count > SIM_MAX_DEVICES) {
+        count = SIM_MAX_DEVICES;
+    }
+    for (DWORD i = 0; pInfo && i < count; i++) {
+        VCI_ReadBoardInfo(VCI_USBCAN2, i, &pInfo[i]);
+    }
+    return count;
+}
+
+EXTERN_C DWORD SIM_GetJointTruth(DWORD MotorID, SIM_JOINT_TRUTH* pTruth) {
+    std::lock_guard<std::mutex> lock(g_sim.mutex);
+    configure();
+    if (!pTruth || MotorID < 1 || MotorID > (DWORD)SIM_MAX_JOINT_ID) {
+        return STATUS_ERR;
+    }
+    const SimJoint& joint = g_sim.joints[MotorID];
+    pTruth->present = joint.present ? 1 : 0;
+    pTruth->motor_type = joint.motor_type;
+    pTruth->inertia = joint.inertia;
+    pTruth->static_friction = joint.static_friction;
+    pTruth->coulomb_friction = joint.coulomb_friction;
+    pTruth->viscous_coeff = joint.viscous_coeff;
+    pTruth->stribeck_velocity = joint.stribeck_velocity;
+    return STATUS_OK;
+}
+
+EXTERN_C void SIM_SetTimeSource(SIM_TIME_SOURCE source, void* context) {
+    std::lock_guard<std::mutex> lock(g_sim.mutex);
+    g_sim.time_source = source;
+    g_sim.time_context = context;
+
+    // 时间基准改变，已排队的帧和总线占用都作废
+    g_sim.sim_time = sim_now();
+    for (int d = 0; d < SIM_MAX_DEVICES; d++) {
+        for (int c = 0; c < SIM_CHANNELS; c++) {
+            g_sim.devices[d].channels[c].bus_free_time = 0.0;
+            g_sim.devices[d].channels[c].rx_queue.clear();
+        }
+    }
+}
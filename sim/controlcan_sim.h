@@ -0,0 +1,29 @@
+//
+// Simulated USBCAN Library - Extensions
+// 仿真CAN库扩展接口 - 真实libcontrolcan中不存在，仅供测试/基准程序查询仿真状态
+//
+
+#ifndef CONTROLCAN_SIM_H
+#define CONTROLCAN_SIM_H
+
+#include "controlcan.h"
+
+// 仿真关节的摩擦力真值
+typedef struct _SIM_JOINT_TRUTH {
+    INT    present;           // 关节是否在总线上
+    INT    motor_type;        // 电机型号索引 (motorParams)
+    double inertia;           // 转动惯量 (kg·m²)
+    double static_friction;   // 静摩擦力 (NM)
+    double coulomb_friction;  // 库伦摩擦力 (NM)
+    double viscous_coeff;     // 粘性摩擦系数 (NM·s/rad)
+    double stribeck_velocity; // Stribeck特征速度 (rad/s)
+} SIM_JOINT_TRUTH;
+
+// 查询关节真值，关节ID超出范围返回0
+EXTERN_C DWORD SIM_GetJointTruth(DWORD MotorID, SIM_JOINT_TRUTH* pTruth);
+
+// 替换仿真时间源 (秒)，用于虚拟时间运行；传入NULL恢复系统单调时钟
+typedef double (*SIM_TIME_SOURCE)(void* context);
+EXTERN_C void SIM_SetTimeSource(SIM_TIME_SOURCE source, void* context);
+
+#endif
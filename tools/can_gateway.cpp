@@ -0,0 +1,768 @@
+//
+// CAN网关守护进程
+// 常驻持有USBCAN设备，测试程序通过客户端库 (lib/gateway/libcontrolcan.so) 经Unix域套接字收发帧，
+// 不再每次启动都打开/初始化/关闭设备。每条总线同时只租给一个客户端进程 (会话)，其余按到达顺序排队；
+// 客户端库每个线程一个连接，同一会话的连接共用租约，各连接由各自的线程服务、互不等待。
+// 监视连接可以实时接收某条总线收发帧的副本。消息格式见 include/can_gateway_protocol.h。
+//
+// 用法:
+//   can_gateway                  前台运行守护进程 (Ctrl+C/SIGTERM退出时复位通道并关闭设备)
+//   can_gateway --monitor 0:0    打印设备0通道0的收发帧
+//   can_gateway --status         打印守护进程的设备/总线/租约状态
+//
+
+#include "controlcan.h"
+#include "can_gateway_protocol.h"
+
+#include <algorithm>
+#include <atomic>
+#include <chrono>
+#include <condition_variable>
+#include <csignal>
+#include <cstdio>
+#include <deque>
+#include <iomanip>
+#include <iostream>
+#include <map>
+#include <mutex>
+#include <sstream>
+#include <string>
+#include <thread>
+#include <vector>
+#include <dlfcn.h>
+#include <getopt.h>
+#include <poll.h>
+#include <sys/socket.h>
+#include <sys/un.h>
+#include <unistd.h>
+
+using namespace std;
+
+const DWORD DEVICE_TYPE = VCI_USBCAN2;
+// 排队等待期间检查客户端是否已断开的间隔 (毫秒)
+const int GATEWAY_QUEUE_POLL_MS = 200;
+// 守护进程主循环检查退出标志的间隔 (毫秒)
+const int GATEWAY_ACCEPT_POLL_MS = 200;
+
+atomic<bool> g_stop{false};
+
+void handleStopSignal(int) {
+    g_stop = true;
+}
+
+string busName(uint32_t device, uint32_t channel) {
+    return to_string(device) + ":" + to_string(channel);
+}
+
+string timeStamp() {
+    time_t now = time(nullptr);
+    char text[32];
+    strftime(text, sizeof(text), "%H:%M:%S", localtime(&now));
+    return text;
+}
+
+class CanGateway {
+public:
+    // 创建监听套接字并打开找到的所有设备；已有守护进程在运行时返回false
+    bool Start(const string& path) {
+        path_ = path;
+        sockaddr_un address;
+        if (!MakeAddress(path, address)) {
+            cerr << "套接字路径过长: " << path << endl;
+            return false;
+        }
+
+        int probe = socket(AF_UNIX, SOCK_SEQPACKET | SOCK_CLOEXEC, 0);
+        if (probe >= 0 && connect(probe, reinterpret_cast<sockaddr*>(&address), sizeof(address)) == 0) {
+            close(probe);
+            cerr << "CAN网关已在运行: " << path << endl;
+            return false;
+        }
+        if (probe >= 0) {
+            close(probe);
+        }
+        unlink(path.c_str());     // 上次异常退出留下的套接字文件
+
+        listen_fd_ = socket(AF_UNIX, SOCK_SEQPACKET | SOCK_CLOEXEC, 0);
+        if (listen_fd_ < 0 || ::bind(listen_fd_, reinterpret_cast<sockaddr*>(&address), sizeof(address)) != 0 ||
+            listen(listen_fd_, 16) != 0) {
+            cerr << "无法监听 " << path << ": " << strerror(errno) << endl;
+            return false;
+        }
+
+        VCI_BOARD_INFO boards[50];
+        int found = static_cast<int>(VCI_FindUsbDevice2(boards));
+        device_count_ = static_cast<uint32_t>(max(0, min(found, static_cast<int>(GATEWAY_MAX_DEVICES))));
+        for (uint32_t i = 0; i < device_count_; i++) {
+            devices_[i].info = boards[i];
+            OpenDevice(i);
+        }
+        Log("监听 " + path + ", 找到 " + to_string(device_count_) + " 个设备");
+        return true;
+    }
+
+    // 接受客户端直到收到退出信号
+    void Run() {
+        while (!g_stop) {
+            pollfd listener = {listen_fd_, POLLIN, 0};
+            int ready = poll(&listener, 1, GATEWAY_ACCEPT_POLL_MS);
+            if (ready <= 0) {
+                continue;
+            }
+            int fd = accept4(listen_fd_, nullptr, nullptr, SOCK_CLOEXEC);
+            if (fd < 0) {
+                continue;
+            }
+            lock_guard<mutex> lock(mutex_);
+            uint64_t id = ++next_client_;
+            clients_[id].fd = fd;
+            clients_[id].session = id;
+            thread(&CanGateway::ServeClient, this, fd, id).detach();
+        }
+    }
+
+    // 断开所有客户端，复位已启动的通道并关闭设备
+    void Stop() {
+        {
+            // 客户端线程退出时从clients_中移除自己
+            unique_lock<mutex> lock(mutex_);
+            for (auto& client : clients_) {
+                shutdown(client.second.fd, SHUT_RDWR);
+            }
+            queue_changed_.notify_all();
+            client_exited_.wait(lock, [this] { return clients_.empty(); });
+        }
+
+        for (uint32_t d = 0; d < GATEWAY_MAX_DEVICES; d++) {
+            GatewayDevice& device = devices_[d];
+            for (uint32_t c = 0; c < GATEWAY_CHANNELS; c++) {
+                if (device.buses[c].started) {
+                    VCI_ResetCAN(DEVICE_TYPE, d, c);
+                }
+            }
+            if (device.open) {
+                VCI_CloseDevice(DEVICE_TYPE, d);
+            }
+        }
+        if (listen_fd_ >= 0) {
+            close(listen_fd_);
+            unlink(path_.c_str());
+        }
+        Log("已停止");
+    }
+
+    static bool MakeAddress(const string& path, sockaddr_un& address) {
+        memset(&address, 0, sizeof(address));
+        address.sun_family = AF_UNIX;
+        if (path.size() >= sizeof(address.sun_path)) {
+            return false;
+        }
+        strncpy(address.sun_path, path.c_str(), sizeof(address.sun_path) - 1);
+        return true;
+    }
+
+private:
+    struct GatewayBus {
+        bool initialized = false;
+        bool started = false;
+        VCI_INIT_CONFIG config;
+        // 总线I/O锁: 租约检查和设备库调用在同一次加锁内完成，改变owner须同时持有mutex_和io
+        // (加锁顺序 mutex_ -> io)，租约换手时不会有旧会话的收发还在进行
+        mutex io;
+        uint64_t owner = 0;             // 持有租约的会话，0表示空闲
+        deque<uint64_t> waiting;        // 排队的会话
+        vector<int> monitors;           // 监视连接
+        uint64_t leases = 0;
+        uint64_t tx_frames = 0;
+        uint64_t rx_frames = 0;
+        uint64_t monitor_dropped = 0;
+    };
+
+    struct GatewayDevice {
+        bool open = false;
+        VCI_BOARD_INFO info;
+        GatewayBus buses[GATEWAY_CHANNELS];
+    };
+
+    // 一个连接；session在握手前为连接号，握手后为 pid << 32 | 会话号
+    struct GatewayClient {
+        int fd = -1;
+        int pid = 0;
+        uint64_t session = 0;
+    };
+
+    void Log(const string& message) {
+        lock_guard<mutex> lock(log_mutex_);
+        cout << "[" << timeStamp() << "] " << message << endl;
+    }
+
+    string ClientName(uint64_t id) {
+        auto it = clients_.find(id);
+        return "客户端#" + to_string(id) + (it != clients_.end() && it->second.pid > 0 ? " (pid " + to_string(it->second.pid) + ")" : "");
+    }
+
+    static string SessionName(uint64_t session) {
+        return session >> 32 ? "pid " + to_string(session >> 32) : "客户端#" + to_string(session);
+    }
+
+    uint64_t SessionOf(uint64_t id) {
+        lock_guard<mutex> lock(mutex_);
+        return clients_[id].session;
+    }
+
+    // 会话是否还有其他连接 (持有mutex_)
+    bool SessionConnected(uint64_t session, uint64_t except_id) {
+        for (const auto& client : clients_) {
+            if (client.first != except_id && client.second.session == session) {
+                return true;
+            }
+        }
+        return false;
+    }
+
+    // 调用前须持有mutex_或尚未开始服务
+    bool OpenDevice(uint32_t index) {
+        GatewayDevice& device = devices_[index];
+        if (device.open) {
+            return true;
+        }
+        if (VCI_OpenDevice(DEVICE_TYPE, index, 0) != STATUS_OK) {
+            Log("打开设备 " + to_string(index) + " 失败");
+            return false;
+        }
+        device.open = true;
+        Log("设备 " + to_string(index) + " 已打开");
+        return true;
+    }
+
+    static bool PeerClosed(int fd) {
+        pollfd peer = {fd, POLLRDHUP, 0};
+        return poll(&peer, 1, 0) > 0 && (peer.revents & (POLLRDHUP | POLLHUP | POLLERR));
+    }
+
+    // 把总线租给会话，丢弃之前留在适配器缓冲中的帧 (持有mutex_)
+    void GrantBus(GatewayBus& bus, uint64_t session, uint32_t device, uint32_t channel) {
+        lock_guard<mutex> io(bus.io);
+        bus.owner = session;
+        bus.leases++;
+        if (bus.started) {
+            VCI_ClearBuffer(DEVICE_TYPE, device, channel);
+        }
+        Log("总线 " + busName(device, channel) + " 分配给 " + SessionName(session));
+    }
+
+    // 为连接所属的会话取得总线租约；wait为false时被占用立即返回GATEWAY_BUSY (ahead为排在前面的会话数)
+    GatewayStatus AcquireBus(uint64_t id, int fd, uint32_t device, uint32_t channel, bool wait, uint32_t& ahead) {
+        unique_lock<mutex> lock(mutex_);
+        uint64_t session = clients_[id].session;
+        GatewayBus& bus = devices_[device].buses[channel];
+        if (bus.owner == session) {
+            return GATEWAY_OK;
+        }
+        if (bus.owner == 0 && bus.waiting.empty()) {
+            GrantBus(bus, session, device, channel);
+            return GATEWAY_OK;
+        }
+        if (!wait) {
+            ahead = static_cast<uint32_t>(bus.waiting.size()) + 1;
+            return GATEWAY_BUSY;
+        }
+
+        bus.waiting.push_back(session);
+        Log(SessionName(session) + " 排队等待总线 " + busName(device, channel) + " (前面 " + to_string(bus.waiting.size()) + " 个)");
+        while (true) {
+            // 同一会话的另一个连接可能已先取得租约
+            if (bus.owner == session) {
+                bus.waiting.erase(find(bus.waiting.begin(), bus.waiting.end(), session));
+                queue_changed_.notify_all();
+                return GATEWAY_OK;
+            }
+            if (bus.owner == 0 && bus.waiting.front() == session) {
+                bus.waiting.pop_front();
+                GrantBus(bus, session, device, channel);
+                queue_changed_.notify_all();
+                return GATEWAY_OK;
+            }
+            if (g_stop || PeerClosed(fd)) {
+                bus.waiting.erase(find(bus.waiting.begin(), bus.waiting.end(), session));
+                queue_changed_.notify_all();
+                return GATEWAY_DEVICE_ERROR;
+            }
+            queue_changed_.wait_for(lock, chrono::milliseconds(GATEWAY_QUEUE_POLL_MS));
+        }
+    }
+
+    // 释放会话在设备上 (channel < 0 表示所有通道) 持有的租约 (持有mutex_)
+    void ReleaseBuses(uint64_t session, uint32_t device, int channel) {
+        for (uint32_t c = 0; c < GATEWAY_CHANNELS; c++) {
+            GatewayBus& bus = devices_[device].buses[c];
+            if ((channel < 0 || static_cast<uint32_t>(channel) == c) && bus.owner == session) {
+                lock_guard<mutex> io(bus.io);
+                bus.owner = 0;
+                Log("总线 " + busName(device, c) + " 由 " + SessionName(session) + " 释放");
+            }
+        }
+        queue_changed_.notify_all();
+    }
+
+    // 把帧的副本发给总线的监视连接，发送缓冲满时丢弃
+    void ForwardToMonitors(uint32_t device, uint32_t channel, const VCI_CAN_OBJ* frames, uint32_t count, bool tx) {
+        lock_guard<mutex> lock(mutex_);
+        GatewayBus& bus = devices_[device].buses[channel];
+        (tx ? bus.tx_frames : bus.rx_frames) += count;
+        if (bus.monitors.empty() || count == 0) {
+            return;
+        }
+        GatewayHeader header = {GATEWAY_MONITOR_FRAMES, device, channel, count, 0, GATEWAY_OK, tx ? GATEWAY_FLAG_TX : 0u, 0};
+        for (int fd : bus.monitors) {
+            if (!GatewaySend(fd, header, frames, count * sizeof(VCI_CAN_OBJ), MSG_NOSIGNAL | MSG_DONTWAIT)) {
+                bus.monitor_dropped += count;
+            }
+        }
+    }
+
+    // 监视连接: 注册后一直阻塞到对方断开
+    void ServeMonitor(int fd, uint64_t id, const GatewayHeader& request) {
+        {
+            lock_guard<mutex> lock(mutex_);
+            devices_[request.device].buses[request.channel].monitors.push_back(fd);
+            Log(ClientName(id) + " 开始监视总线 " + busName(request.device, request.channel));
+        }
+        GatewayHeader reply = request;
+        reply.status = GATEWAY_OK;
+        if (GatewaySend(fd, reply, nullptr, 0)) {
+            char discard[sizeof(GatewayHeader)];
+            while (recv(fd, discard, sizeof(discard), 0) > 0) {
+            }
+        }
+        lock_guard<mutex> lock(mutex_);
+        vector<int>& monitors = devices_[request.device].buses[request.channel].monitors;
+        monitors.erase(remove(monitors.begin(), monitors.end(), fd), monitors.end());
+    }
+
+    string StatusText() {
+        lock_guard<mutex> lock(mutex_);
+        ostringstream text;
+        text << "设备数: " << device_count_ << ", 客户端: " << clients_.size() << "\n";
+        for (uint32_t d = 0; d < GATEWAY_MAX_DEVICES; d++) {
+            const GatewayDevice& device = devices_[d];
+            if (!device.open) {
+                continue;
+            }
+            text << "设备 " << d << " (" << device.info.str_Serial_Num << ")\n";
+            for (uint32_t c = 0; c < GATEWAY_CHANNELS; c++) {
+                const GatewayBus& bus = device.buses[c];
+                if (!bus.initialized && bus.leases == 0) {
+                    continue;
+                }
+                text << "  总线 " << busName(d, c) << ": " << (bus.started ? "运行" : "停止")
+                     << ", 租约 " << (bus.owner ? SessionName(bus.owner) : "空闲")
+                     << ", 排队 " << bus.waiting.size() << ", 累计租约 " << bus.leases
+                     << ", 发送 " << bus.tx_frames << " 帧, 接收 " << bus.rx_frames << " 帧"
+                     << ", 监视 " << bus.monitors.size();
+                if (bus.monitor_dropped > 0) {
+                    text << " (丢弃 " << bus.monitor_dropped << " 帧)";
+                }
+                text << "\n";
+            }
+        }
+        return text.str();
+    }
+
+    static bool ValidBus(const GatewayHeader& request) {
+        return request.device < GATEWAY_MAX_DEVICES && request.channel < GATEWAY_CHANNELS;
+    }
+
+    void ServeClient(int fd, uint64_t id) {
+        vector<char> buffer(GATEWAY_MAX_MESSAGE);
+        vector<char> payload(GATEWAY_MAX_PAYLOAD);
+        const char* request_payload = buffer.data() + sizeof(GatewayHeader);
+        bool monitor = false;
+        // 本线程只服务这一个连接，会话号只在握手时改变
+        uint64_t session = SessionOf(id);
+
+        while (!g_stop && !monitor) {
+            GatewayHeader request;
+            ssize_t size = GatewayReceive(fd, request, buffer.data(), buffer.size());
+            if (size < 0) {
+                break;
+            }
+            GatewayHeader reply = request;
+            reply.status = GATEWAY_OK;
+            reply.count = 0;
+            reply.value = 0;
+            reply.flags = 0;
+            size_t reply_size = 0;
+
+            if (request.type != GATEWAY_HELLO && request.type != GATEWAY_FIND_DEVICES &&
+                request.type != GATEWAY_STATUS && !ValidBus(request)) {
+                reply.status = GATEWAY_INVALID;
+                if (!GatewaySend(fd, reply, nullptr, 0)) {
+                    break;
+                }
+                continue;
+            }
+
+            switch (request.type) {
+                case GATEWAY_HELLO: {
+                    lock_guard<mutex> lock(mutex_);
+                    clients_[id].pid = static_cast<int>(request.value);
+                    clients_[id].session = static_cast<uint64_t>(request.value) << 32 | request.count;
+                    session = clients_[id].session;
+                    reply.value = GATEWAY_PROTOCOL_VERSION;
+                    break;
+                }
+
+                case GATEWAY_FIND_DEVICES: {
+                    lock_guard<mutex> lock(mutex_);
+                    for (uint32_t d = 0; d < device_count_; d++) {
+                        memcpy(payload.data() + d * sizeof(VCI_BOARD_INFO), &devices_[d].info, sizeof(VCI_BOARD_INFO));
+                    }
+                    reply.count = device_count_;
+                    reply.value = device_count_;
+                    reply_size = device_count_ * sizeof(VCI_BOARD_INFO);
+                    break;
+                }
+
+                case GATEWAY_OPEN_DEVICE: {
+                    lock_guard<mutex> lock(mutex_);
+                    bool opened = OpenDevice(request.device);
+                    reply.value = opened ? STATUS_OK : STATUS_ERR;
+                    reply.status = opened ? GATEWAY_OK : GATEWAY_DEVICE_ERROR;
+                    break;
+                }
+
+                case GATEWAY_CLOSE_DEVICE: {
+                    lock_guard<mutex> lock(mutex_);
+                    ReleaseBuses(session, request.device, -1);
+                    reply.value = STATUS_OK;
+                    break;
+                }
+
+                case GATEWAY_READ_BOARD_INFO: {
+                    lock_guard<mutex> lock(mutex_);
+                    VCI_BOARD_INFO info;
+                    reply.value = devices_[request.device].open ? VCI_ReadBoardInfo(DEVICE_TYPE, request.device, &info) : STATUS_ERR;
+                    if (reply.value == STATUS_OK) {
+                        memcpy(payload.data(), &info, sizeof(info));
+                        reply.count = 1;
+                        reply_size = sizeof(info);
+                    }
+                    break;
+                }
+
+                case GATEWAY_INIT_CAN:
+                case GATEWAY_START_CAN: {
+                    if (request.type == GATEWAY_INIT_CAN && static_cast<size_t>(size) != sizeof(VCI_INIT_CONFIG)) {
+                        reply.status = GATEWAY_INVALID;
+                        break;
+                    }
+                    uint32_t ahead = 0;
+                    reply.status = AcquireBus(id, fd, request.device, request.channel, request.flags & GATEWAY_FLAG_WAIT, ahead);
+                    if (reply.status != GATEWAY_OK) {
+                        reply.value = ahead;
+                        break;
+                    }
+                    // 取得租约后到这里之间租约可能已被释放并转给别的会话，在I/O锁下重新确认
+                    lock_guard<mutex> lock(mutex_);
+                    GatewayDevice& device = devices_[request.device];
+                    GatewayBus& bus = device.buses[request.channel];
+                    lock_guard<mutex> io(bus.io);
+                    if (bus.owner != session) {
+                        reply.status = GATEWAY_NOT_OWNER;
+                    } else if (!device.open) {
+                        reply.value = STATUS_ERR;
+                    } else if (request.type == GATEWAY_INIT_CAN) {
+                        // 配置不变时通道保持运行，只有配置改变才复位重新初始化
+                        VCI_INIT_CONFIG config;
+                        memcpy(&config, request_payload, sizeof(config));
+                        if (bus.initialized && memcmp(&config, &bus.config, sizeof(config)) == 0) {
+                            reply.value = STATUS_OK;
+                        } else {
+                            if (bus.started) {
+                                VCI_ResetCAN(DEVICE_TYPE, request.device, request.channel);
+                                bus.started = false;
+                            }
+                            reply.value = VCI_InitCAN(DEVICE_TYPE, request.device, request.channel, &config);
+                            bus.initialized = reply.value == STATUS_OK;
+                            bus.config = config;
+                            Log("总线 " + busName(request.device, request.channel) + (bus.initialized ? " 已初始化" : " 初始化失败"));
+                        }
+                    } else if (bus.started) {
+                        reply.value = STATUS_OK;
+                    } else {
+                        reply.value = VCI_StartCAN(DEVICE_TYPE, request.device, request.channel);
+                        bus.started = reply.value == STATUS_OK;
+                        Log("总线 " + busName(request.device, request.channel) + (bus.started ? " 已启动" : " 启动失败"));
+                    }
+                    break;
+                }
+
+                case GATEWAY_RESET_CAN: {
+                    lock_guard<mutex> lock(mutex_);
+                    ReleaseBuses(session, request.device, static_cast<int>(request.channel));
+                    reply.value = STATUS_OK;
+                    break;
+                }
+
+                case GATEWAY_CLEAR_BUFFER:
+                case GATEWAY_RECEIVE_NUM:
+                case GATEWAY_TRANSMIT:
+                case GATEWAY_RECEIVE: {
+                    // 只有持有租约的会话能访问总线；只持有该总线的I/O锁，各总线并行收发
+                    GatewayBus& bus = devices_[request.device].buses[request.channel];
+                    VCI_CAN_OBJ* frames = reinterpret_cast<VCI_CAN_OBJ*>(payload.data());
+                    uint32_t forward = 0;
+                    {
+                        lock_guard<mutex> io(bus.io);
+                        if (bus.owner != session) {
+                            reply.status = GATEWAY_NOT_OWNER;
+                            reply.value = (request.type == GATEWAY_TRANSMIT || request.type == GATEWAY_RECEIVE) ? static_cast<uint32_t>(-1) : 0;
+                            break;
+                        }
+                        if (request.type == GATEWAY_CLEAR_BUFFER) {
+                            reply.value = VCI_ClearBuffer(DEVICE_TYPE, request.device, request.channel);
+                        } else if (request.type == GATEWAY_RECEIVE_NUM) {
+                            reply.value = VCI_GetReceiveNum(DEVICE_TYPE, request.device, request.channel);
+                        } else if (request.type == GATEWAY_TRANSMIT) {
+                            if (request.count > GATEWAY_MAX_FRAMES || static_cast<size_t>(size) != request.count * sizeof(VCI_CAN_OBJ)) {
+                                reply.status = GATEWAY_INVALID;
+                                break;
+                            }
+                            memcpy(frames, request_payload, size);
+                            reply.value = VCI_Transmit(DEVICE_TYPE, request.device, request.channel, frames, request.count);
+                            if (reply.value != static_cast<uint32_t>(-1)) {
+                                forward = reply.value;
+                            }
+                        } else {
+                            uint32_t capacity = min(request.count, GATEWAY_MAX_FRAMES);
+                            reply.value = VCI_Receive(DEVICE_TYPE, request.device, request.channel, frames, capacity, 0);
+                            if (reply.value != static_cast<uint32_t>(-1) && reply.value <= capacity) {
+                                reply.count = reply.value;
+                                reply_size = reply.count * sizeof(VCI_CAN_OBJ);
+                                forward = reply.count;
+                            }
+                        }
+                    }
+                    // 监视转发要取mutex_，放在I/O锁之外以保持加锁顺序
+                    if (forward > 0) {
+                        ForwardToMonitors(request.device, request.channel, frames, forward, request.type == GATEWAY_TRANSMIT);
+                    }
+                    break;
+                }
+
+                case GATEWAY_MONITOR:
+                    ServeMonitor(fd, id, request);
+                    monitor = true;
+                    break;
+
+                case GATEWAY_STATUS: {
+                    string text = StatusText();
+                    reply_size = min(text.size(), payload.size());
+                    memcpy(payload.data(), text.data(), reply_size);
+                    reply.count = static_cast<uint32_t>(reply_size);
+                    break;
+                }
+
+                default:
+                    reply.status = GATEWAY_INVALID;
+                    break;
+            }
+
+            if (!monitor && !GatewaySend(fd, reply, payload.data(), reply_size)) {
+                break;
+            }
+        }
+
+        // 会话的最后一个连接断开 (进程退出或崩溃) 时释放它的租约
+        lock_guard<mutex> lock(mutex_);
+        if (!SessionConnected(session, id)) {
+            for (uint32_t d = 0; d < GATEWAY_MAX_DEVICES; d++) {
+                ReleaseBuses(session, d, -1);
+            }
+        }
+        clients_.erase(id);
+        close(fd);
+        client_exited_.notify_all();
+    }
+
+    string path_;
+    int listen_fd_ = -1;
+    uint32_t device_count_ = 0;
+    GatewayDevice devices_[GATEWAY_MAX_DEVICES];
+
+    mutex mutex_;                       // 设备/总线/客户端状态
+    condition_variable queue_changed_;  // 租约释放或排队变化
+    map<uint64_t, GatewayClient> clients_;
+    condition_variable client_exited_;
+    uint64_t next_client_ = 0;
+    mutex log_mutex_;
+};
+
+// 连接守护进程并完成握手，失败返回-1
+int connectGateway(const string& path) {
+    sockaddr_un address;
+    int fd = socket(AF_UNIX, SOCK_SEQPACKET | SOCK_CLOEXEC, 0);
+    if (fd < 0 || !CanGateway::MakeAddress(path, address) ||
+        connect(fd, reinterpret_cast<sockaddr*>(&address), sizeof(address)) != 0) {
+        cerr << "无法连接CAN网关 " << path << ": " << strerror(errno) << endl;
+        if (fd >= 0) {
+            close(fd);
+        }
+        return -1;
+    }
+    GatewayHeader hello = {GATEWAY_HELLO, 0, 0, 0, static_cast<uint32_t>(getpid()), GATEWAY_OK, 0, 0};
+    vector<char> buffer(GATEWAY_MAX_MESSAGE);
+    GatewayHeader reply;
+    if (!GatewaySend(fd, hello, nullptr, 0) || GatewayReceive(fd, reply, buffer.data(), buffer.size()) < 0 ||
+        reply.value != GATEWAY_PROTOCOL_VERSION) {
+        cerr << "CAN网关协议版本不一致" << endl;
+        close(fd);
+        return -1;
+    }
+    return fd;
+}
+
+int printStatus(const string& path) {
+    int fd = connectGateway(path);
+    if (fd < 0) {
+        return 1;
+    }
+    GatewayHeader request = {GATEWAY_STATUS, 0, 0, 0, 0, GATEWAY_OK, 0, 0};
+    vector<char> buffer(GATEWAY_MAX_MESSAGE);
+    GatewayHeader reply;
+    ssize_t size = GatewaySend(fd, request, nullptr, 0) ? GatewayReceive(fd, reply, buffer.data(), buffer.size()) : -1;
+    close(fd);
+    if (size < 0) {
+        return 1;
+    }
+    cout << string(buffer.data() + sizeof(GatewayHeader), size);
+    return 0;
+}
+
+// 打印一条总线的收发帧，直到守护进程退出或Ctrl+C
+int monitorBus(const string& path, uint32_t device, uint32_t channel) {
+    int fd = connectGateway(path);
+    if (fd < 0) {
+        return 1;
+    }
+    GatewayHeader request = {GATEWAY_MONITOR, device, channel, 0, 0, GATEWAY_OK, 0, 0};
+    vector<char> buffer(GATEWAY_MAX_MESSAGE);
+    GatewayHeader reply;
+    if (!GatewaySend(fd, request, nullptr, 0) || GatewayReceive(fd, reply, buffer.data(), buffer.size()) < 0 ||
+        reply.status != GATEWAY_OK) {
+        cerr << "无法监视总线 " << busName(device, channel) << endl;
+        close(fd);
+        return 1;
+    }
+    cout << "监视总线 " << busName(device, channel) << " (时间为收到副本的主机时间)" << endl;
+
+    auto start = chrono::steady_clock::now();
+    while (!g_stop) {
+        GatewayHeader message;
+        ssize_t size = GatewayReceive(fd, message, buffer.data(), buffer.size());
+        if (size < 0) {
+            break;
+        }
+        if (message.type != GATEWAY_MONITOR_FRAMES) {
+            continue;
+        }
+        bool tx = message.flags & GATEWAY_FLAG_TX;
+        double host_ms = chrono::duration<double, milli>(chrono::steady_clock::now() - start).count();
+        const VCI_CAN_OBJ* frames = reinterpret_cast<const VCI_CAN_OBJ*>(buffer.data() + sizeof(GatewayHeader));
+        for (uint32_t i = 0; i < message.count && (i + 1) * sizeof(VCI_CAN_OBJ) <= static_cast<size_t>(size); i++) {
+            const VCI_CAN_OBJ& frame = frames[i];
+            cout << fixed << setprecision(1) << setw(10) << host_ms << " ms  " << (tx ? "TX" : "RX")
+                 << "  ID=0x" << hex << setw(3) << setfill('0') << frame.ID << dec << setfill(' ')
+                 << " [" << static_cast<int>(frame.DataLen) << "]";
+            for (int b = 0; b < frame.DataLen && b < 8; b++) {
+                cout << " " << hex << setw(2) << setfill('0') << static_cast<int>(frame.Data[b]) << dec << setfill(' ');
+            }
+            if (!tx && frame.TimeFlag) {
+                cout << "  适配器 " << frame.TimeStamp * 0.1 << " ms";
+            }
+            cout << "\n";
+        }
+        cout.flush();
+    }
+    close(fd);
+    return 0;
+}
+
+void printUsage(const char* program_name) {
+    cout << "用法: " << program_name << " [选项]\n\n";
+    cout << "常驻持有USBCAN设备，测试程序用 LD_LIBRARY_PATH=lib/gateway 通过网关访问总线\n\n";
+    cout << "选项:\n";
+    cout << "  -h, --help            显示此帮助信息\n";
+    cout << "  -s, --socket PATH     套接字路径 (默认: " << GATEWAY_DEFAULT_SOCKET << ", 或环境变量 " << GATEWAY_SOCKET_ENV << ")\n";
+    cout << "  -m, --monitor DEV:CH  打印该总线的收发帧 (连接到已运行的守护进程)\n";
+    cout << "      --status          打印守护进程状态\n";
+}
+
+int main(int argc, char* argv[]) {
+    string socket_path = GatewaySocketPath();
+    string monitor;
+    bool status = false;
+
+    static struct option long_options[] = {
+        {"help", no_argument, 0, 'h'},
+        {"socket", required_argument, 0, 's'},
+        {"monitor", required_argument, 0, 'm'},
+        {"status", no_argument, 0, 1001},
+        {0, 0, 0, 0}
+    };
+
+    int c;
+    while ((c = getopt_long(argc, argv, "hs:m:", long_options, nullptr)) != -1) {
+        switch (c) {
+            case 'h':
+                printUsage(argv[0]);
+                return 0;
+            case 's':
+                socket_path = optarg;
+                break;
+            case 'm':
+                monitor = optarg;
+                break;
+            case 1001:
+                status = true;
+                break;
+            default:
+                printUsage(argv[0]);
+                return 1;
+        }
+    }
+
+    struct sigaction action;
+    memset(&action, 0, sizeof(action));
+    action.sa_handler = handleStopSignal;     // 不设SA_RESTART: 阻塞的recv/poll被中断后检查退出标志
+    sigaction(SIGINT, &action, nullptr);
+    sigaction(SIGTERM, &action, nullptr);
+
+    if (status) {
+        return printStatus(socket_path);
+    }
+    if (!monitor.empty()) {
+        unsigned device = 0, channel = 0;
+        if (sscanf(monitor.c_str(), "%u:%u", &device, &channel) != 2 ||
+            device >= GATEWAY_MAX_DEVICES || channel >= GATEWAY_CHANNELS) {
+            cerr << "错误: 总线格式为 设备:通道，例如 0:0" << endl;
+            return 1;
+        }
+        return monitorBus(socket_path, device, channel);
+    }
+
+    // 守护进程必须加载真实设备库 (或仿真库)，不能加载转发到自己的客户端库
+    if (dlsym(RTLD_DEFAULT, "GATEWAY_ClientLibrary")) {
+        cerr << "错误: 守护进程加载了网关客户端库，请不要对 can_gateway 设置 LD_LIBRARY_PATH=lib/gateway" << endl;
+        return 1;
+    }
+
+    CanGateway gateway;
+    if (!gateway.Start(socket_path)) {
+        return 1;
+    }
+    gateway.Run();
+    gateway.Stop();
+    return 0;
+}
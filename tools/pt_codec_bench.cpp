@@ -0,0 +1,375 @@
+//
+// PT协议编解码微基准
+// 测量命令打包、反馈解析、定点转换和接收缓冲的每帧耗时与分配次数，
+// 结果可输出为CSV，用于比较不同版本，并估算1kHz多关节控制周期的预算占用。
+//
+// 接收部分不访问设备: 用内存中的帧源代替VCI_Receive，只测调用方的缓冲处理方式。
+//
+
+#include "controlcan.h"
+#include "pt_protocol.h"
+#include "pt_batch_codec.h"
+#include <iostream>
+#include <iomanip>
+#include <fstream>
+#include <vector>
+#include <string>
+#include <chrono>
+#include <atomic>
+#include <random>
+#include <functional>
+#include <algorithm>
+#include <cstdlib>
+#include <cstring>
+#include <new>
+#include <getopt.h>
+
+using namespace std;
+
+// 统计全局分配次数 (每个用例的 allocs/call)
+static atomic<uint64_t> g_allocations{0};
+
+void* operator new(size_t size) {
+    g_allocations.fetch_add(1, memory_order_relaxed);
+    void* p = malloc(size ? size : 1);
+    if (!p) {
+        throw bad_alloc();
+    }
+    return p;
+}
+
+void operator delete(void* p) noexcept {
+    free(p);
+}
+
+void operator delete(void* p, size_t) noexcept {
+    free(p);
+}
+
+// 防止被测结果被优化掉
+static volatile uint32_t g_sink = 0;
+
+inline uint32_t floatBits(float value) {
+    uint32_t bits;
+    memcpy(&bits, &value, sizeof(bits));
+    return bits;
+}
+
+struct BenchResult {
+    string name;
+    string path;
+    size_t frames_per_call = 0;
+    uint64_t calls = 0;
+    double ns_per_frame = 0.0;
+    double frames_per_s = 0.0;
+    double allocs_per_call = 0.0;
+};
+
+struct BenchConfig {
+    int joints = 32;                 // 每个控制周期的关节数 (批量用例的批大小)
+    double min_time_s = 0.2;         // 每次测量的最短时间
+    int repeats = 5;                 // 取最快的一次
+    int motor_type = MOTOR_30_40;
+    bool topology = false;           // 按关节拓扑混合型号
+    string csv_file;
+};
+
+// 运行 call 直到累计时间超过min_time_s，重复repeats次取最快一次
+BenchResult runBench(const BenchConfig& config, const string& name, const string& path,
+                     size_t frames_per_call, const function<uint32_t()>& call) {
+    typedef chrono::steady_clock bench_clock;
+
+    // 预热并估算单次耗时，决定每轮调用次数
+    uint64_t calls = 1;
+    while (true) {
+        auto start = bench_clock::now();
+        for (uint64_t i = 0; i < calls; i++) {
+            g_sink = g_sink + call();
+        }
+        double elapsed = chrono::duration<double>(bench_clock::now() - start).count();
+        if (elapsed >= config.min_time_s / 10 || calls >= (1ull << 30)) {
+            calls = max<uint64_t>(1, static_cast<uint64_t>(calls * config.min_time_s / max(elapsed, 1e-9)));
+            break;
+        }
+        calls *= 4;
+    }
+
+    double best = 1e30;
+    uint64_t allocs = 0;
+    for (int r = 0; r < config.repeats; r++) {
+        uint64_t allocs_before = g_allocations.load(memory_order_relaxed);
+        auto start = bench_clock::now();
+        for (uint64_t i = 0; i < calls; i++) {
+            g_sink = g_sink + call();
+        }
+        double elapsed = chrono::duration<double>(bench_clock::now() - start).count();
+        allocs = g_allocations.load(memory_order_relaxed) - allocs_before;
+        best = min(best, elapsed);
+    }
+
+    BenchResult result;
+    result.name = name;
+    result.path = path;
+    result.frames_per_call = frames_per_call;
+    result.calls = calls;
+    result.ns_per_frame = best * 1e9 / (calls * frames_per_call);
+    result.frames_per_s = calls * frames_per_call / best;
+    result.allocs_per_call = static_cast<double>(allocs) / calls;
+    return result;
+}
+
+// 与电机端解析方式相同的逐字段打包 (PTCodec之前SendPTCommand的写法，作为对照)
+void encodeLegacy(VCI_CAN_OBJ& frame, const MotorParams& m, int motor_id, float kp, float kd, float pos, float spd, float torque) {
+    memset(&frame, 0, sizeof(frame));
+    frame.ID = motor_id;
+    frame.DataLen = 8;
+    int kp_int = float_to_uint(kp, m.KP_MINX, m.KP_MAXX, 12);
+    int kd_int = float_to_uint(kd, m.KD_MINX, m.KD_MAXX, 9);
+    int pos_int = float_to_uint(pos, m.POS_MINX, m.POS_MAXX, 16);
+    int spd_int = float_to_uint(spd, m.SPD_MINX, m.SPD_MAXX, 12);
+    int t_int = float_to_uint(torque, m.T_MINX, m.T_MAXX, 12);
+    frame.Data[0] = (kp_int >> 7) & 0xFF;
+    frame.Data[1] = ((kp_int & 0x7F) << 1) | ((kd_int >> 8) & 0x1);
+    frame.Data[2] = kd_int & 0xFF;
+    frame.Data[3] = (pos_int >> 8) & 0xFF;
+    frame.Data[4] = pos_int & 0xFF;
+    frame.Data[5] = (spd_int >> 4) & 0xFF;
+    frame.Data[6] = ((spd_int & 0xF) << 4) | ((t_int >> 8) & 0xF);
+    frame.Data[7] = t_int & 0xFF;
+}
+
+// 内存帧源: 每次"接收"拷贝固定数量的反馈帧
+struct FrameSource {
+    vector<VCI_CAN_OBJ> frames;
+
+    DWORD Receive(VCI_CAN_OBJ* buffer, DWORD capacity) {
+        DWORD count = min<DWORD>(capacity, static_cast<DWORD>(frames.size()));
+        memcpy(buffer, frames.data(), count * sizeof(VCI_CAN_OBJ));
+        return count;
+    }
+};
+
+void printUsage(const char* program_name) {
+    cout << "用法: " << program_name << " [选项]\n\n";
+    cout << "选项:\n";
+    cout << "  -h, --help           显示此帮助信息\n";
+    cout << "  -j, --joints N       每个控制周期的关节数 (默认: 32)\n";
+    cout << "  -t, --motor-type N   电机型号 (默认: 0)\n";
+    cout << "  --topology           按关节拓扑混合电机型号\n";
+    cout << "  --time SECONDS       每次测量的最短时间 (默认: 0.2)\n";
+    cout << "  --csv FILE           结果另存为CSV\n";
+}
+
+int main(int argc, char* argv[]) {
+    BenchConfig config;
+
+    static struct option long_options[] = {
+        {"help", no_argument, 0, 'h'},
+        {"joints", required_argument, 0, 'j'},
+        {"motor-type", required_argument, 0, 't'},
+        {"topology", no_argument, 0, 1001},
+        {"time", required_argument, 0, 1002},
+        {"csv", required_argument, 0, 1003},
+        {0, 0, 0, 0}
+    };
+
+    int c;
+    while ((c = getopt_long(argc, argv, "hj:t:", long_options, nullptr)) != -1) {
+        switch (c) {
+            case 'h':
+                printUsage(argv[0]);
+                return 0;
+            case 'j':
+                config.joints = atoi(optarg);
+                if (config.joints < 1 || config.joints > JOINT_TOPOLOGY_MAX_ID) {
+                    cerr << "错误: 关节数必须在1-" << JOINT_TOPOLOGY_MAX_ID << "范围内\n";
+                    return 1;
+                }
+                break;
+            case 't':
+                config.motor_type = atoi(optarg);
+                if (config.motor_type < 0 || config.motor_type >= MOTOR_TYPE_COUNT) {
+                    cerr << "错误: 电机型号必须在0-" << MOTOR_TYPE_COUNT - 1 << "范围内\n";
+                    return 1;
+                }
+                break;
+            case 1001:
+                config.topology = true;
+                break;
+            case 1002:
+                config.min_time_s = atof(optarg);
+                if (config.min_time_s <= 0) {
+                    cerr << "错误: 测量时间必须大于0\n";
+                    return 1;
+                }
+                break;
+            case 1003:
+                config.csv_file = optarg;
+                break;
+            default:
+                printUsage(argv[0]);
+                return 1;
+        }
+    }
+
+    // 一个控制周期的命令和反馈 (结构数组)
+    size_t n = config.joints;
+    vector<int> ids(n);
+    vector<uint8_t> types(n);
+    vector<float> kp(n), kd(n), pos(n), spd(n), torque(n);
+    mt19937 rng(1);
+    uniform_real_distribution<float> unit(0.0f, 1.0f);
+    for (size_t i = 0; i < n; i++) {
+        ids[i] = static_cast<int>(i) + 1;
+        types[i] = static_cast<uint8_t>(config.topology ? jointMotorType(ids[i]) : config.motor_type);
+        const MotorParams& m = motorParams[types[i]];
+        kp[i] = 0.0f;
+        kd[i] = 0.0f;
+        pos[i] = m.POS_MINX + unit(rng) * (m.POS_MAXX - m.POS_MINX);
+        spd[i] = 0.0f;
+        torque[i] = (unit(rng) - 0.5f) * 4.0f;
+    }
+
+    vector<VCI_CAN_OBJ> frames(n);
+    PTCommandBatch commands = {ids.data(), types.data(), kp.data(), kd.data(), pos.data(), spd.data(), torque.data(), n};
+    encodePTCommandBatch(commands, frames.data());
+
+    FrameSource source;
+    source.frames.resize(n);
+    for (size_t i = 0; i < n; i++) {
+        VCI_CAN_OBJ& frame = source.frames[i];
+        memset(&frame, 0, sizeof(frame));
+        frame.ID = ids[i];
+        frame.DataLen = 8;
+        for (int b = 0; b < 8; b++) {
+            frame.Data[b] = static_cast<BYTE>(rng());
+        }
+    }
+    vector<float> out_pos(n), out_spd(n), out_cur(n);
+
+    PTBatchPath best_path = ptBatchBestPath();
+    vector<PTBatchPath> paths = {PT_BATCH_SCALAR};
+#ifdef PT_BATCH_X86
+    paths.push_back(PT_BATCH_SSE2);
+    if (best_path == PT_BATCH_AVX2) {
+        paths.push_back(PT_BATCH_AVX2);
+    }
+#endif
+
+    vector<BenchResult> results;
+    size_t index = 0;
+
+    // 定点转换 (单个字段)
+    results.push_back(runBench(config, "float_to_uint", "scalar", 1, [&]() {
+        index = (index + 1) % n;
+        const MotorParams& m = motorParams[types[index]];
+        return static_cast<uint32_t>(float_to_uint(torque[index], m.T_MINX, m.T_MAXX, 12));
+    }));
+    results.push_back(runBench(config, "uint_to_float", "scalar", 1, [&]() {
+        index = (index + 1) % n;
+        const MotorParams& m = motorParams[types[index]];
+        return floatBits(uint_to_float(static_cast<int>(index * 97), m.T_MINX, m.T_MAXX, 12));
+    }));
+
+    // 命令打包: 逐帧 (float_to_uint / PTCodec) 与批量
+    results.push_back(runBench(config, "encode_frame", "float_to_uint", 1, [&]() {
+        index = (index + 1) % n;
+        encodeLegacy(frames[index], motorParams[types[index]], ids[index], kp[index], kd[index], pos[index], spd[index], torque[index]);
+        return static_cast<uint32_t>(frames[index].Data[7]);
+    }));
+    results.push_back(runBench(config, "encode_frame", "ptcodec", 1, [&]() {
+        index = (index + 1) % n;
+        VCI_CAN_OBJ& frame = frames[index];
+        memset(&frame, 0, sizeof(frame));
+        frame.ID = ids[index];
+        frame.DataLen = 8;
+        ptCodecOps[types[index]].encode_command(frame.Data, kp[index], kd[index], pos[index], spd[index], torque[index]);
+        return static_cast<uint32_t>(frame.Data[7]);
+    }));
+    for (PTBatchPath path : paths) {
+        results.push_back(runBench(config, "encode_batch", ptBatchPathName(path), n, [&]() {
+            encodePTCommandBatch(commands, frames.data(), path);
+            return static_cast<uint32_t>(frames[n - 1].Data[7]);
+        }));
+    }
+
+    // 反馈解析: 逐帧与批量
+    results.push_back(runBench(config, "decode_frame", "uint_to_float", 1, [&]() {
+        index = (index + 1) % n;
+        const MotorParams& m = motorParams[types[index]];
+        const BYTE* d = source.frames[index].Data;
+        float p = uint_to_float((d[1] << 8) | d[2], m.POS_MINX, m.POS_MAXX, 16);
+        float s = uint_to_float((d[3] << 4) | ((d[4] >> 4) & 0xF), m.SPD_MINX, m.SPD_MAXX, 12);
+        float i = uint_to_float(((d[4] & 0xF) << 8) | d[5], m.I_MINX, m.I_MAXX, 12);
+        return floatBits(p + s + i);
+    }));
+    results.push_back(runBench(config, "decode_frame", "ptcodec", 1, [&]() {
+        index = (index + 1) % n;
+        float p, s, i;
+        ptCodecOps[types[index]].decode_feedback(source.frames[index].Data, &p, &s, &i);
+        return floatBits(p + s + i);
+    }));
+    for (PTBatchPath path : paths) {
+        results.push_back(runBench(config, "decode_batch", ptBatchPathName(path), n, [&]() {
+            PTFeedbackBatch batch = {types.data(), out_pos.data(), out_spd.data(), out_cur.data()};
+            decodePTFeedbackBatch(source.frames.data(), n, batch, path);
+            return floatBits(out_pos[n - 1]);
+        }));
+    }
+
+    // 接收缓冲: 每次调用返回新vector (friction_test.cpp的写法) 与调用者提供的缓冲
+    results.push_back(runBench(config, "receive", "vector_per_call", n, [&]() {
+        vector<VCI_CAN_OBJ> received;
+        VCI_CAN_OBJ buffer[64];
+        DWORD count = source.Receive(buffer, 64);
+        for (DWORD i = 0; i < count; i++) {
+            received.push_back(buffer[i]);
+        }
+        return static_cast<uint32_t>(received.size());
+    }));
+    results.push_back(runBench(config, "receive", "caller_buffer", n, [&]() {
+        VCI_CAN_OBJ buffer[64];
+        DWORD count = source.Receive(buffer, 64);
+        return static_cast<uint32_t>(count + buffer[0].Data[0]);
+    }));
+
+    // 输出
+    cout << "PT编解码微基准: " << n << " 关节/周期, 型号 "
+         << (config.topology ? "按关节拓扑" : motorParams[config.motor_type].model)
+         << ", 批量最快路径 " << ptBatchPathName(best_path) << endl << endl;
+    cout << left << setw(16) << "用例" << setw(18) << "实现" << right << setw(8) << "帧/次"
+         << setw(12) << "ns/帧" << setw(14) << "帧/s" << setw(12) << "分配/次" << endl;
+    for (const BenchResult& r : results) {
+        cout << left << setw(16) << r.name << setw(18) << r.path << right << setw(8) << r.frames_per_call
+             << setw(12) << fixed << setprecision(2) << r.ns_per_frame
+             << setw(14) << setprecision(0) << r.frames_per_s
+             << setw(12) << setprecision(2) << r.allocs_per_call << endl;
+    }
+
+    // 1kHz控制周期预算: 每周期编码n条命令并解码n条反馈
+    double encode_ns = 1e30, decode_ns = 1e30;
+    for (const BenchResult& r : results) {
+        if (r.name == "encode_batch") encode_ns = min(encode_ns, r.ns_per_frame);
+        if (r.name == "decode_batch") decode_ns = min(decode_ns, r.ns_per_frame);
+    }
+    double cycle_us = (encode_ns + decode_ns) * n / 1000.0;
+    cout << "\n1kHz周期预算: 编码+解码 " << n << " 关节 " << setprecision(2) << cycle_us << " us/周期, 占 1000 us 的 "
+         << setprecision(3) << cycle_us / 10.0 << "%" << endl;
+
+    if (!config.csv_file.empty()) {
+        ofstream csv(config.csv_file);
+        if (!csv.is_open()) {
+            cerr << "无法创建CSV文件: " << config.csv_file << endl;
+            return 1;
+        }
+        csv << "case,impl,joints,frames_per_call,calls,ns_per_frame,frames_per_s,allocs_per_call" << endl;
+        for (const BenchResult& r : results) {
+            csv << r.name << "," << r.path << "," << n << "," << r.frames_per_call << "," << r.calls << ","
+                << fixed << setprecision(3) << r.ns_per_frame << "," << setprecision(0) << r.frames_per_s << ","
+                << setprecision(3) << r.allocs_per_call << endl;
+        }
+        cout << "CSV已保存到: " << config.csv_file << endl;
+    }
+
+    return 0;
+}
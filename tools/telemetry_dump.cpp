@@ -0,0 +1,166 @@
+//
+// 遥测文件查看工具
+// mmap打开 correct_pt_test --telemetry 生成的二进制文件，打印文件头和每个关节的统计，
+// 或把单个关节的记录导出为CSV。
+//
+
+#include "telemetry.h"
+#include <iostream>
+#include <iomanip>
+#include <vector>
+#include <cmath>
+#include <cstdlib>
+#include <getopt.h>
+
+using namespace std;
+
+struct JointSummary {
+    uint64_t count = 0;
+    double first_s = 0.0;
+    double last_s = 0.0;
+    float min_pos = 0.0f;
+    float max_pos = 0.0f;
+    float max_speed = 0.0f;
+    float max_current = 0.0f;
+    float max_coil_temp = -100.0f;
+    uint64_t errors = 0;
+};
+
+void printUsage(const char* program_name) {
+    cout << "用法: " << program_name << " [选项] FILE\n\n";
+    cout << "选项:\n";
+    cout << "  -h, --help        显示此帮助信息\n";
+    cout << "  -j, --joint ID    导出该关节的所有记录 (CSV, 输出到标准输出)\n";
+}
+
+void printHeader(const TelemetryHeader& header, size_t count) {
+    cout << "=== 遥测文件 ===" << endl;
+    cout << "格式版本: " << header.version << ", 记录大小: " << header.record_size << " 字节, 记录数: " << count << endl;
+    if (header.motor_type >= 0 && header.motor_type < (int)header.motor_count) {
+        const TelemetryMotor& motor = header.motors[header.motor_type];
+        cout << "电机型号: " << motor.model << " (扭矩范围: " << motor.T_MINX << " ~ " << motor.T_MAXX << " NM)" << endl;
+    } else if (header.motor_type == -1) {
+        cout << "电机型号: 按关节拓扑" << endl;
+    }
+    cout << "开始时间: " << header.start_unix_ns / 1000000000ull << endl;
+
+    cout << "测试关节: ";
+    for (int id = 0; id < 64; id++) {
+        if (header.joint_mask & (1ull << id)) {
+            cout << id << " ";
+        }
+    }
+    cout << endl;
+
+    cout << "测试方式: ";
+    if (header.flags & TELEMETRY_FLAG_RAMP) {
+        cout << "斜坡 " << header.ramp_rate << " NM/s @ " << header.ramp_hz << " Hz";
+    } else if (header.flags & TELEMETRY_FLAG_ADAPTIVE) {
+        cout << "自适应搜索";
+    } else {
+        cout << "固定步进";
+    }
+    if (header.flags & TELEMETRY_FLAG_PARALLEL) {
+        cout << ", 并行";
+    }
+    cout << endl;
+    cout << "扭矩: " << header.torque_start << " ~ " << header.torque_max << " NM, 步进 " << header.torque_step
+         << " NM, 位置阈值 " << header.position_threshold << " rad, 等待 " << header.wait_time_ms << " ms" << endl;
+}
+
+int main(int argc, char* argv[]) {
+    int export_joint = -1;
+
+    static struct option long_options[] = {
+        {"help", no_argument, 0, 'h'},
+        {"joint", required_argument, 0, 'j'},
+        {0, 0, 0, 0}
+    };
+
+    int c;
+    while ((c = getopt_long(argc, argv, "hj:", long_options, nullptr)) != -1) {
+        switch (c) {
+            case 'h':
+                printUsage(argv[0]);
+                return 0;
+            case 'j':
+                export_joint = atoi(optarg);
+                break;
+            default:
+                printUsage(argv[0]);
+                return 1;
+        }
+    }
+
+    if (optind >= argc) {
+        printUsage(argv[0]);
+        return 1;
+    }
+
+    TelemetryReader reader;
+    string error;
+    if (!reader.Open(argv[optind], &error)) {
+        cerr << "错误: " << argv[optind] << ": " << error << endl;
+        return 1;
+    }
+
+    if (export_joint >= 0) {
+        cout << "time_s,torque_cmd,position_rad,speed_rads,current_a,coil_temp,board_temp,error" << endl;
+        cout << fixed << setprecision(6);
+        for (const TelemetryRecord& record : reader) {
+            if (record.joint_id != export_joint) {
+                continue;
+            }
+            cout << record.time_ns * 1e-9 << "," << record.torque_cmd << "," << record.position_rad << ","
+                 << record.speed_rads << "," << record.current_A << ","
+                 << TelemetryTemperature(record.coil_temp_raw) << "," << TelemetryTemperature(record.board_temp_raw) << ","
+                 << (int)record.motor_error << "\n";
+        }
+        return 0;
+    }
+
+    printHeader(reader.Header(), reader.Count());
+
+    vector<JointSummary> joints(256);
+    for (const TelemetryRecord& record : reader) {
+        JointSummary& joint = joints[record.joint_id];
+        double t = record.time_ns * 1e-9;
+        if (joint.count == 0) {
+            joint.first_s = t;
+            joint.min_pos = joint.max_pos = record.position_rad;
+        }
+        joint.count++;
+        joint.last_s = t;
+        joint.min_pos = min(joint.min_pos, record.position_rad);
+        joint.max_pos = max(joint.max_pos, record.position_rad);
+        joint.max_speed = max(joint.max_speed, fabs(record.speed_rads));
+        joint.max_current = max(joint.max_current, fabs(record.current_A));
+        joint.max_coil_temp = max(joint.max_coil_temp, TelemetryTemperature(record.coil_temp_raw));
+        if (record.motor_error != 0) {
+            joint.errors++;
+        }
+    }
+
+    // 按关节拓扑记录时每行附上该关节的电机型号
+    const TelemetryHeader& header = reader.Header();
+    bool per_joint_type = header.motor_type == -1;
+    cout << "\n关节  记录数     时间范围(s)          位置范围(rad)        最大速度  最大电流  最高线圈温度  错误"
+         << (per_joint_type ? "  型号" : "") << endl;
+    for (size_t id = 0; id < joints.size(); id++) {
+        const JointSummary& joint = joints[id];
+        if (joint.count == 0) {
+            continue;
+        }
+        cout << setw(4) << id << setw(9) << joint.count << fixed << setprecision(3)
+             << setw(10) << joint.first_s << " ~" << setw(9) << joint.last_s
+             << setw(10) << joint.min_pos << " ~" << setw(8) << joint.max_pos
+             << setw(10) << joint.max_speed << setw(10) << joint.max_current
+             << setw(10) << setprecision(1) << joint.max_coil_temp << setw(8) << joint.errors;
+        if (per_joint_type && id < sizeof(header.joint_motor_type) && header.joint_motor_type[id] < header.motor_count) {
+            cout << "  " << header.motors[header.joint_motor_type[id]].model;
+        }
+        cout << endl;
+    }
+
+    return 0;
+}